@@ -1,7 +1,10 @@
 #include <iostream>
+#include <string>
+#include <vector>
 #include "itkArray.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkChunkedCompressedImageFileWriter.h"
 #include "itkMultiScaleHessianEnhancementImageFilter.h"
 #include "itkDescoteauxEigenToMeasureImageFilter.h"
 #include "itkDescoteauxEigenToMeasureParameterEstimationFilter.h"
@@ -41,28 +44,46 @@ class MyCommand : public itk::Command
 
 int main(int argc, char * argv[])
 {
-  if( argc < 6 )
+  /* Separate the options from the positional arguments */
+  bool printExecutionReport = false;
+  bool quantizeOutput = false;
+  std::vector< std::string > arguments;
+  for (int i = 0; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument == "--report") {
+      printExecutionReport = true;
+    } else if (argument == "--quantize") {
+      quantizeOutput = true;
+    } else {
+      arguments.push_back(argument);
+    }
+  }
+
+  if( arguments.size() < 6 )
   {
     std::cerr << "Usage: "<< std::endl;
-    std::cerr << argv[0];
+    std::cerr << arguments[0];
     std::cerr << " <InputFileName> <OutputMeasure> ";
     std::cerr << " <SetEnhanceBrightObjects[0,1]> ";
-    std::cerr << " <NumberOfSigma> <Sigma1> [<Sigma2> <Sigma3>] ";
+    std::cerr << " <NumberOfSigma> <Sigma1> [<Sigma2> <Sigma3>] [--report] [--quantize] ";
     std::cerr << std::endl;
+    std::cerr << "An <OutputMeasure> ending in .bcz is written as zlib compressed chunks." << std::endl;
+    std::cerr << "--report prints the per-stage timing and memory of the multi-scale filter." << std::endl;
+    std::cerr << "--quantize writes the measure as 16 bit integers and prints the scale and offset to convert them back." << std::endl;
     return EXIT_FAILURE;
   }
 
   /* Read input Parameters */
-  std::string inputFileName = argv[1];
-  std::string outputMeasureFileName = argv[2];
+  std::string inputFileName = arguments[1];
+  std::string outputMeasureFileName = arguments[2];
 
-  int enhanceBrightObjects = std::stoi(argv[3]);
-  int numberOfSigma = std::stoi(argv[4]);
+  int enhanceBrightObjects = std::stoi(arguments[3]);
+  int numberOfSigma = std::stoi(arguments[4]);
   double thisSigma;
   itk::Array< double > sigmaArray;
   sigmaArray.SetSize(numberOfSigma);
   for (int i = 0; i < numberOfSigma; ++i) {
-    thisSigma = std::stod(argv[5+i]);
+    thisSigma = std::stod(arguments[5+i]);
     sigmaArray.SetElement(i, thisSigma);
   }
 
@@ -76,6 +97,7 @@ int main(int argc, char * argv[])
   }
   std::cout << "  NumberOfSigma:               " << numberOfSigma << std::endl;
   std::cout << "  Sigmas:                      " << sigmaArray << std::endl;
+  std::cout << "  QuantizeOutput:              " << (quantizeOutput ? "Yes" : "No") << std::endl;
   std::cout << std::endl;
 
   /* Setup Types */
@@ -87,7 +109,10 @@ int main(int argc, char * argv[])
 
   using ReaderType = itk::ImageFileReader< InputImageType >;
   using MeasureWriterType = itk::ImageFileWriter< OutputImageType >;
+  using ChunkedMeasureWriterType = itk::ChunkedCompressedImageFileWriter< OutputImageType >;
   using MultiScaleHessianFilterType = itk::MultiScaleHessianEnhancementImageFilter< InputImageType, OutputImageType >;
+  using QuantizedMeasureWriterType = itk::ImageFileWriter< MultiScaleHessianFilterType::QuantizedImageType >;
+  using QuantizedChunkedMeasureWriterType = itk::ChunkedCompressedImageFileWriter< MultiScaleHessianFilterType::QuantizedImageType >;
   using DescoteauxEigenToMeasureImageFilterType = itk::DescoteauxEigenToMeasureImageFilter< MultiScaleHessianFilterType::EigenValueImageType, OutputImageType >;
   using DescoteauxEigenToMeasureParameterEstimationFilterType = itk::DescoteauxEigenToMeasureParameterEstimationFilter< MultiScaleHessianFilterType::EigenValueImageType >;
 
@@ -105,18 +130,46 @@ int main(int argc, char * argv[])
   multiScaleFilter->SetEigenToMeasureImageFilter(descoFilter);
   multiScaleFilter->SetEigenToMeasureParameterEstimationFilter(estimationFilter);
   multiScaleFilter->SetSigmaArray(sigmaArray);
+  multiScaleFilter->SetQuantizeOutput(quantizeOutput);
 
   std::cout << "Running multiScaleFilter..." << std::endl;
   MyCommand::Pointer myCommand = MyCommand::New();
   multiScaleFilter->AddObserver(itk::ProgressEvent(), myCommand);
   multiScaleFilter->Update();
-
-  MeasureWriterType::Pointer measureWriter = MeasureWriterType::New();
-  measureWriter->SetInput(multiScaleFilter->GetOutput());
-  measureWriter->SetFileName(outputMeasureFileName);
+  if (printExecutionReport) {
+    std::cout << "Execution report: " << multiScaleFilter->GetExecutionReport() << std::endl;
+  }
 
   std::cout << "Writing results to " << outputMeasureFileName << std::endl;
-  measureWriter->Write();
+  if (quantizeOutput) {
+    /* The response is -1 to 1, quantized to the range of short */
+    std::cout << "  Quantized with scale " << multiScaleFilter->GetQuantizationScale()
+              << " and offset " << multiScaleFilter->GetQuantizationOffset() << std::endl;
+    if (itk::ChunkedCompressedImageFileFormat::IsChunkedCompressedFileName(outputMeasureFileName)) {
+      QuantizedChunkedMeasureWriterType::Pointer chunkedWriter = QuantizedChunkedMeasureWriterType::New();
+      chunkedWriter->SetInput(multiScaleFilter->GetQuantizedOutput());
+      chunkedWriter->SetFileName(outputMeasureFileName);
+      chunkedWriter->Write();
+    } else {
+      QuantizedMeasureWriterType::Pointer measureWriter = QuantizedMeasureWriterType::New();
+      measureWriter->SetInput(multiScaleFilter->GetQuantizedOutput());
+      measureWriter->SetFileName(outputMeasureFileName);
+      measureWriter->Write();
+    }
+  } else if (itk::ChunkedCompressedImageFileFormat::IsChunkedCompressedFileName(outputMeasureFileName)) {
+    /* The measure is mostly zero, store it as compressed chunks */
+    ChunkedMeasureWriterType::Pointer chunkedWriter = ChunkedMeasureWriterType::New();
+    chunkedWriter->SetInput(multiScaleFilter->GetOutput());
+    chunkedWriter->SetFileName(outputMeasureFileName);
+    chunkedWriter->Write();
+    std::cout << "  Wrote " << chunkedWriter->GetFileSize() << " bytes, " << chunkedWriter->GetNumberOfZeroChunks()
+              << " of " << chunkedWriter->GetNumberOfChunks() << " chunks were zero" << std::endl;
+  } else {
+    MeasureWriterType::Pointer measureWriter = MeasureWriterType::New();
+    measureWriter->SetInput(multiScaleFilter->GetOutput());
+    measureWriter->SetFileName(outputMeasureFileName);
+    measureWriter->Write();
+  }
 
   return EXIT_SUCCESS;
 }
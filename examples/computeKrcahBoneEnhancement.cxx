@@ -1,7 +1,10 @@
 #include <iostream>
+#include <string>
+#include <vector>
 #include "itkArray.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkChunkedCompressedImageFileWriter.h"
 #include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
 #include "itkMultiScaleHessianEnhancementImageFilter.h"
 #include "itkKrcahEigenToMeasureImageFilter.h"
@@ -42,35 +45,59 @@ class MyCommand : public itk::Command
 
 int main(int argc, char * argv[])
 {
-  if( argc < 8 )
+  /* Separate the options from the positional arguments */
+  bool printExecutionReport = false;
+  bool quantizeOutput = false;
+  std::vector< std::string > arguments;
+  for (int i = 0; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument == "--report") {
+      printExecutionReport = true;
+    } else if (argument == "--quantize") {
+      quantizeOutput = true;
+    } else {
+      arguments.push_back(argument);
+    }
+  }
+
+  if( arguments.size() < 8 )
   {
     std::cerr << "Usage: "<< std::endl;
-    std::cerr << argv[0];
+    std::cerr << arguments[0];
     std::cerr << " <InputFileName> <OutputPreprocessed> <OutputMeasure> ";
     std::cerr << " <SetEnhanceBrightObjects[0,1]> ";
-    std::cerr << " <NumberOfSigma> <Sigma1> [<Sigma2> <Sigma3>] ";
+    std::cerr << " <NumberOfSigma> <Sigma1> [<Sigma2> <Sigma3>] [--report] [--quantize] ";
     std::cerr << std::endl;
+    std::cerr << "An <OutputMeasure> ending in .bcz is written as zlib compressed chunks." << std::endl;
+    std::cerr << "--report prints the per-stage timing and memory of the multi-scale filter." << std::endl;
+    std::cerr << "--quantize writes the measure as 16 bit integers and prints the scale and offset to convert them back." << std::endl;
+    std::cerr << "An <OutputPreprocessed> of - preprocesses each piece within the multi-scale filter instead of writing it." << std::endl;
     return EXIT_FAILURE;
   }
 
   /* Read input Parameters */
-  std::string inputFileName = argv[1];
-  std::string outputPreprocessedFileName = argv[2];
-  std::string outputMeasureFileName = argv[3];
+  std::string inputFileName = arguments[1];
+  std::string outputPreprocessedFileName = arguments[2];
+  std::string outputMeasureFileName = arguments[3];
+  bool fusePreprocessing = (outputPreprocessedFileName == "-");
 
-  int enhanceBrightObjects = std::stoi(argv[4]);
-  unsigned long numberOfSigma = std::stoul(argv[5]);
+  int enhanceBrightObjects = std::stoi(arguments[4]);
+  unsigned long numberOfSigma = std::stoul(arguments[5]);
   double thisSigma;
   itk::Array< double > sigmaArray;
   sigmaArray.SetSize(numberOfSigma);
   for (unsigned int i = 0; i < numberOfSigma; ++i) {
-    thisSigma = std::stod(argv[6+i]);
+    thisSigma = std::stod(arguments[6+i]);
     sigmaArray.SetElement(i, thisSigma);
   }
 
   std::cout << "Read in the following parameters:" << std::endl;
   std::cout << "  InputFilePath:               " << inputFileName << std::endl;
-  std::cout << "  OutputPreprocessed:          " << outputPreprocessedFileName << std::endl;
+  if (fusePreprocessing) {
+    std::cout << "  OutputPreprocessed:          " << "Preprocessing within the multi-scale filter" << std::endl;
+  } else {
+    std::cout << "  OutputPreprocessed:          " << outputPreprocessedFileName << std::endl;
+  }
   std::cout << "  OutputMeasure:               " << outputMeasureFileName << std::endl;
   if (enhanceBrightObjects == 1) {
     std::cout << "  SetEnhanceBrightObjects:     " << "Enhancing bright objects" << std::endl;
@@ -79,6 +106,7 @@ int main(int argc, char * argv[])
   }
   std::cout << "  NumberOfSigma:               " << numberOfSigma << std::endl;
   std::cout << "  Sigmas:                      " << sigmaArray << std::endl;
+  std::cout << "  QuantizeOutput:              " << (quantizeOutput ? "Yes" : "No") << std::endl;
   std::cout << std::endl;
 
   /* Setup Types */
@@ -91,9 +119,12 @@ int main(int argc, char * argv[])
   using ReaderType = itk::ImageFileReader< InputImageType >;
   using PreprocessedWriterType = itk::ImageFileWriter< InputImageType >;
   using MeasureWriterType = itk::ImageFileWriter< OutputImageType >;
+  using ChunkedMeasureWriterType = itk::ChunkedCompressedImageFileWriter< OutputImageType >;
 
   using PreprocessFilterType = itk::KrcahPreprocessingImageToImageFilter< InputImageType >;
   using MultiScaleHessianFilterType = itk::MultiScaleHessianEnhancementImageFilter< InputImageType, OutputImageType >;
+  using QuantizedMeasureWriterType = itk::ImageFileWriter< MultiScaleHessianFilterType::QuantizedImageType >;
+  using QuantizedChunkedMeasureWriterType = itk::ChunkedCompressedImageFileWriter< MultiScaleHessianFilterType::QuantizedImageType >;
   using KrcahEigenToMeasureFilterType = itk::KrcahEigenToMeasureImageFilter< MultiScaleHessianFilterType::EigenValueImageType, OutputImageType >;
   using KrcahEigenToMeasureParameterEstimationFilterType = itk::KrcahEigenToMeasureParameterEstimationFilter< MultiScaleHessianFilterType::EigenValueImageType >;
 
@@ -102,40 +133,76 @@ int main(int argc, char * argv[])
   reader->SetFileName(inputFileName);
 
   PreprocessFilterType::Pointer preprocessingFilter = PreprocessFilterType::New();
-  preprocessingFilter->SetInput(reader->GetOutput());
+  if (!fusePreprocessing) {
+    preprocessingFilter->SetInput(reader->GetOutput());
 
-  std::cout << "Running preprocessing..." << std::endl;
-  MyCommand::Pointer myCommand = MyCommand::New();
-  preprocessingFilter->AddObserver(itk::ProgressEvent(), myCommand);
-  preprocessingFilter->Update();
+    std::cout << "Running preprocessing..." << std::endl;
+    MyCommand::Pointer myCommand = MyCommand::New();
+    preprocessingFilter->AddObserver(itk::ProgressEvent(), myCommand);
+    preprocessingFilter->Update();
 
-  PreprocessedWriterType::Pointer preprocessingWriter = PreprocessedWriterType::New();
-  preprocessingWriter->SetInput(preprocessingFilter->GetOutput());
-  preprocessingWriter->SetFileName(outputPreprocessedFileName);
+    PreprocessedWriterType::Pointer preprocessingWriter = PreprocessedWriterType::New();
+    preprocessingWriter->SetInput(preprocessingFilter->GetOutput());
+    preprocessingWriter->SetFileName(outputPreprocessedFileName);
 
-  std::cout << "Writing out " << outputPreprocessedFileName << std::endl;
-  preprocessingWriter->Write();
+    std::cout << "Writing out " << outputPreprocessedFileName << std::endl;
+    preprocessingWriter->Write();
+  }
 
   /* Multiscale measure */
   MultiScaleHessianFilterType::Pointer multiScaleFilter = MultiScaleHessianFilterType::New();
   KrcahEigenToMeasureFilterType::Pointer krcahFilter = KrcahEigenToMeasureFilterType::New();
   KrcahEigenToMeasureParameterEstimationFilterType::Pointer estimationFilter = KrcahEigenToMeasureParameterEstimationFilterType::New();
-  multiScaleFilter->SetInput(preprocessingFilter->GetOutput());
+  if (fusePreprocessing) {
+    /* The preprocessed image is computed piece by piece and never held over the whole volume */
+    multiScaleFilter->SetInput(reader->GetOutput());
+    multiScaleFilter->SetPreprocessingFilter(preprocessingFilter);
+  } else {
+    multiScaleFilter->SetInput(preprocessingFilter->GetOutput());
+  }
   multiScaleFilter->SetEigenToMeasureImageFilter(krcahFilter);
   multiScaleFilter->SetEigenToMeasureParameterEstimationFilter(estimationFilter);
   multiScaleFilter->SetSigmaArray(sigmaArray);
+  multiScaleFilter->SetQuantizeOutput(quantizeOutput);
 
   std::cout << "Running multiScaleFilter..." << std::endl;
   MyCommand::Pointer command2 = MyCommand::New();
   multiScaleFilter->AddObserver(itk::ProgressEvent(), command2);
   multiScaleFilter->Update();
-
-  MeasureWriterType::Pointer measureWriter = MeasureWriterType::New();
-  measureWriter->SetInput(multiScaleFilter->GetOutput());
-  measureWriter->SetFileName(outputMeasureFileName);
+  if (printExecutionReport) {
+    std::cout << "Execution report: " << multiScaleFilter->GetExecutionReport() << std::endl;
+  }
 
   std::cout << "Writing results to " << outputMeasureFileName << std::endl;
-  measureWriter->Write();
+  if (quantizeOutput) {
+    /* The response is -1 to 1, quantized to the range of short */
+    std::cout << "  Quantized with scale " << multiScaleFilter->GetQuantizationScale()
+              << " and offset " << multiScaleFilter->GetQuantizationOffset() << std::endl;
+    if (itk::ChunkedCompressedImageFileFormat::IsChunkedCompressedFileName(outputMeasureFileName)) {
+      QuantizedChunkedMeasureWriterType::Pointer chunkedWriter = QuantizedChunkedMeasureWriterType::New();
+      chunkedWriter->SetInput(multiScaleFilter->GetQuantizedOutput());
+      chunkedWriter->SetFileName(outputMeasureFileName);
+      chunkedWriter->Write();
+    } else {
+      QuantizedMeasureWriterType::Pointer measureWriter = QuantizedMeasureWriterType::New();
+      measureWriter->SetInput(multiScaleFilter->GetQuantizedOutput());
+      measureWriter->SetFileName(outputMeasureFileName);
+      measureWriter->Write();
+    }
+  } else if (itk::ChunkedCompressedImageFileFormat::IsChunkedCompressedFileName(outputMeasureFileName)) {
+    /* The measure is mostly zero, store it as compressed chunks */
+    ChunkedMeasureWriterType::Pointer chunkedWriter = ChunkedMeasureWriterType::New();
+    chunkedWriter->SetInput(multiScaleFilter->GetOutput());
+    chunkedWriter->SetFileName(outputMeasureFileName);
+    chunkedWriter->Write();
+    std::cout << "  Wrote " << chunkedWriter->GetFileSize() << " bytes, " << chunkedWriter->GetNumberOfZeroChunks()
+              << " of " << chunkedWriter->GetNumberOfChunks() << " chunks were zero" << std::endl;
+  } else {
+    MeasureWriterType::Pointer measureWriter = MeasureWriterType::New();
+    measureWriter->SetInput(multiScaleFilter->GetOutput());
+    measureWriter->SetFileName(outputMeasureFileName);
+    measureWriter->Write();
+  }
 
   return EXIT_SUCCESS;
 }
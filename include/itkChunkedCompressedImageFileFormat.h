@@ -0,0 +1,317 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkChunkedCompressedImageFileFormat_h
+#define itkChunkedCompressedImageFileFormat_h
+
+#include "itkByteSwapper.h"
+#include "itkImageRegion.h"
+#include "itkIntTypes.h"
+#include "itkMacro.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \class ChunkedCompressedImageFileFormat
+ * \brief Layout of the chunked, compressed image files written by ChunkedCompressedImageFileWriter.
+ *
+ * The measure images are dense floating point volumes which are zero outside of bone. A file
+ * (extension .bcz) splits the image into chunks of ChunkSize pixels which are compressed
+ * independently, so chunks can be written in parallel and a region can be read without decoding
+ * the whole image.
+ *
+ * All values are little endian. The file starts with the header
+ *   - the magic "BCZ1" and the version, uint32
+ *   - dimension, component type, component size in bytes and shuffle flag, uint32
+ *   - index, int64, size and chunk size, uint64, one per dimension
+ *   - spacing and origin, float64, one per dimension, and the direction, row by row
+ *   - the number of chunks, uint64, and for each chunk the offset of its data from the start of
+ *     the file and its compressed length, uint64
+ *
+ * Chunks are numbered with the first dimension fastest. The pixels of a chunk are stored with
+ * the first dimension fastest and, if shuffle is on, the bytes are then grouped by their position
+ * in the pixel, first bytes of all pixels first. Slowly varying values then give long runs of
+ * equal bytes, which deflate compresses much better. A chunk whose bytes are all zero has length
+ * zero and no data.
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+class ChunkedCompressedImageFileFormat
+{
+public:
+  static constexpr uint32_t Version = 1;
+
+  /** Type of the pixel components */
+  typedef enum {
+    UnsignedIntegerComponent = 0,
+    SignedIntegerComponent = 1,
+    RealComponent = 2
+  } ComponentEnum;
+
+  /** Contents of the header, apart from the chunk table */
+  struct Header
+  {
+    uint32_t                m_Dimension;
+    uint32_t                m_ComponentType;
+    uint32_t                m_ComponentSize;
+    uint32_t                m_Shuffle;
+    std::vector< int64_t >  m_Index;
+    std::vector< uint64_t > m_Size;
+    std::vector< uint64_t > m_ChunkSize;
+    std::vector< double >   m_Spacing;
+    std::vector< double >   m_Origin;
+    std::vector< double >   m_Direction;
+  };
+
+  /** Offset from the start of the file and compressed length of every chunk */
+  struct ChunkTable
+  {
+    std::vector< uint64_t > m_Offsets;
+    std::vector< uint64_t > m_Lengths;
+  };
+
+  template< typename TPixel >
+  static uint32_t GetComponentType()
+  {
+    if ( !NumericTraits< TPixel >::is_integer )
+    {
+      return RealComponent;
+    }
+    return NumericTraits< TPixel >::is_signed ? SignedIntegerComponent : UnsignedIntegerComponent;
+  }
+
+  /** Size in bytes of the header for a dimension and number of chunks */
+  static SizeValueType GetHeaderSize(unsigned int dimension, SizeValueType numberOfChunks)
+  {
+    return 4 + 5 * sizeof(uint32_t) + 3 * dimension * 8 + ( 2 + dimension ) * dimension * 8
+      + 8 + 2 * 8 * numberOfChunks;
+  }
+
+  static void WriteHeader(std::ostream & os, const Header & header, const ChunkTable & table)
+  {
+    os.write("BCZ1", 4);
+    WriteValue(os, Version);
+    WriteValue(os, header.m_Dimension);
+    WriteValue(os, header.m_ComponentType);
+    WriteValue(os, header.m_ComponentSize);
+    WriteValue(os, header.m_Shuffle);
+    WriteValues(os, header.m_Index);
+    WriteValues(os, header.m_Size);
+    WriteValues(os, header.m_ChunkSize);
+    WriteValues(os, header.m_Spacing);
+    WriteValues(os, header.m_Origin);
+    WriteValues(os, header.m_Direction);
+    WriteValue(os, static_cast< uint64_t >( table.m_Offsets.size() ));
+    for ( SizeValueType i = 0; i < table.m_Offsets.size(); ++i )
+    {
+      WriteValue(os, table.m_Offsets[i]);
+      WriteValue(os, table.m_Lengths[i]);
+    }
+  }
+
+  /** Read the header. Throws if the stream is not a supported file. */
+  static void ReadHeader(std::istream & is, Header & header, ChunkTable & table)
+  {
+    char magic[4];
+    is.read(magic, 4);
+    if ( !is || std::memcmp(magic, "BCZ1", 4) != 0 )
+    {
+      itkGenericExceptionMacro(<< "Not a chunked compressed image file");
+    }
+    uint32_t version = 0;
+    ReadValue(is, version);
+    if ( version != Version )
+    {
+      itkGenericExceptionMacro(<< "Unsupported chunked compressed image file version " << version);
+    }
+    ReadValue(is, header.m_Dimension);
+    ReadValue(is, header.m_ComponentType);
+    ReadValue(is, header.m_ComponentSize);
+    ReadValue(is, header.m_Shuffle);
+    if ( header.m_Dimension == 0 || header.m_Dimension > 16 )
+    {
+      itkGenericExceptionMacro(<< "Invalid dimension " << header.m_Dimension << " in chunked compressed image file");
+    }
+    const unsigned int dimension = header.m_Dimension;
+    ReadValues(is, header.m_Index, dimension);
+    ReadValues(is, header.m_Size, dimension);
+    ReadValues(is, header.m_ChunkSize, dimension);
+    ReadValues(is, header.m_Spacing, dimension);
+    ReadValues(is, header.m_Origin, dimension);
+    ReadValues(is, header.m_Direction, dimension * dimension);
+
+    uint64_t numberOfChunks = 0;
+    ReadValue(is, numberOfChunks);
+    uint64_t expectedNumberOfChunks = 1;
+    for ( unsigned int d = 0; d < dimension; ++d )
+    {
+      if ( header.m_ChunkSize[d] == 0 )
+      {
+        itkGenericExceptionMacro(<< "Invalid chunk size in chunked compressed image file");
+      }
+      expectedNumberOfChunks *= ( header.m_Size[d] + header.m_ChunkSize[d] - 1 ) / header.m_ChunkSize[d];
+    }
+    if ( !is || numberOfChunks != expectedNumberOfChunks )
+    {
+      itkGenericExceptionMacro(<< "Invalid chunk table in chunked compressed image file");
+    }
+
+    /* The table and every chunk have to lie within the file, which is read by the declared lengths */
+    const std::streamoff tableStart = is.tellg();
+    is.seekg(0, std::ios::end);
+    const std::streamoff fileEnd = is.tellg();
+    is.seekg(tableStart);
+    if ( !is || tableStart < 0 || fileEnd < tableStart
+         || numberOfChunks > static_cast< uint64_t >( fileEnd - tableStart ) / ( 2 * sizeof(uint64_t) ) )
+    {
+      itkGenericExceptionMacro(<< "Truncated chunked compressed image file");
+    }
+    const uint64_t fileSize = static_cast< uint64_t >( fileEnd );
+    const uint64_t dataStart = static_cast< uint64_t >( tableStart ) + 2 * sizeof(uint64_t) * numberOfChunks;
+    table.m_Offsets.resize(numberOfChunks);
+    table.m_Lengths.resize(numberOfChunks);
+    for ( SizeValueType i = 0; i < numberOfChunks; ++i )
+    {
+      ReadValue(is, table.m_Offsets[i]);
+      ReadValue(is, table.m_Lengths[i]);
+      if ( table.m_Lengths[i] > 0
+           && ( table.m_Offsets[i] < dataStart || table.m_Offsets[i] > fileSize
+                || table.m_Lengths[i] > fileSize - table.m_Offsets[i] ) )
+      {
+        itkGenericExceptionMacro(<< "Chunk " << i << " with offset " << table.m_Offsets[i] << " and length "
+                                 << table.m_Lengths[i] << " lies outside of the chunked compressed image file of "
+                                 << fileSize << " bytes");
+      }
+    }
+    if ( !is )
+    {
+      itkGenericExceptionMacro(<< "Truncated chunked compressed image file");
+    }
+  }
+
+  /** Whether a file name has the extension of the format, .bcz */
+  static bool IsChunkedCompressedFileName(const std::string & fileName)
+  {
+    const std::string extension = ".bcz";
+    return fileName.size() > extension.size()
+      && fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+  }
+
+  /** Number of chunks along each dimension and in total */
+  template< unsigned int VDimension >
+  static SizeValueType GetNumberOfChunks(const Size< VDimension > & size, const Size< VDimension > & chunkSize,
+                                         Size< VDimension > & chunksPerDimension)
+  {
+    SizeValueType numberOfChunks = 1;
+    for ( unsigned int d = 0; d < VDimension; ++d )
+    {
+      chunksPerDimension[d] = ( size[d] + chunkSize[d] - 1 ) / chunkSize[d];
+      numberOfChunks *= chunksPerDimension[d];
+    }
+    return numberOfChunks;
+  }
+
+  /** Region of a chunk, cropped to the image */
+  template< unsigned int VDimension >
+  static ImageRegion< VDimension > GetChunkRegion(const ImageRegion< VDimension > & largestRegion,
+                                                  const Size< VDimension > & chunkSize,
+                                                  const Size< VDimension > & chunksPerDimension,
+                                                  SizeValueType chunk)
+  {
+    ImageRegion< VDimension > region;
+    for ( unsigned int d = 0; d < VDimension; ++d )
+    {
+      const SizeValueType position = chunk % chunksPerDimension[d];
+      chunk /= chunksPerDimension[d];
+      const SizeValueType start = position * chunkSize[d];
+      region.SetIndex(d, largestRegion.GetIndex(d) + static_cast< IndexValueType >( start ));
+      region.SetSize(d, std::min< SizeValueType >( chunkSize[d], largestRegion.GetSize(d) - start ));
+    }
+    return region;
+  }
+
+  /** Group the bytes of numberOfElements elements of elementSize bytes by their position */
+  static void Shuffle(const unsigned char * in, unsigned char * out, SizeValueType numberOfElements, unsigned int elementSize)
+  {
+    for ( unsigned int b = 0; b < elementSize; ++b )
+    {
+      unsigned char * stream = out + b * numberOfElements;
+      for ( SizeValueType i = 0; i < numberOfElements; ++i )
+      {
+        stream[i] = in[i * elementSize + b];
+      }
+    }
+  }
+
+  /** Inverse of Shuffle( ) */
+  static void Unshuffle(const unsigned char * in, unsigned char * out, SizeValueType numberOfElements, unsigned int elementSize)
+  {
+    for ( unsigned int b = 0; b < elementSize; ++b )
+    {
+      const unsigned char * stream = in + b * numberOfElements;
+      for ( SizeValueType i = 0; i < numberOfElements; ++i )
+      {
+        out[i * elementSize + b] = stream[i];
+      }
+    }
+  }
+
+private:
+  template< typename T >
+  static void WriteValue(std::ostream & os, T value)
+  {
+    ByteSwapper< T >::SwapFromSystemToLittleEndian(&value);
+    os.write(reinterpret_cast< const char * >( &value ), sizeof(T));
+  }
+
+  template< typename T >
+  static void WriteValues(std::ostream & os, const std::vector< T > & values)
+  {
+    for ( const T & value : values )
+    {
+      WriteValue(os, value);
+    }
+  }
+
+  template< typename T >
+  static void ReadValue(std::istream & is, T & value)
+  {
+    is.read(reinterpret_cast< char * >( &value ), sizeof(T));
+    ByteSwapper< T >::SwapFromSystemToLittleEndian(&value);
+  }
+
+  template< typename T >
+  static void ReadValues(std::istream & is, std::vector< T > & values, unsigned int count)
+  {
+    values.resize(count);
+    for ( T & value : values )
+    {
+      ReadValue(is, value);
+    }
+  }
+};
+} // end namespace itk
+
+#endif // itkChunkedCompressedImageFileFormat_h
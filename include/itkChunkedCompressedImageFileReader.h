@@ -0,0 +1,107 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkChunkedCompressedImageFileReader_h
+#define itkChunkedCompressedImageFileReader_h
+
+#include "itkImageSource.h"
+#include "itkChunkedCompressedImageFileFormat.h"
+#include <string>
+#include <type_traits>
+
+namespace itk
+{
+/** \class ChunkedCompressedImageFileReader
+ * \brief Read an image written by ChunkedCompressedImageFileWriter.
+ *
+ * Only the requested region of the output is read. The chunks which overlap it are read from
+ * the file and decompressed in parallel, and the other chunks are skipped. A small region of a
+ * large file can therefore be read by setting the requested region of the output, or by putting
+ * the reader upstream of a filter which only requests a region.
+ *
+ * The pixel type of the output must have the same size and kind of component as the file.
+ *
+ * \sa ChunkedCompressedImageFileFormat
+ * \sa ChunkedCompressedImageFileWriter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template< typename TOutputImage >
+class ITK_TEMPLATE_EXPORT ChunkedCompressedImageFileReader
+  : public ImageSource< TOutputImage >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(ChunkedCompressedImageFileReader);
+
+  /** Standard Self type alias */
+  using Self          = ChunkedCompressedImageFileReader;
+  using Superclass    = ImageSource< TOutputImage >;
+  using Pointer       = SmartPointer< Self >;
+  using ConstPointer  = SmartPointer< const Self >;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ChunkedCompressedImageFileReader, ImageSource);
+
+  /** Image related type alias. */
+  using OutputImageType   = TOutputImage;
+  using OutputPixelType   = typename OutputImageType::PixelType;
+  using OutputRegionType  = typename OutputImageType::RegionType;
+  using SizeType          = typename OutputImageType::SizeType;
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  static_assert(std::is_arithmetic< OutputPixelType >::value, "Only scalar pixel types can be read");
+
+  /** Set/Get the name of the file to be read. */
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Size of the chunks of the file, available after the output information is updated. */
+  itkGetConstReferenceMacro(ChunkSize, SizeType);
+
+  /** Number of chunks decompressed by the last update, not counting chunks stored as zero. */
+  itkGetConstMacro(NumberOfChunksRead, SizeValueType);
+
+protected:
+  ChunkedCompressedImageFileReader();
+  ~ChunkedCompressedImageFileReader() override {}
+
+  /** Read the header of the file. */
+  void GenerateOutputInformation() override;
+
+  /** Read the chunks which overlap the requested region. */
+  void GenerateData() override;
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  std::string                                  m_FileName;
+  SizeType                                     m_ChunkSize;
+  bool                                         m_Shuffle;
+  ChunkedCompressedImageFileFormat::ChunkTable m_ChunkTable;
+  SizeValueType                                m_NumberOfChunksRead;
+}; // end class
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkChunkedCompressedImageFileReader.hxx"
+#endif
+
+#endif // itkChunkedCompressedImageFileReader_h
@@ -0,0 +1,241 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkChunkedCompressedImageFileReader_hxx
+#define itkChunkedCompressedImageFileReader_hxx
+
+#include "itkChunkedCompressedImageFileReader.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+namespace itk
+{
+template< typename TOutputImage >
+ChunkedCompressedImageFileReader< TOutputImage >
+::ChunkedCompressedImageFileReader()
+{
+  m_ChunkSize.Fill(0);
+  m_Shuffle = false;
+  m_NumberOfChunksRead = 0;
+}
+
+template< typename TOutputImage >
+void
+ChunkedCompressedImageFileReader< TOutputImage >
+::GenerateOutputInformation()
+{
+  using FormatType = ChunkedCompressedImageFileFormat;
+  if ( m_FileName.empty() )
+  {
+    itkExceptionMacro(<< "No filename was specified");
+  }
+  std::ifstream file(m_FileName.c_str(), std::ios::in | std::ios::binary);
+  if ( !file )
+  {
+    itkExceptionMacro(<< "Could not open " << m_FileName << " for reading");
+  }
+
+  FormatType::Header header;
+  FormatType::ReadHeader(file, header, m_ChunkTable);
+  if ( header.m_Dimension != ImageDimension )
+  {
+    itkExceptionMacro(<< m_FileName << " has dimension " << header.m_Dimension << ", expected " << ImageDimension);
+  }
+  if ( header.m_ComponentType != FormatType::GetComponentType< OutputPixelType >()
+       || header.m_ComponentSize != sizeof(OutputPixelType) )
+  {
+    itkExceptionMacro(<< m_FileName << " has a pixel type of component type " << header.m_ComponentType
+                      << " and size " << header.m_ComponentSize << " which does not match the output");
+  }
+
+  OutputImageType * output = this->GetOutput();
+  OutputRegionType largestRegion;
+  typename OutputImageType::SpacingType   spacing;
+  typename OutputImageType::PointType     origin;
+  typename OutputImageType::DirectionType direction;
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    largestRegion.SetIndex(d, header.m_Index[d]);
+    largestRegion.SetSize(d, header.m_Size[d]);
+    m_ChunkSize[d] = header.m_ChunkSize[d];
+    spacing[d] = header.m_Spacing[d];
+    origin[d] = header.m_Origin[d];
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      direction[d][j] = header.m_Direction[d * ImageDimension + j];
+    }
+  }
+  m_Shuffle = ( header.m_Shuffle != 0 );
+
+  output->SetLargestPossibleRegion(largestRegion);
+  output->SetSpacing(spacing);
+  output->SetOrigin(origin);
+  output->SetDirection(direction);
+}
+
+template< typename TOutputImage >
+void
+ChunkedCompressedImageFileReader< TOutputImage >
+::GenerateData()
+{
+  using FormatType = ChunkedCompressedImageFileFormat;
+  OutputImageType * output = this->GetOutput();
+  const OutputRegionType requestedRegion = output->GetRequestedRegion();
+  output->SetBufferedRegion(requestedRegion);
+  output->Allocate();
+
+  /* Chunks overlapping the requested region, read from the file in order */
+  const OutputRegionType largestRegion = output->GetLargestPossibleRegion();
+  SizeType chunksPerDimension;
+  const SizeValueType numberOfChunks = FormatType::GetNumberOfChunks(largestRegion.GetSize(), m_ChunkSize, chunksPerDimension);
+  std::vector< SizeValueType > chunks;
+  std::vector< std::vector< unsigned char > > compressedChunks;
+  std::ifstream file(m_FileName.c_str(), std::ios::in | std::ios::binary);
+  if ( !file )
+  {
+    itkExceptionMacro(<< "Could not open " << m_FileName << " for reading");
+  }
+  for ( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+  {
+    OutputRegionType chunkRegion = FormatType::GetChunkRegion(largestRegion, m_ChunkSize, chunksPerDimension, chunk);
+    if ( !chunkRegion.Crop(requestedRegion) )
+    {
+      continue;
+    }
+    chunks.push_back(chunk);
+    compressedChunks.emplace_back(m_ChunkTable.m_Lengths[chunk]);
+    if ( m_ChunkTable.m_Lengths[chunk] > 0 )
+    {
+      file.seekg(m_ChunkTable.m_Offsets[chunk]);
+      file.read(reinterpret_cast< char * >( compressedChunks.back().data() ), m_ChunkTable.m_Lengths[chunk]);
+    }
+  }
+  if ( !file )
+  {
+    itkExceptionMacro(<< "Could not read the chunks of " << m_FileName);
+  }
+
+  /* Every chunk is inflated, unshuffled and copied by one work unit */
+  std::atomic< SizeValueType > numberOfChunksRead(0);
+  std::atomic< bool > failed(false);
+  MultiThreaderBase * multiThreader = this->GetMultiThreader();
+  multiThreader->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  multiThreader->ParallelizeArray(
+    0,
+    chunks.size(),
+    [&](SizeValueType i)
+    {
+    if ( this->GetAbortGenerateData() || failed )
+      {
+      return;
+      }
+
+    const OutputRegionType chunkRegion = FormatType::GetChunkRegion(largestRegion, m_ChunkSize, chunksPerDimension, chunks[i]);
+    OutputRegionType overlap = chunkRegion;
+    overlap.Crop(requestedRegion);
+
+    const std::vector< unsigned char > & compressed = compressedChunks[i];
+    std::vector< OutputPixelType > pixels;
+    if ( !compressed.empty() )
+      {
+      ++numberOfChunksRead;
+      const SizeValueType numberOfBytes = chunkRegion.GetNumberOfPixels() * sizeof(OutputPixelType);
+      std::vector< unsigned char > inflated(numberOfBytes);
+      uLongf inflatedLength = static_cast< uLongf >( numberOfBytes );
+      if ( uncompress(inflated.data(), &inflatedLength, compressed.data(), static_cast< uLong >( compressed.size() )) != Z_OK
+           || inflatedLength != numberOfBytes )
+        {
+        failed = true;
+        return;
+        }
+      pixels.resize(chunkRegion.GetNumberOfPixels());
+      unsigned char * bytes = reinterpret_cast< unsigned char * >( pixels.data() );
+      if ( m_Shuffle )
+        {
+        FormatType::Unshuffle(inflated.data(), bytes, pixels.size(), sizeof(OutputPixelType));
+        }
+      else
+        {
+        std::copy(inflated.begin(), inflated.end(), bytes);
+        }
+      ByteSwapper< OutputPixelType >::SwapRangeFromSystemToLittleEndian(pixels.data(), pixels.size());
+      }
+
+    /* Copy the overlap, the first dimension of the chunk is contiguous */
+    ImageScanlineIterator< OutputImageType > ot(output, overlap);
+    while ( !ot.IsAtEnd() )
+      {
+      if ( pixels.empty() )
+        {
+        while ( !ot.IsAtEndOfLine() )
+          {
+          ot.Set(NumericTraits< OutputPixelType >::ZeroValue());
+          ++ot;
+          }
+        }
+      else
+        {
+        const typename OutputImageType::IndexType index = ot.GetIndex();
+        SizeValueType offset = 0;
+        SizeValueType stride = 1;
+        for ( unsigned int d = 0; d < ImageDimension; ++d )
+          {
+          offset += static_cast< SizeValueType >( index[d] - chunkRegion.GetIndex(d) ) * stride;
+          stride *= chunkRegion.GetSize(d);
+          }
+        const OutputPixelType * in = pixels.data() + offset;
+        while ( !ot.IsAtEndOfLine() )
+          {
+          ot.Set(*in++);
+          ++ot;
+          }
+        }
+      ot.NextLine();
+      }
+    },
+    this);
+
+  if ( this->GetAbortGenerateData() )
+  {
+    throw ProcessAborted(__FILE__, __LINE__);
+  }
+  if ( failed )
+  {
+    itkExceptionMacro(<< "Decompression of a chunk of " << m_FileName << " failed");
+  }
+  m_NumberOfChunksRead = numberOfChunksRead;
+}
+
+template< typename TOutputImage >
+void
+ChunkedCompressedImageFileReader< TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << m_FileName << std::endl;
+  os << indent << "ChunkSize: " << m_ChunkSize << std::endl;
+  os << indent << "Shuffle: " << m_Shuffle << std::endl;
+  os << indent << "NumberOfChunksRead: " << m_NumberOfChunksRead << std::endl;
+}
+
+} // end namespace itk
+
+#endif // itkChunkedCompressedImageFileReader_hxx
@@ -0,0 +1,135 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkChunkedCompressedImageFileWriter_h
+#define itkChunkedCompressedImageFileWriter_h
+
+#include "itkProcessObject.h"
+#include "itkChunkedCompressedImageFileFormat.h"
+#include <string>
+#include <type_traits>
+
+namespace itk
+{
+/** \class ChunkedCompressedImageFileWriter
+ * \brief Write a scalar image as independently compressed chunks.
+ *
+ * The image is split into chunks of ChunkSize pixels. Each chunk is byte shuffled, if Shuffle is
+ * on, and deflated with zlib at CompressionLevel. Chunks are compressed in parallel by the work
+ * units of this filter, and chunks whose bytes are all zero are not stored at all. This suits the
+ * measure images, which are mostly zero, as well as label or scale level images.
+ *
+ * The whole input is requested and written. Use ChunkedCompressedImageFileReader to read a file
+ * back, or only a region of it.
+ *
+ * \sa ChunkedCompressedImageFileFormat
+ * \sa ChunkedCompressedImageFileReader
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template< typename TInputImage >
+class ITK_TEMPLATE_EXPORT ChunkedCompressedImageFileWriter
+  : public ProcessObject
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(ChunkedCompressedImageFileWriter);
+
+  /** Standard Self type alias */
+  using Self          = ChunkedCompressedImageFileWriter;
+  using Superclass    = ProcessObject;
+  using Pointer       = SmartPointer< Self >;
+  using ConstPointer  = SmartPointer< const Self >;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ChunkedCompressedImageFileWriter, ProcessObject);
+
+  /** Image related type alias. */
+  using InputImageType    = TInputImage;
+  using InputPixelType    = typename InputImageType::PixelType;
+  using InputRegionType   = typename InputImageType::RegionType;
+  using SizeType          = typename InputImageType::SizeType;
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  static_assert(std::is_arithmetic< InputPixelType >::value, "Only scalar pixel types can be written");
+
+  /** Set/Get the image to be written. */
+  using Superclass::SetInput;
+  void SetInput(const InputImageType * input);
+  const InputImageType * GetInput();
+
+  /** Set/Get the name of the file to be written. */
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Set/Get the size of the chunks in pixels. Default is 64 along every dimension. */
+  itkSetMacro(ChunkSize, SizeType);
+  itkGetConstReferenceMacro(ChunkSize, SizeType);
+
+  /** Set/Get whether the bytes of the pixels are grouped before compressing. Default is on. */
+  itkSetMacro(Shuffle, bool);
+  itkGetConstMacro(Shuffle, bool);
+  itkBooleanMacro(Shuffle);
+
+  /** Set/Get the zlib compression level, from 0 (none) to 9. Default is 1, the fastest. */
+  itkSetClampMacro(CompressionLevel, int, 0, 9);
+  itkGetConstMacro(CompressionLevel, int);
+
+  /** Number of chunks and of chunks which were all zero in the last write */
+  itkGetConstMacro(NumberOfChunks, SizeValueType);
+  itkGetConstMacro(NumberOfZeroChunks, SizeValueType);
+
+  /** Size in bytes of the last file written */
+  itkGetConstMacro(FileSize, SizeValueType);
+
+  /** Write the file. */
+  virtual void Write();
+
+  /** Alias of Write( ) so the writer can end a pipeline. */
+  void Update() override
+  {
+    this->Write();
+  }
+
+protected:
+  ChunkedCompressedImageFileWriter();
+  ~ChunkedCompressedImageFileWriter() override {}
+
+  /** Compress the chunks in parallel and write the file. */
+  void GenerateData() override;
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  std::string   m_FileName;
+  SizeType      m_ChunkSize;
+  bool          m_Shuffle;
+  int           m_CompressionLevel;
+  SizeValueType m_NumberOfChunks;
+  SizeValueType m_NumberOfZeroChunks;
+  SizeValueType m_FileSize;
+}; // end class
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkChunkedCompressedImageFileWriter.hxx"
+#endif
+
+#endif // itkChunkedCompressedImageFileWriter_h
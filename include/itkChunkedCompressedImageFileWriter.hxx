@@ -0,0 +1,251 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkChunkedCompressedImageFileWriter_hxx
+#define itkChunkedCompressedImageFileWriter_hxx
+
+#include "itkChunkedCompressedImageFileWriter.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+namespace itk
+{
+template< typename TInputImage >
+ChunkedCompressedImageFileWriter< TInputImage >
+::ChunkedCompressedImageFileWriter()
+{
+  m_ChunkSize.Fill(64);
+  m_Shuffle = true;
+  m_CompressionLevel = 1;
+  m_NumberOfChunks = 0;
+  m_NumberOfZeroChunks = 0;
+  m_FileSize = 0;
+
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template< typename TInputImage >
+void
+ChunkedCompressedImageFileWriter< TInputImage >
+::SetInput(const InputImageType * input)
+{
+  this->ProcessObject::SetNthInput(0, const_cast< InputImageType * >( input ));
+}
+
+template< typename TInputImage >
+const typename ChunkedCompressedImageFileWriter< TInputImage >::InputImageType *
+ChunkedCompressedImageFileWriter< TInputImage >
+::GetInput()
+{
+  return itkDynamicCastInDebugMode< const InputImageType * >( this->GetPrimaryInput() );
+}
+
+template< typename TInputImage >
+void
+ChunkedCompressedImageFileWriter< TInputImage >
+::Write()
+{
+  InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+  if ( !input )
+  {
+    itkExceptionMacro(<< "No input to writer");
+  }
+  if ( m_FileName.empty() )
+  {
+    itkExceptionMacro(<< "No filename was specified");
+  }
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    if ( m_ChunkSize[d] == 0 )
+    {
+      itkExceptionMacro(<< "ChunkSize must be positive, got " << m_ChunkSize);
+    }
+  }
+
+  /* The whole image is written */
+  input->UpdateOutputInformation();
+  input->SetRequestedRegionToLargestPossibleRegion();
+  input->Update();
+  if ( input->GetBufferedRegion() != input->GetLargestPossibleRegion() )
+  {
+    itkExceptionMacro(<< "The buffered region of the input must be its largest possible region");
+  }
+
+  this->InvokeEvent(StartEvent());
+  this->SetAbortGenerateData(false);
+  this->UpdateProgress(0.0f);
+  this->GenerateData();
+  this->UpdateProgress(1.0f);
+  this->InvokeEvent(EndEvent());
+
+  /* Release upstream data if requested */
+  input->ReleaseDataIfFlagSet();
+}
+
+template< typename TInputImage >
+void
+ChunkedCompressedImageFileWriter< TInputImage >
+::GenerateData()
+{
+  using FormatType = ChunkedCompressedImageFileFormat;
+  const InputImageType * input = this->GetInput();
+  const InputRegionType largestRegion = input->GetLargestPossibleRegion();
+
+  SizeType chunksPerDimension;
+  m_NumberOfChunks = FormatType::GetNumberOfChunks(largestRegion.GetSize(), m_ChunkSize, chunksPerDimension);
+  std::vector< std::vector< unsigned char > > compressedChunks(m_NumberOfChunks);
+  std::atomic< SizeValueType > numberOfZeroChunks(0);
+  std::atomic< bool > failed(false);
+
+  /* Every chunk is gathered, shuffled and deflated by one work unit */
+  MultiThreaderBase * multiThreader = this->GetMultiThreader();
+  multiThreader->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  multiThreader->ParallelizeArray(
+    0,
+    m_NumberOfChunks,
+    [&](SizeValueType chunk)
+    {
+    if ( this->GetAbortGenerateData() || failed )
+      {
+      return;
+      }
+
+    const InputRegionType chunkRegion =
+      FormatType::GetChunkRegion(largestRegion, m_ChunkSize, chunksPerDimension, chunk);
+    std::vector< InputPixelType > pixels(chunkRegion.GetNumberOfPixels());
+    ImageScanlineConstIterator< InputImageType > it(input, chunkRegion);
+    InputPixelType * out = pixels.data();
+    while ( !it.IsAtEnd() )
+      {
+      while ( !it.IsAtEndOfLine() )
+        {
+        *out++ = it.Get();
+        ++it;
+        }
+      it.NextLine();
+      }
+
+    /* Chunks of zero bytes are not stored */
+    const unsigned char * bytes = reinterpret_cast< const unsigned char * >( pixels.data() );
+    const SizeValueType numberOfBytes = pixels.size() * sizeof(InputPixelType);
+    if ( std::all_of(bytes, bytes + numberOfBytes, [](unsigned char b) { return b == 0; }) )
+      {
+      ++numberOfZeroChunks;
+      return;
+      }
+
+    ByteSwapper< InputPixelType >::SwapRangeFromSystemToLittleEndian(pixels.data(), pixels.size());
+    std::vector< unsigned char > shuffled;
+    if ( m_Shuffle )
+      {
+      shuffled.resize(numberOfBytes);
+      FormatType::Shuffle(bytes, shuffled.data(), pixels.size(), sizeof(InputPixelType));
+      bytes = shuffled.data();
+      }
+
+    std::vector< unsigned char > & compressed = compressedChunks[chunk];
+    uLongf compressedLength = compressBound(static_cast< uLong >( numberOfBytes ));
+    compressed.resize(compressedLength);
+    if ( compress2(compressed.data(), &compressedLength, bytes, static_cast< uLong >( numberOfBytes ), m_CompressionLevel) != Z_OK )
+      {
+      failed = true;
+      return;
+      }
+    compressed.resize(compressedLength);
+    },
+    this);
+
+  if ( this->GetAbortGenerateData() )
+  {
+    throw ProcessAborted(__FILE__, __LINE__);
+  }
+  if ( failed )
+  {
+    itkExceptionMacro(<< "Compression of a chunk failed");
+  }
+  m_NumberOfZeroChunks = numberOfZeroChunks;
+
+  /* Header and chunk table, then the chunks in order */
+  FormatType::Header header;
+  header.m_Dimension = ImageDimension;
+  header.m_ComponentType = FormatType::GetComponentType< InputPixelType >();
+  header.m_ComponentSize = sizeof(InputPixelType);
+  header.m_Shuffle = m_Shuffle ? 1 : 0;
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    header.m_Index.push_back(largestRegion.GetIndex(d));
+    header.m_Size.push_back(largestRegion.GetSize(d));
+    header.m_ChunkSize.push_back(m_ChunkSize[d]);
+    header.m_Spacing.push_back(input->GetSpacing()[d]);
+    header.m_Origin.push_back(input->GetOrigin()[d]);
+  }
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      header.m_Direction.push_back(input->GetDirection()[i][j]);
+    }
+  }
+
+  FormatType::ChunkTable table;
+  uint64_t offset = FormatType::GetHeaderSize(ImageDimension, m_NumberOfChunks);
+  for ( const std::vector< unsigned char > & compressed : compressedChunks )
+  {
+    table.m_Offsets.push_back(compressed.empty() ? 0 : offset);
+    table.m_Lengths.push_back(compressed.size());
+    offset += compressed.size();
+  }
+
+  std::ofstream file(m_FileName.c_str(), std::ios::out | std::ios::binary);
+  if ( !file )
+  {
+    itkExceptionMacro(<< "Could not open " << m_FileName << " for writing");
+  }
+  FormatType::WriteHeader(file, header, table);
+  for ( const std::vector< unsigned char > & compressed : compressedChunks )
+  {
+    file.write(reinterpret_cast< const char * >( compressed.data() ), compressed.size());
+  }
+  if ( !file )
+  {
+    itkExceptionMacro(<< "Could not write " << m_FileName);
+  }
+  m_FileSize = offset;
+}
+
+template< typename TInputImage >
+void
+ChunkedCompressedImageFileWriter< TInputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << m_FileName << std::endl;
+  os << indent << "ChunkSize: " << m_ChunkSize << std::endl;
+  os << indent << "Shuffle: " << m_Shuffle << std::endl;
+  os << indent << "CompressionLevel: " << m_CompressionLevel << std::endl;
+  os << indent << "NumberOfChunks: " << m_NumberOfChunks << std::endl;
+  os << indent << "NumberOfZeroChunks: " << m_NumberOfZeroChunks << std::endl;
+  os << indent << "FileSize: " << m_FileSize << std::endl;
+}
+
+} // end namespace itk
+
+#endif // itkChunkedCompressedImageFileWriter_hxx
@@ -27,7 +27,13 @@ namespace itk {
 template< typename TInputImage, typename TOutputImage >
 DescoteauxEigenToMeasureImageFilter< TInputImage, TOutputImage >
 ::DescoteauxEigenToMeasureImageFilter() :
-  m_EnhanceType(-1.0)
+  m_EnhanceType(-1.0),
+  m_Alpha(0),
+  m_Beta(0),
+  m_C(0),
+  m_SheetScale(0),
+  m_BlobScale(0),
+  m_NoiseScale(0)
 {}
 
 template< typename TInputImage, typename TOutputImage >
@@ -40,6 +46,15 @@ DescoteauxEigenToMeasureImageFilter< TInputImage, TOutputImage >
   {
     itkExceptionMacro(<< "Parameters must have size 3. Given array of size " << parameters.GetSize());
   }
+  Superclass::BeforeThreadedGenerateData();
+
+  /* Read the parameters once instead of for every pixel */
+  m_Alpha = parameters[0];
+  m_Beta = parameters[1];
+  m_C = parameters[2];
+  m_SheetScale = 1.0 / (2 * m_Alpha * m_Alpha);
+  m_BlobScale = 1.0 / (2 * m_Beta * m_Beta);
+  m_NoiseScale = 1.0 / (2 * m_C * m_C);
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -48,10 +63,9 @@ DescoteauxEigenToMeasureImageFilter< TInputImage, TOutputImage >
 ::ProcessPixel(const InputImagePixelType& pixel)
 {
   /* Grab parameters */
-  ParameterArrayType parameters = this->GetParametersInput()->Get();
-  RealType alpha = parameters[0];
-  RealType beta = parameters[1];
-  RealType c = parameters[2];
+  const RealType alpha = m_Alpha;
+  const RealType beta = m_Beta;
+  const RealType c = m_C;
 
   /* Grab pixel values */
   double sheetness = 0.0;
@@ -75,6 +89,17 @@ DescoteauxEigenToMeasureImageFilter< TInputImage, TOutputImage >
   /* Compute measures */
   const double Rsheet = l2 / l3;
   const double Rblob = Math::abs(2*l3 - l2 - l1) / l3;
+
+  /* The table takes the squared norm directly */
+  if ( this->GetUseLookupTable() )
+  {
+    sheetness = 1.0;
+    sheetness *= this->NegativeExponential(Rsheet * Rsheet * m_SheetScale);
+    sheetness *= (1.0 - this->NegativeExponential(Rblob * Rblob * m_BlobScale));
+    sheetness *= (1.0 - this->NegativeExponential((l1*l1 + l2*l2 + l3*l3) * m_NoiseScale));
+    return static_cast<OutputImagePixelType>( sheetness );
+  }
+
   const double Rnoise = sqrt(l1*l1 + l2*l2 + l3*l3);
 
   /* Multiply together to get sheetness */
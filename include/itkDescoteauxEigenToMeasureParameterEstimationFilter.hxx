@@ -20,6 +20,7 @@
 #define itkDescoteauxEigenToMeasureParameterEstimationFilter_hxx
 
 #include "itkDescoteauxEigenToMeasureParameterEstimationFilter.h"
+#include "itkImageScanlineIterator.h"
 
 namespace itk {
 
@@ -101,28 +102,50 @@ DescoteauxEigenToMeasureParameterEstimationFilter< TInputImage, TOutputImage >
   this->CallCopyOutputRegionToInputRegion(inputRegionForThread, outputRegionForThread);
 
   /* Setup iterator */
-  ImageRegionConstIteratorWithIndex< TInputImage > inputIt(inputPointer, inputRegionForThread);
-  ImageRegionIterator< OutputImageType > outputIt(outputPtr, outputRegionForThread);
+  ImageScanlineConstIterator< TInputImage > inputIt(inputPointer, inputRegionForThread);
+  const bool copyInput = this->GetCopyInputToOutput();
+  ImageScanlineIterator< OutputImageType > outputIt;
+  if ( copyInput )
+  {
+    outputIt = ImageScanlineIterator< OutputImageType >(outputPtr, outputRegionForThread);
+  }
 
   /* Iterate and count */
-  inputIt.GoToBegin();
-  outputIt.GoToBegin();
   while ( !inputIt.IsAtEnd() )
   {
-    // Process point
-    inputPointer->TransformIndexToPhysicalPoint(inputIt.GetIndex(), point);
-    if ( (!maskPointer) ||  (maskPointer->IsInsideInObjectSpace(point)) )
+    /* Check for an abort request once per line */
+    if ( this->GetAbortGenerateData() )
     {
-      /* Compute max norm */
-      max = std::max( max, this->CalculateFrobeniusNorm(inputIt.Get()) );
+      throw ProcessAborted(__FILE__, __LINE__);
     }
 
-    // Set 
-    outputIt.Set( static_cast< OutputImagePixelType >( inputIt.Get() ) );
-
-    // Increment
-    ++inputIt;
-    ++outputIt;
+    typename InputImageType::IndexType index = inputIt.GetIndex();
+    while ( !inputIt.IsAtEndOfLine() )
+    {
+      // Process point
+      inputPointer->TransformIndexToPhysicalPoint(index, point);
+      if ( (!maskPointer) ||  (maskPointer->IsInsideInObjectSpace(point)) )
+      {
+        /* Compute max norm */
+        max = std::max( max, this->CalculateFrobeniusNorm(inputIt.Get()) );
+      }
+
+      // Set 
+      if ( copyInput )
+      {
+        outputIt.Set( static_cast< OutputImagePixelType >( inputIt.Get() ) );
+        ++outputIt;
+      }
+
+      // Increment
+      ++inputIt;
+      ++index[0];
+    }
+    inputIt.NextLine();
+    if ( copyInput )
+    {
+      outputIt.NextLine();
+    }
   }
 
   /* Block and store */
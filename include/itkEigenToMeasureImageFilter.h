@@ -22,6 +22,8 @@
 #include "itkImageToImageFilter.h"
 #include "itkSimpleDataObjectDecorator.h"
 #include "itkSpatialObject.h"
+#include "itkNegativeExponentialLookupTable.h"
+#include "itkFlatBlockMap.h"
 
 namespace itk {
 /** \class EigenToMeasureImageFilter
@@ -30,6 +32,14 @@ namespace itk {
  * This is an abstract class that computes a local-structure measure from an eigen-image.
  * Any algorithm implementing a local-structure measure should inherit from this class
  * so they can be used in the MultiScaleHessianEnhancementImageFilter framework.
+ *
+ * For previews, UseLookupTable replaces the exponentials of the measure with a
+ * NegativeExponentialLookupTable. The output then differs from the exact measure by
+ * at most LookupTableMaximumError.
+ *
+ * If FlatBlocks is set, the eigenvalues of the flat blocks are zero and the measure of zero
+ * eigenvalues is written over them without evaluating every pixel. With a mask, this is only
+ * done if that measure is zero, which is the value outside of the mask.
  * 
  * \sa MultiScaleHessianEnhancementImageFilter
  * \sa EigenToMeasureParameterEstimationFilter
@@ -98,14 +108,54 @@ public:
   } EigenValueOrderType;
   virtual EigenValueOrderType GetEigenValueOrder() const = 0;
 
+  /** Set/Get whether the exponentials are approximated with a lookup table. Default is off. */
+  itkSetMacro(UseLookupTable, bool);
+  itkGetConstMacro(UseLookupTable, bool);
+  itkBooleanMacro(UseLookupTable);
+
+  /** Set/Get the largest error of the measure when a lookup table is used. Default is 1e-3. */
+  itkSetClampMacro(LookupTableMaximumError, double, 1e-12, 1.0);
+  itkGetConstMacro(LookupTableMaximumError, double);
+
+  /** Set/Get the blocks whose eigenvalues are zero. Default is none. */
+  using FlatBlockMapType = FlatBlockMap< ImageDimension >;
+  itkSetConstObjectMacro(FlatBlocks, FlatBlockMapType);
+  itkGetConstObjectMacro(FlatBlocks, FlatBlockMapType);
+
 protected:
-  EigenToMeasureImageFilter() {};
+  EigenToMeasureImageFilter() :
+    m_UseLookupTable(false),
+    m_LookupTableMaximumError(1e-3)
+  {};
   virtual ~EigenToMeasureImageFilter() {}
 
   virtual OutputImagePixelType ProcessPixel(const InputImagePixelType& pixel) = 0;
 
+  /** Build the lookup table for the current maximum error. Subclasses must call this method. */
+  void BeforeThreadedGenerateData() override;
+
+  /** Evaluate \f$ e^{-t} \f$ for a non-negative argument, from the table when it is used */
+  inline double NegativeExponential(double t) const
+  {
+    return m_UseLookupTable ? m_LookupTable.Evaluate(t) : std::exp(-t);
+  }
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Allocate the output with the module's first touch policy. */
+  void AllocateOutputs() override;
+
   /** Multi-thread version GenerateData. */
   void DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  /** Evaluate the measure of every pixel of a region of the output. */
+  void MeasureRegion(const OutputImageRegionType & outputRegion);
+
+private:
+  bool                                    m_UseLookupTable;
+  double                                  m_LookupTableMaximumError;
+  NegativeExponentialLookupTable          m_LookupTable;
+  typename FlatBlockMapType::ConstPointer m_FlatBlocks;
 }; // end class
 } /* end namespace */
 
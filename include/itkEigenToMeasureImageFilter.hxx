@@ -20,15 +20,76 @@
 #define itkEigenToMeasureImageFilter_hxx
 
 #include "itkEigenToMeasureImageFilter.h"
-#include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkImageRegionIterator.h"
+#include "itkImageScanlineIterator.h"
+#include "itkParallelFirstTouchAllocator.h"
 
 namespace itk {
 
+template< typename TInputImage, typename TOutputImage >
+void
+EigenToMeasureImageFilter< TInputImage, TOutputImage >
+::AllocateOutputs()
+{
+  OutputImageType * outputPtr = this->GetOutput(0);
+  outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
+  ParallelFirstTouchAllocator::Allocate(outputPtr, this);
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+EigenToMeasureImageFilter< TInputImage, TOutputImage >
+::BeforeThreadedGenerateData()
+{
+  /* The measures multiply three factors, so each one may carry a third of the error */
+  if ( m_UseLookupTable )
+  {
+    m_LookupTable.SetMaximumError(m_LookupTableMaximumError / 3.0);
+  }
+}
+
 template< typename TInputImage, typename TOutputImage >
 void
 EigenToMeasureImageFilter< TInputImage, TOutputImage >
 ::DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread)
+{
+  if ( !m_FlatBlocks )
+  {
+    this->MeasureRegion(outputRegionForThread);
+    return;
+  }
+
+  /* The eigenvalues of flat blocks are zero, so their measure is the same everywhere */
+  InputImagePixelType zero;
+  zero.Fill(NumericTraits< PixelValueType >::ZeroValue());
+  const OutputImagePixelType flatValue = this->ProcessPixel(zero);
+  const bool fillFlatBlocks = !this->GetMask() || flatValue == NumericTraits< OutputImagePixelType >::ZeroValue();
+
+  OutputImagePointer outputPtr = this->GetOutput(0);
+  m_FlatBlocks->VisitBlocks(outputRegionForThread, [this, &outputPtr, flatValue, fillFlatBlocks](const OutputImageRegionType & part, bool flat)
+  {
+    if ( !flat || !fillFlatBlocks )
+    {
+      this->MeasureRegion(part);
+      return;
+    }
+
+    ImageScanlineIterator< TOutputImage > outputIt(outputPtr, part);
+    while ( !outputIt.IsAtEnd() )
+    {
+      while ( !outputIt.IsAtEndOfLine() )
+      {
+        outputIt.Set(flatValue);
+        ++outputIt;
+      }
+      outputIt.NextLine();
+    }
+  });
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+EigenToMeasureImageFilter< TInputImage, TOutputImage >
+::MeasureRegion(const OutputImageRegionType & outputRegionForThread)
 {
   /* Get Inputs */
   InputImageConstPointer  inputPtr = this->GetInput(0);
@@ -43,28 +104,49 @@ EigenToMeasureImageFilter< TInputImage, TOutputImage >
   this->CallCopyOutputRegionToInputRegion(inputRegionForThread, outputRegionForThread);
 
   // Define the iterators
-  ImageRegionConstIteratorWithIndex< TInputImage >  inputIt(inputPtr, inputRegionForThread);
-  ImageRegionIterator< TOutputImage >               outputIt(outputPtr, outputRegionForThread);
-
-  inputIt.GoToBegin();
-  outputIt.GoToBegin();
+  ImageScanlineConstIterator< TInputImage > inputIt(inputPtr, inputRegionForThread);
+  ImageScanlineIterator< TOutputImage >     outputIt(outputPtr, outputRegionForThread);
 
   while ( !inputIt.IsAtEnd() )
   {
-    inputPtr->TransformIndexToPhysicalPoint(inputIt.GetIndex(), point);
-    if ((!maskPointer) || (maskPointer->IsInsideInObjectSpace(point)))
+    /* Check for an abort request once per line */
+    if ( this->GetAbortGenerateData() )
     {
-      outputIt.Set( ProcessPixel( inputIt.Get() ) );
+      throw ProcessAborted(__FILE__, __LINE__);
     }
-    else
+
+    typename InputImageType::IndexType index = inputIt.GetIndex();
+    while ( !inputIt.IsAtEndOfLine() )
     {
-      outputIt.Set( NumericTraits< OutputImagePixelType >::Zero );
+      inputPtr->TransformIndexToPhysicalPoint(index, point);
+      if ((!maskPointer) || (maskPointer->IsInsideInObjectSpace(point)))
+      {
+        outputIt.Set( ProcessPixel( inputIt.Get() ) );
+      }
+      else
+      {
+        outputIt.Set( NumericTraits< OutputImagePixelType >::Zero );
+      }
+      ++inputIt;
+      ++outputIt;
+      ++index[0];
     }
-    ++inputIt;
-    ++outputIt;
+    inputIt.NextLine();
+    outputIt.NextLine();
   }
 }
 
+template< typename TInputImage, typename TOutputImage >
+void
+EigenToMeasureImageFilter< TInputImage, TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "UseLookupTable: " << m_UseLookupTable << std::endl;
+  os << indent << "LookupTableMaximumError: " << m_LookupTableMaximumError << std::endl;
+  os << indent << "FlatBlocks: " << m_FlatBlocks.GetPointer() << std::endl;
+}
+
 } /* end namespace */
 
 #endif /* itkEigenToMeasureImageFilter_hxx */
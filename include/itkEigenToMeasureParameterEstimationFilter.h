@@ -99,6 +99,16 @@ public:
   itkSetInputMacro(Mask, MaskSpatialObjectType);
   itkGetInputMacro(Mask, MaskSpatialObjectType);
 
+  /**
+   * Set/Get whether the input is copied to the output image. Default is on. When off, only the
+   * parameters are estimated and the output image is left empty. A downstream filter then has to
+   * read the eigenvalues from the upstream pipeline again, but the eigenvalue image is never held
+   * in memory as a whole.
+   */
+  itkSetMacro(CopyInputToOutput, bool);
+  itkGetConstMacro(CopyInputToOutput, bool);
+  itkBooleanMacro(CopyInputToOutput);
+
   /** Override UpdateOutputData() from StreamingImageFilter to divide
    * upstream updates into pieces. This filter does not have a GenerateData()
    * or ThreadedGenerateData() method.  Instead, all the work is done
@@ -117,6 +127,9 @@ protected:
   virtual ~EigenToMeasureParameterEstimationFilter() {}
 
   void PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  bool m_CopyInputToOutput;
 }; //end class
 } // end namespace
 
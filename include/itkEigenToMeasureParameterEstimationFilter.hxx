@@ -24,14 +24,15 @@
 #include "itkImageAlgorithm.h"
 #include "itkImageRegionSplitterSlowDimension.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkParallelFirstTouchAllocator.h"
 
 namespace itk
 {
 
 template< typename TInputImage, typename TOutputImage >
 EigenToMeasureParameterEstimationFilter< TInputImage, TOutputImage >
-::EigenToMeasureParameterEstimationFilter()
+::EigenToMeasureParameterEstimationFilter() :
+  m_CopyInputToOutput(true)
 {
   /* Set stream parameters */
   this->SetNumberOfStreamDivisions(10);
@@ -77,11 +78,22 @@ EigenToMeasureParameterEstimationFilter< TInputImage, TOutputImage >
   this->UpdateProgress(0.0);
   this->m_Updating = true;
 
-  /** Allocate the output buffer. */
+  /** Allocate the output buffer. Without a copy, the output is left empty. */
   OutputImageType      *outputPtr = this->GetOutput(0);
   const OutputImageRegionType outputRegion = outputPtr->GetRequestedRegion();
-  outputPtr->SetBufferedRegion(outputRegion);
-  outputPtr->Allocate();
+  if ( m_CopyInputToOutput )
+  {
+    outputPtr->SetBufferedRegion(outputRegion);
+    ParallelFirstTouchAllocator::Allocate(outputPtr, this);
+  }
+  else
+  {
+    typename OutputImageRegionType::SizeType emptySize;
+    emptySize.Fill(0);
+    OutputImageRegionType emptyRegion = outputRegion;
+    emptyRegion.SetSize(emptySize);
+    outputPtr->SetBufferedRegion(emptyRegion);
+  }
 
   /** Grab the input */
   InputImageType * inputPtr = const_cast < InputImageType * >(this->GetInput(0));
@@ -109,40 +121,55 @@ EigenToMeasureParameterEstimationFilter< TInputImage, TOutputImage >
 
   /**
    * Loop over the number of pieces, execute the upstream pipeline on each
-   * piece, and copy the results into the output image.
+   * piece, and copy the results into the output image. An abort request is
+   * checked between pieces, by the upstream filters and once per line when
+   * processing a piece.
    */
-  for (unsigned int piece=0;
-       piece < numDivisions && !this->GetAbortGenerateData();
-       piece++ )
+  try
   {
-    /* Determine the split region and calculate the input */
-    InputImageRegionType streamRegion;
-    this->CallCopyOutputRegionToInputRegion(streamRegion, outputRegion);
-
-    this->GetRegionSplitter()->GetSplit(piece, numDivisions, streamRegion);
-    inputPtr->SetRequestedRegion(streamRegion);
-    inputPtr->PropagateRequestedRegion();
-    inputPtr->UpdateOutputData();
-
-    /* Process this chunk */
-    this->ThreadedGenerateData(streamRegion, piece);
-    
-    /* Update progress and stream another chunk */
-    this->UpdateProgress( static_cast<float>(piece) / static_cast<float>(numDivisions) );
+    for (unsigned int piece=0; piece < numDivisions; piece++ )
+    {
+      if ( this->GetAbortGenerateData() )
+      {
+        throw ProcessAborted(__FILE__, __LINE__);
+      }
+
+      /* Determine the split region and calculate the input */
+      InputImageRegionType streamRegion;
+      this->CallCopyOutputRegionToInputRegion(streamRegion, outputRegion);
+
+      this->GetRegionSplitter()->GetSplit(piece, numDivisions, streamRegion);
+      inputPtr->SetRequestedRegion(streamRegion);
+      inputPtr->PropagateRequestedRegion();
+      inputPtr->UpdateOutputData();
+
+      /* Process this chunk */
+      this->ThreadedGenerateData(streamRegion, piece);
+      
+      /* Update progress and stream another chunk */
+      this->UpdateProgress( static_cast<float>(piece) / static_cast<float>(numDivisions) );
+    }
+  }
+  catch ( ProcessAborted & )
+  {
+    /* Free the partial output and let observers know we stopped */
+    outputPtr->ReleaseData();
+    this->InvokeEvent( AbortEvent() );
+    this->ResetPipeline();
+    throw;
+  }
+  catch ( ... )
+  {
+    outputPtr->ReleaseData();
+    this->ResetPipeline();
+    throw;
   }
 
   // Call a method that can be overridden by a subclass to perform
   // some calculations after all the threads have completed
   this->AfterThreadedGenerateData();
 
-  /**
-   * If we ended due to aborting, push the progress up to 1.0
-   * (since it probably didn't end there)
-   */
-  if ( !this->GetAbortGenerateData() )
-  {
-    this->UpdateProgress(1.0);
-  }
+  this->UpdateProgress(1.0);
 
   /** Notify end event observers */
   this->InvokeEvent( EndEvent() );
@@ -183,6 +210,7 @@ EigenToMeasureParameterEstimationFilter< TInputImage, TOutputImage >
 ::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
+  os << indent << "CopyInputToOutput: " << m_CopyInputToOutput << std::endl;
 }
 
 } // end namespace itk
@@ -0,0 +1,172 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkFlatBlockMap_h
+#define itkFlatBlockMap_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkProcessObject.h"
+#include "itkImageRegion.h"
+#include <vector>
+
+namespace itk
+{
+/** \class FlatBlockMap
+ * \brief Blocks of an image whose intensity range is small enough to skip the Hessian.
+ *
+ * Large parts of CT volumes, such as air, soft tissue and marrow, are nearly uniform. The
+ * normalized Hessian of a region whose values lie within a range R is bounded by about R/2
+ * whatever the sigma, so the Hessian, eigenvalues and measure of such a region can be written
+ * directly instead of computed.
+ *
+ * The largest possible region of an image is split into blocks of BlockSize pixels, the last
+ * block along a dimension being cropped to the region. ComputeBlockRanges( ) finds the minimum
+ * and maximum of every block in one parallel pass over the image. ComputeFlatBlocks( ) then
+ * creates a map for one kernel radius, in which a block is flat if the range over the blocks
+ * within the radius of it is at most a threshold. The blocks within the radius are found on
+ * the small grid of blocks, so a map for every sigma costs nothing compared to the image.
+ *
+ * VisitBlocks( ) splits a region at the block boundaries and tells whether each part is flat,
+ * which is how the filters skip the flat blocks.
+ *
+ * \sa MultiScaleHessianEnhancementImageFilter
+ * \sa HessianGaussianImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template< unsigned int VDimension >
+class ITK_TEMPLATE_EXPORT FlatBlockMap
+  : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(FlatBlockMap);
+
+  /** Standard Self type alias */
+  using Self          = FlatBlockMap;
+  using Superclass    = Object;
+  using Pointer       = SmartPointer< Self >;
+  using ConstPointer  = SmartPointer< const Self >;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FlatBlockMap, Object);
+
+  /** Region related type alias. */
+  itkStaticConstMacro(ImageDimension, unsigned int, VDimension);
+  using RegionType  = ImageRegion< VDimension >;
+  using SizeType    = typename RegionType::SizeType;
+  using IndexType   = typename RegionType::IndexType;
+
+  /** Set/Get the size of the blocks in pixels. Default is 16 along every dimension. */
+  itkSetMacro(BlockSize, SizeType);
+  itkGetConstReferenceMacro(BlockSize, SizeType);
+
+  /** Get the region split into blocks, the largest possible region of the image. */
+  itkGetConstReferenceMacro(Region, RegionType);
+
+  /** Get the number of blocks along each dimension. */
+  itkGetConstReferenceMacro(GridSize, SizeType);
+
+  /**
+   * Compute the minimum and maximum of every block of the largest possible region of a scalar
+   * image, which must be buffered. The work is split with the multi-threader of the filter.
+   */
+  template< typename TImage >
+  void ComputeBlockRanges(const TImage * image, ProcessObject * filter);
+
+  /**
+   * Compute the ranges of an image streamed along the slowest dimension. InitializeBlockRanges( )
+   * splits the region into blocks, then ComputeBlockRowRanges( ) computes the ranges of one row of
+   * blocks, those with the same block index along the slowest dimension. Only the region of the
+   * row, given by GetBlockRowRegion( ), must be buffered. Every row must be computed before
+   * ComputeFlatBlocks( ).
+   */
+  void InitializeBlockRanges(const RegionType & region);
+  RegionType GetBlockRowRegion(SizeValueType row) const;
+  template< typename TImage >
+  void ComputeBlockRowRanges(const TImage * image, SizeValueType row, ProcessObject * filter);
+
+  /**
+   * Create a map with the same blocks in which a block is flat if the range over every block
+   * within radius pixels of it is at most threshold. Throws if the ranges were not computed.
+   */
+  Pointer ComputeFlatBlocks(const SizeType & radius, double threshold) const;
+
+  /** Whether a block is flat, numbered with the first dimension fastest. */
+  bool IsFlat(SizeValueType block) const
+  {
+    return !m_Flat.empty() && m_Flat[block] != 0;
+  }
+
+  /** Number of blocks */
+  SizeValueType GetNumberOfBlocks() const
+  {
+    return m_Minimum.empty() ? m_Flat.size() : m_Minimum.size();
+  }
+
+  /** Number of flat blocks and of the pixels they cover */
+  itkGetConstMacro(NumberOfFlatBlocks, SizeValueType);
+  itkGetConstMacro(NumberOfFlatPixels, SizeValueType);
+
+  /**
+   * Call function(part, flat) for the part of every block within region, in order of the
+   * blocks. The region must be inside Region.
+   */
+  template< typename TFunction >
+  void VisitBlocks(const RegionType & region, TFunction function) const;
+
+  /**
+   * Compute the bounding region of the parts of the blocks within region which are not
+   * flat. Returns false if they are all flat.
+   */
+  bool GetNonFlatRegion(const RegionType & region, RegionType & nonFlatRegion) const;
+
+protected:
+  FlatBlockMap();
+  ~FlatBlockMap() override {}
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Region of a block, cropped to Region */
+  RegionType GetBlockRegion(const IndexType & blockIndex) const;
+
+  /** Compute the ranges of the blocks numbered from firstBlock up to endBlock */
+  template< typename TImage >
+  void ComputeRangesOfBlocks(const TImage * image, SizeValueType firstBlock, SizeValueType endBlock,
+                             ProcessObject * filter);
+
+  SizeType              m_BlockSize;
+  RegionType            m_Region;
+  SizeType              m_GridSize;
+  std::vector< double > m_Minimum;
+  std::vector< double > m_Maximum;
+  std::vector< char >   m_Flat;
+  SizeValueType         m_NumberOfFlatBlocks;
+  SizeValueType         m_NumberOfFlatPixels;
+}; // end class
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkFlatBlockMap.hxx"
+#endif
+
+#endif // itkFlatBlockMap_h
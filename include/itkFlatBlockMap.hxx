@@ -0,0 +1,353 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkFlatBlockMap_hxx
+#define itkFlatBlockMap_hxx
+
+#include "itkFlatBlockMap.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+
+namespace itk
+{
+template< unsigned int VDimension >
+FlatBlockMap< VDimension >
+::FlatBlockMap()
+{
+  m_BlockSize.Fill(16);
+  m_GridSize.Fill(0);
+  m_NumberOfFlatBlocks = 0;
+  m_NumberOfFlatPixels = 0;
+}
+
+template< unsigned int VDimension >
+template< typename TImage >
+void
+FlatBlockMap< VDimension >
+::ComputeBlockRanges(const TImage * image, ProcessObject * filter)
+{
+  if ( !image )
+  {
+    itkExceptionMacro(<< "An image is needed to compute the block ranges");
+  }
+  const RegionType region = image->GetLargestPossibleRegion();
+  if ( !image->GetBufferedRegion().IsInside(region) )
+  {
+    itkExceptionMacro(<< "The largest possible region " << region << " of the image must be buffered");
+  }
+
+  this->InitializeBlockRanges(region);
+  this->ComputeRangesOfBlocks(image, 0, m_Minimum.size(), filter);
+}
+
+template< unsigned int VDimension >
+void
+FlatBlockMap< VDimension >
+::InitializeBlockRanges(const RegionType & region)
+{
+  SizeValueType numberOfBlocks = 1;
+  for ( unsigned int d = 0; d < VDimension; ++d )
+  {
+    if ( m_BlockSize[d] == 0 )
+    {
+      itkExceptionMacro(<< "BlockSize must be positive, got " << m_BlockSize);
+    }
+    m_GridSize[d] = ( region.GetSize(d) + m_BlockSize[d] - 1 ) / m_BlockSize[d];
+    numberOfBlocks *= m_GridSize[d];
+  }
+  m_Region = region;
+  m_Minimum.assign(numberOfBlocks, 0.0);
+  m_Maximum.assign(numberOfBlocks, 0.0);
+  m_Flat.clear();
+  m_NumberOfFlatBlocks = 0;
+  m_NumberOfFlatPixels = 0;
+  this->Modified();
+}
+
+template< unsigned int VDimension >
+typename FlatBlockMap< VDimension >::RegionType
+FlatBlockMap< VDimension >
+::GetBlockRowRegion(SizeValueType row) const
+{
+  const unsigned int slowest = VDimension - 1;
+  if ( row >= m_GridSize[slowest] )
+  {
+    itkExceptionMacro(<< "Row " << row << " is outside the grid of " << m_GridSize[slowest] << " rows");
+  }
+  RegionType rowRegion = m_Region;
+  const SizeValueType start = row * m_BlockSize[slowest];
+  rowRegion.SetIndex(slowest, m_Region.GetIndex(slowest) + static_cast< IndexValueType >( start ));
+  rowRegion.SetSize(slowest, std::min< SizeValueType >( m_BlockSize[slowest], m_Region.GetSize(slowest) - start ));
+  return rowRegion;
+}
+
+template< unsigned int VDimension >
+template< typename TImage >
+void
+FlatBlockMap< VDimension >
+::ComputeBlockRowRanges(const TImage * image, SizeValueType row, ProcessObject * filter)
+{
+  if ( !image )
+  {
+    itkExceptionMacro(<< "An image is needed to compute the block ranges");
+  }
+  const RegionType rowRegion = this->GetBlockRowRegion(row);
+  if ( !image->GetBufferedRegion().IsInside(rowRegion) )
+  {
+    itkExceptionMacro(<< "The region " << rowRegion << " of row " << row << " must be buffered");
+  }
+
+  /* Blocks are numbered with the first dimension fastest, so a row is a run of blocks */
+  const SizeValueType blocksPerRow = m_Minimum.size() / m_GridSize[VDimension - 1];
+  this->ComputeRangesOfBlocks(image, row * blocksPerRow, ( row + 1 ) * blocksPerRow, filter);
+}
+
+template< unsigned int VDimension >
+template< typename TImage >
+void
+FlatBlockMap< VDimension >
+::ComputeRangesOfBlocks(const TImage * image, SizeValueType firstBlock, SizeValueType endBlock, ProcessObject * filter)
+{
+  /* Every block is reduced by one work unit */
+  MultiThreaderBase::Pointer multiThreader = filter ? filter->GetMultiThreader() : MultiThreaderBase::New();
+  if ( filter )
+  {
+    multiThreader->SetNumberOfWorkUnits(filter->GetNumberOfWorkUnits());
+  }
+  multiThreader->ParallelizeArray(
+    firstBlock,
+    endBlock,
+    [this, image](SizeValueType block)
+    {
+    IndexType blockIndex;
+    SizeValueType remainder = block;
+    for ( unsigned int d = 0; d < VDimension; ++d )
+      {
+      blockIndex[d] = static_cast< IndexValueType >( remainder % m_GridSize[d] );
+      remainder /= m_GridSize[d];
+      }
+
+    double minimum = NumericTraits< double >::max();
+    double maximum = NumericTraits< double >::NonpositiveMin();
+    ImageScanlineConstIterator< TImage > it(image, this->GetBlockRegion(blockIndex));
+    while ( !it.IsAtEnd() )
+      {
+      while ( !it.IsAtEndOfLine() )
+        {
+        const double value = static_cast< double >( it.Get() );
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+        ++it;
+        }
+      it.NextLine();
+      }
+    m_Minimum[block] = minimum;
+    m_Maximum[block] = maximum;
+    },
+    nullptr);
+  this->Modified();
+}
+
+template< unsigned int VDimension >
+typename FlatBlockMap< VDimension >::Pointer
+FlatBlockMap< VDimension >
+::ComputeFlatBlocks(const SizeType & radius, double threshold) const
+{
+  if ( m_Minimum.empty() )
+  {
+    itkExceptionMacro(<< "The block ranges must be computed before the flat blocks");
+  }
+
+  Pointer flatBlocks = Self::New();
+  flatBlocks->m_BlockSize = m_BlockSize;
+  flatBlocks->m_Region = m_Region;
+  flatBlocks->m_GridSize = m_GridSize;
+
+  /* Extend the range of every block to the blocks within the radius, one dimension at a time */
+  std::vector< double > minimum(m_Minimum);
+  std::vector< double > maximum(m_Maximum);
+  SizeValueType stride = 1;
+  for ( unsigned int d = 0; d < VDimension; ++d )
+  {
+    const SizeValueType reach = ( radius[d] + m_BlockSize[d] - 1 ) / m_BlockSize[d];
+    const SizeValueType length = m_GridSize[d];
+    if ( reach > 0 && length > 1 )
+    {
+      std::vector< double > lineMinimum(length);
+      std::vector< double > lineMaximum(length);
+      const SizeValueType numberOfLines = minimum.size() / length;
+      for ( SizeValueType l = 0; l < numberOfLines; ++l )
+      {
+        const SizeValueType start = ( l / stride ) * stride * length + ( l % stride );
+        for ( SizeValueType i = 0; i < length; ++i )
+        {
+          lineMinimum[i] = minimum[start + i * stride];
+          lineMaximum[i] = maximum[start + i * stride];
+        }
+        for ( SizeValueType i = 0; i < length; ++i )
+        {
+          const SizeValueType first = ( i > reach ) ? i - reach : 0;
+          const SizeValueType last = std::min(i + reach, length - 1);
+          minimum[start + i * stride] = *std::min_element(lineMinimum.begin() + first, lineMinimum.begin() + last + 1);
+          maximum[start + i * stride] = *std::max_element(lineMaximum.begin() + first, lineMaximum.begin() + last + 1);
+        }
+      }
+    }
+    stride *= length;
+  }
+
+  flatBlocks->m_Flat.assign(minimum.size(), 0);
+  for ( SizeValueType block = 0; block < minimum.size(); ++block )
+  {
+    if ( maximum[block] - minimum[block] > threshold )
+    {
+      continue;
+    }
+    IndexType blockIndex;
+    SizeValueType remainder = block;
+    for ( unsigned int d = 0; d < VDimension; ++d )
+    {
+      blockIndex[d] = static_cast< IndexValueType >( remainder % m_GridSize[d] );
+      remainder /= m_GridSize[d];
+    }
+    flatBlocks->m_Flat[block] = 1;
+    flatBlocks->m_NumberOfFlatBlocks += 1;
+    flatBlocks->m_NumberOfFlatPixels += this->GetBlockRegion(blockIndex).GetNumberOfPixels();
+  }
+  return flatBlocks;
+}
+
+template< unsigned int VDimension >
+template< typename TFunction >
+void
+FlatBlockMap< VDimension >
+::VisitBlocks(const RegionType & region, TFunction function) const
+{
+  if ( region.GetNumberOfPixels() == 0 )
+  {
+    return;
+  }
+
+  IndexType firstBlock;
+  IndexType lastBlock;
+  for ( unsigned int d = 0; d < VDimension; ++d )
+  {
+    const IndexValueType offset = region.GetIndex(d) - m_Region.GetIndex(d);
+    firstBlock[d] = offset / static_cast< IndexValueType >( m_BlockSize[d] );
+    lastBlock[d] = ( offset + static_cast< IndexValueType >( region.GetSize(d) ) - 1 ) / static_cast< IndexValueType >( m_BlockSize[d] );
+  }
+
+  IndexType blockIndex = firstBlock;
+  while ( true )
+  {
+    SizeValueType block = 0;
+    SizeValueType stride = 1;
+    for ( unsigned int d = 0; d < VDimension; ++d )
+    {
+      block += static_cast< SizeValueType >( blockIndex[d] ) * stride;
+      stride *= m_GridSize[d];
+    }
+    RegionType part = this->GetBlockRegion(blockIndex);
+    part.Crop(region);
+    function(static_cast< const RegionType & >( part ), this->IsFlat(block));
+
+    /* Next block with the first dimension fastest */
+    unsigned int d = 0;
+    for ( ; d < VDimension; ++d )
+    {
+      if ( blockIndex[d] < lastBlock[d] )
+      {
+        ++blockIndex[d];
+        break;
+      }
+      blockIndex[d] = firstBlock[d];
+    }
+    if ( d == VDimension )
+    {
+      break;
+    }
+  }
+}
+
+template< unsigned int VDimension >
+bool
+FlatBlockMap< VDimension >
+::GetNonFlatRegion(const RegionType & region, RegionType & nonFlatRegion) const
+{
+  bool found = false;
+  IndexType lower;
+  IndexType upper;
+  this->VisitBlocks(region, [&found, &lower, &upper](const RegionType & part, bool flat)
+    {
+    if ( flat )
+      {
+      return;
+      }
+    for ( unsigned int d = 0; d < VDimension; ++d )
+      {
+      const IndexValueType first = part.GetIndex(d);
+      const IndexValueType last = first + static_cast< IndexValueType >( part.GetSize(d) ) - 1;
+      lower[d] = found ? std::min(lower[d], first) : first;
+      upper[d] = found ? std::max(upper[d], last) : last;
+      }
+    found = true;
+    });
+
+  if ( found )
+  {
+    for ( unsigned int d = 0; d < VDimension; ++d )
+    {
+      nonFlatRegion.SetIndex(d, lower[d]);
+      nonFlatRegion.SetSize(d, static_cast< SizeValueType >( upper[d] - lower[d] + 1 ));
+    }
+  }
+  return found;
+}
+
+template< unsigned int VDimension >
+typename FlatBlockMap< VDimension >::RegionType
+FlatBlockMap< VDimension >
+::GetBlockRegion(const IndexType & blockIndex) const
+{
+  RegionType blockRegion;
+  for ( unsigned int d = 0; d < VDimension; ++d )
+  {
+    const SizeValueType start = static_cast< SizeValueType >( blockIndex[d] ) * m_BlockSize[d];
+    blockRegion.SetIndex(d, m_Region.GetIndex(d) + static_cast< IndexValueType >( start ));
+    blockRegion.SetSize(d, std::min< SizeValueType >( m_BlockSize[d], m_Region.GetSize(d) - start ));
+  }
+  return blockRegion;
+}
+
+template< unsigned int VDimension >
+void
+FlatBlockMap< VDimension >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "BlockSize: " << m_BlockSize << std::endl;
+  os << indent << "Region: " << m_Region << std::endl;
+  os << indent << "GridSize: " << m_GridSize << std::endl;
+  os << indent << "NumberOfFlatBlocks: " << m_NumberOfFlatBlocks << std::endl;
+  os << indent << "NumberOfFlatPixels: " << m_NumberOfFlatPixels << std::endl;
+}
+
+} // end namespace itk
+
+#endif // itkFlatBlockMap_hxx
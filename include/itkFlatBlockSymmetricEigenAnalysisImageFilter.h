@@ -0,0 +1,87 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkFlatBlockSymmetricEigenAnalysisImageFilter_h
+#define itkFlatBlockSymmetricEigenAnalysisImageFilter_h
+
+#include "itkSymmetricEigenAnalysisImageFilter.h"
+#include "itkFlatBlockMap.h"
+
+namespace itk
+{
+/** \class FlatBlockSymmetricEigenAnalysisImageFilter
+ * \brief Eigenvalue analysis which writes zero eigenvalues over flat blocks.
+ *
+ * The Hessian of a flat block is zero, so are its eigenvalues. If FlatBlocks is set, each
+ * region of a work unit is split at the block boundaries and the flat parts are filled with
+ * zeros instead of being decomposed. Without a map, this is SymmetricEigenAnalysisImageFilter.
+ *
+ * \sa FlatBlockMap
+ * \sa MultiScaleHessianEnhancementImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template< typename TInputImage, typename TOutputImage >
+class ITK_TEMPLATE_EXPORT FlatBlockSymmetricEigenAnalysisImageFilter
+  : public SymmetricEigenAnalysisImageFilter< TInputImage, TOutputImage >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(FlatBlockSymmetricEigenAnalysisImageFilter);
+
+  /** Standard Self type alias */
+  using Self          = FlatBlockSymmetricEigenAnalysisImageFilter;
+  using Superclass    = SymmetricEigenAnalysisImageFilter< TInputImage, TOutputImage >;
+  using Pointer       = SmartPointer< Self >;
+  using ConstPointer  = SmartPointer< const Self >;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FlatBlockSymmetricEigenAnalysisImageFilter, SymmetricEigenAnalysisImageFilter);
+
+  /** Image related type alias. */
+  using OutputImageType       = TOutputImage;
+  using OutputImageRegionType = typename OutputImageType::RegionType;
+  using OutputPixelType       = typename OutputImageType::PixelType;
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Set/Get the blocks whose eigenvalues are written as zero. Default is none. */
+  using FlatBlockMapType = FlatBlockMap< ImageDimension >;
+  itkSetConstObjectMacro(FlatBlocks, FlatBlockMapType);
+  itkGetConstObjectMacro(FlatBlocks, FlatBlockMapType);
+
+protected:
+  FlatBlockSymmetricEigenAnalysisImageFilter() {}
+  ~FlatBlockSymmetricEigenAnalysisImageFilter() override {}
+
+  /** Decompose the parts of the region which are not flat and fill the others with zeros. */
+  void DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  typename FlatBlockMapType::ConstPointer m_FlatBlocks;
+}; // end class
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkFlatBlockSymmetricEigenAnalysisImageFilter.hxx"
+#endif
+
+#endif // itkFlatBlockSymmetricEigenAnalysisImageFilter_h
@@ -0,0 +1,72 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkFlatBlockSymmetricEigenAnalysisImageFilter_hxx
+#define itkFlatBlockSymmetricEigenAnalysisImageFilter_hxx
+
+#include "itkFlatBlockSymmetricEigenAnalysisImageFilter.h"
+#include "itkImageScanlineIterator.h"
+
+namespace itk
+{
+template< typename TInputImage, typename TOutputImage >
+void
+FlatBlockSymmetricEigenAnalysisImageFilter< TInputImage, TOutputImage >
+::DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread)
+{
+  if ( !m_FlatBlocks )
+  {
+    Superclass::DynamicThreadedGenerateData(outputRegionForThread);
+    return;
+  }
+
+  OutputImageType * outputPtr = this->GetOutput();
+  OutputPixelType zero;
+  zero.Fill(NumericTraits< typename OutputPixelType::ValueType >::ZeroValue());
+  m_FlatBlocks->VisitBlocks(outputRegionForThread, [this, outputPtr, &zero](const OutputImageRegionType & part, bool flat)
+  {
+    if ( !flat )
+    {
+      Superclass::DynamicThreadedGenerateData(part);
+      return;
+    }
+
+    ImageScanlineIterator< OutputImageType > outputIt(outputPtr, part);
+    while ( !outputIt.IsAtEnd() )
+    {
+      while ( !outputIt.IsAtEndOfLine() )
+      {
+        outputIt.Set(zero);
+        ++outputIt;
+      }
+      outputIt.NextLine();
+    }
+  });
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+FlatBlockSymmetricEigenAnalysisImageFilter< TInputImage, TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "FlatBlocks: " << m_FlatBlocks.GetPointer() << std::endl;
+}
+
+} // end namespace itk
+
+#endif // itkFlatBlockSymmetricEigenAnalysisImageFilter_hxx
@@ -24,6 +24,9 @@
 #include "itkImage.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkPixelTraits.h"
+#include "itkFlatBlockMap.h"
+#include <deque>
+#include <vector>
 
 namespace itk {
 /** \class HessianGaussianImageFilter
@@ -38,7 +41,61 @@ namespace itk {
  * 
  * This class is an exact copy of HessianRecursiveGaussianImageFilter
  * but with streaming.
+ *
+ * For interactive previews, the HessianMethod can be set to BoxApproximation.
+ * The image is then smoothed along each dimension by NumberOfBoxPasses running sum
+ * box filters, which cost O(1) per voxel and pass regardless of sigma, and the
+ * Hessian is taken by central differences of the smoothed image. The box widths
+ * are odd and chosen as by Kovesi, so the variance of the cascade matches
+ * \f$ \sigma^2 \f$ to within \f$ (w+1)/6 \f$ squared pixels, w being the narrower
+ * width. The cascade converges to the Gaussian as the number of passes grows;
+ * three passes are within a few percent of the Gaussian kernel. The central
+ * differences add a truncation error of order \f$ h^2 \f$ with respect to the
+ * derivatives of the smoothed image. Both methods scale the result in the same way.
+ *
+ * The HessianMethod SmoothThenFiniteDifference smooths the padded requested region
+ * once with the discrete Gaussian of GaussianOperator, one pass per dimension, and takes
+ * all second derivatives by central differences of the smoothed image. This replaces
+ * the \f$ D(D+1)/2 \f$ separable derivative convolutions of the exact method, each of D
+ * passes, by D passes and one stencil pass, and can be streamed. For a structure whose
+ * smoothed profile has standard deviation s, the three point stencil of the second
+ * derivative has a relative error of about \f$ h^2 / (4 s^2) \f$, h being the spacing
+ * along the derivative. Since s is at least sigma, the relative error is at most about
+ * 25% at a sigma of one voxel, 6% at two voxels and 1.6% at four voxels, and lower for
+ * structures wider than sigma. The mixed derivatives have an error of the same order.
+ * Along a dimension of finer spacing the error is smaller for the same physical sigma.
+ * The incremental scale space below has the same accuracy.
+ *
+ * Over an increasing sequence of sigma values, the HessianMethod can be set to
+ * IncrementalScaleSpace. The filter then keeps the whole input smoothed at the last
+ * sigma and, since \f$ G(\sigma_k) = G(\sqrt{\sigma_k^2 - \sigma_{k-1}^2}) * G(\sigma_{k-1}) \f$,
+ * only smooths it by the increment for the next sigma. The discrete Gaussian kernel
+ * of GaussianOperator has this semigroup property exactly, up to the truncation set by
+ * MaximumError. The Hessian is taken by central differences of the smoothed image, so
+ * the cost per sigma depends on the increment instead of the sigma. The whole input is
+ * requested, but streaming the output only takes differences of the kept image. The
+ * kept image is smoothed from the input again when the input is updated or the sigma
+ * decreases, and is freed by ReleaseScaleSpace( ).
  * 
+ * For streaming large volumes along the slowest dimension, the HessianMethod can be
+ * set to SlidingSlab. It computes the same result as SmoothThenFiniteDifference but
+ * keeps a ring buffer of input planes smoothed across the faster dimensions. Each
+ * plane is smoothed once and every piece of the output is finished from the planes
+ * within the kernel radius of it. Pieces which advance along the slowest dimension,
+ * as produced by ImageRegionSplitterSlowDimension, reuse the planes of the previous
+ * piece, so the planes held never exceed the piece thickness plus 2r + 2, r being
+ * the radius of the kernel. Pieces which do not span the faster dimensions are
+ * smoothed on their own. The planes are kept while the pipeline of the input is
+ * not modified, even if a streamed upstream filter executes again for every piece.
+ * The planes are freed by ReleaseScaleSpace( ).
+ *
+ * If FlatBlocks is set, the output is zero over the flat blocks of the map. The exact
+ * method only computes the derivatives over the bounding region of the other blocks and
+ * the methods based on central differences skip the differences of the flat blocks. The
+ * smoothing passes of these methods are not skipped, since every smoothed line crosses
+ * blocks which are not flat. The map must have been computed for the kernel radius of
+ * the current sigma over the largest possible region of the input.
+ *
  * \sa HessianRecursiveGaussianImageFilter.
  * 
  * \author: Bryce Besler
@@ -114,6 +171,65 @@ public:
   bool GetNormalizeAcrossScale() const;
   itkBooleanMacro(NormalizeAcrossScale);
 
+  /** Method used to compute the Hessian */
+  typedef enum {
+    ExactGaussian = 0,
+    BoxApproximation,
+    IncrementalScaleSpace,
+    SmoothThenFiniteDifference,
+    SlidingSlab
+  } HessianMethodType;
+  itkSetMacro(HessianMethod, HessianMethodType);
+  itkGetConstMacro(HessianMethod, HessianMethodType);
+  void SetHessianMethodToExactGaussian()
+  {
+    this->SetHessianMethod(ExactGaussian);
+  }
+  void SetHessianMethodToBoxApproximation()
+  {
+    this->SetHessianMethod(BoxApproximation);
+  }
+  void SetHessianMethodToIncrementalScaleSpace()
+  {
+    this->SetHessianMethod(IncrementalScaleSpace);
+  }
+  void SetHessianMethodToSmoothThenFiniteDifference()
+  {
+    this->SetHessianMethod(SmoothThenFiniteDifference);
+  }
+  void SetHessianMethodToSlidingSlab()
+  {
+    this->SetHessianMethod(SlidingSlab);
+  }
+
+  /** Set/Get the number of box filters applied along each dimension by the box approximation. Default is 3. */
+  itkSetClampMacro(NumberOfBoxPasses, unsigned int, 1, 10);
+  itkGetConstMacro(NumberOfBoxPasses, unsigned int);
+
+  /** Widths in pixels of the box filters applied along a dimension by the box
+   * approximation, for the current sigma and input spacing. The input must be set. */
+  using BoxWidthsType = std::vector< unsigned int >;
+  BoxWidthsType GetBoxWidths(unsigned int dimension) const;
+
+  /** Sigma at which the image kept by IncrementalScaleSpace is smoothed, zero if none is kept. */
+  itkGetConstMacro(ScaleSpaceSigma, RealType);
+
+  /** Largest number of planes held by SlidingSlab since the planes were last released. */
+  itkGetConstMacro(MaximumNumberOfSlabPlanes, SizeValueType);
+
+  /** Set/Get the blocks of the input whose Hessian is written as zero. Default is none. */
+  using FlatBlockMapType = FlatBlockMap< ImageDimension >;
+  itkSetConstObjectMacro(FlatBlocks, FlatBlockMapType);
+  itkGetConstObjectMacro(FlatBlocks, FlatBlockMapType);
+
+  /** Free the smoothed image kept by IncrementalScaleSpace and the planes kept by SlidingSlab. */
+  void ReleaseScaleSpace();
+
+  /** Radius of the kernel in each dimension for the current method, sigma and
+   * input spacing. The input must be set. */
+  using RadiusType = typename TInputImage::SizeType;
+  RadiusType GetKernelRadius() const;
+
   /** As opposed to HessianRecursiveGaussianImageFilter, HessianGaussianImageFilter
    * doe not need all of the input to produce an output. However, it does need to
    * expand the InputRequestedRegion region to account for the support of the
@@ -137,10 +253,57 @@ protected:
   /** Generate Data */
   void GenerateData(void) override;
 
+  /** Compute the Hessian with box filters or a Gaussian over the padded region and central differences */
+  void GenerateSmoothedFiniteDifference();
+
+  /** Compute the Hessian by smoothing the kept image by the increment of sigma and central differences */
+  void GenerateIncrementalScaleSpace();
+
+  /** Compute the Hessian of a piece from the ring buffer of smoothed planes and central differences */
+  void GenerateSlidingSlab();
+
 private:
+  /** Apply a function in place to every line along a dimension of a buffer of the given size */
+  template< typename TLineFunction >
+  void FilterLinesAlongDimension(InternalRealType * buffer, const typename TInputImage::SizeType & size,
+                                 unsigned int dimension, TLineFunction lineFunction);
+
+  /** Apply the box filters of one dimension in place to a buffer of the given size */
+  void BoxSmoothAlongDimension(InternalRealType * buffer, const typename TInputImage::SizeType & size,
+                               unsigned int dimension, const BoxWidthsType & widths);
+
+  /** Coefficients of the discrete Gaussian of a variance in pixels along a dimension */
+  std::vector< double > GetGaussianKernel(unsigned int dimension, double variance) const;
+
+  /** Apply a discrete Gaussian of a variance in pixels in place along one dimension of a buffer */
+  void GaussianSmoothAlongDimension(InternalRealType * buffer, const typename TInputImage::SizeType & size,
+                                    unsigned int dimension, double variance);
+
+  /** Write the central differences of a smoothed buffer over the requested region of the output */
+  void ComputeCentralDifferences(const InternalRealType * buffer, const typename TInputImage::RegionType & bufferRegion);
+
   /** Internal filters **/
   DerivativeFilterPointer   m_DerivativeFilter;
   OutputImageAdaptorPointer m_ImageAdaptor;
+
+  /** Box approximation */
+  HessianMethodType         m_HessianMethod;
+  unsigned int              m_NumberOfBoxPasses;
+
+  /** Smoothed input kept by the incremental scale space */
+  typename RealImageType::Pointer m_ScaleSpaceImage;
+  RealType                        m_ScaleSpaceSigma;
+  const InputImageType *          m_ScaleSpaceInput;
+  ModifiedTimeType                m_ScaleSpaceInputTime;
+
+  /** Planes smoothed across the faster dimensions kept by the sliding slab */
+  std::deque< std::vector< InternalRealType > > m_SlabPlanes;
+  IndexValueType                                m_SlabFirstPlane;
+  RealType                                      m_SlabSigma;
+  SizeValueType                                 m_MaximumNumberOfSlabPlanes;
+
+  /** Blocks skipped because they are flat */
+  typename FlatBlockMapType::ConstPointer       m_FlatBlocks;
 }; //end class
 } // end namespace 
 
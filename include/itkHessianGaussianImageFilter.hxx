@@ -20,10 +20,14 @@
 #define itkHessianGaussianImageFilter_hxx
 
 #include "itkHessianGaussianImageFilter.h"
-#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageScanlineIterator.h"
+#include "itkParallelFirstTouchAllocator.h"
 #include "itkProgressAccumulator.h"
 #include "itkGaussianDerivativeOperator.h"
+#include "itkGaussianOperator.h"
 #include "itkMath.h"
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -46,6 +50,9 @@ HessianGaussianImageFilter< TInputImage, TOutputImage >
   // Setup defaults
   this->SetNormalizeAcrossScale(false);
   this->SetSigma(1.0);
+  m_HessianMethod = ExactGaussian;
+  m_NumberOfBoxPasses = 3;
+  this->ReleaseScaleSpace();
 }
 
 /**
@@ -98,26 +105,88 @@ HessianGaussianImageFilter< TInputImage, TOutputImage >
 }
 
 template< typename TInputImage, typename TOutputImage >
-void
+typename HessianGaussianImageFilter< TInputImage, TOutputImage >::BoxWidthsType
 HessianGaussianImageFilter< TInputImage, TOutputImage >
-::GenerateInputRequestedRegion()
+::GetBoxWidths(unsigned int dimension) const
 {
-  // call the superclass' implementation of this method. this should
-  // copy the output requested region to the input requested region
-  Superclass::GenerateInputRequestedRegion();
+  if ( !this->GetInput() )
+    {
+    itkExceptionMacro(<< "Input must be set to determine the box widths");
+    }
+  const double spacing = this->GetInput()->GetSpacing()[dimension];
+  if ( spacing == 0.0 )
+    {
+    itkExceptionMacro(<< "Pixel spacing cannot be zero");
+    }
 
-  // get pointers to the input
-  typename Superclass::InputImagePointer inputPtr =
-    const_cast< TInputImage * >( this->GetInput() );
+  // Sigma in pixels along this dimension
+  const double sigma = static_cast< double >( this->GetSigma() ) / spacing;
+  const double twelveVariance = 12.0 * sigma * sigma;
+  const int    passes = static_cast< int >( m_NumberOfBoxPasses );
 
-  if ( !inputPtr )
+  // A box of odd width w has variance (w^2 - 1) / 12. Take the odd widths below and above
+  // the ideal one and use as many of each as best matches the variance (Kovesi).
+  int lower = static_cast< int >( std::floor( std::sqrt( twelveVariance / passes + 1.0 ) ) );
+  if ( lower % 2 == 0 )
     {
-    return;
+    --lower;
+    }
+  lower = std::max(lower, 1);
+  const int upper = lower + 2;
+  int numberOfLower = Math::Round< int >(
+    ( passes * lower * lower + 4.0 * passes * lower + 3.0 * passes - twelveVariance ) / ( 4.0 * lower + 4.0 ) );
+  numberOfLower = std::min(std::max(numberOfLower, 0), passes);
+
+  BoxWidthsType widths(m_NumberOfBoxPasses, static_cast< unsigned int >( upper ));
+  std::fill(widths.begin(), widths.begin() + numberOfLower, static_cast< unsigned int >( lower ));
+  return widths;
+}
+
+template< typename TInputImage, typename TOutputImage >
+typename HessianGaussianImageFilter< TInputImage, TOutputImage >::RadiusType
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GetKernelRadius() const
+{
+  if ( !this->GetInput() )
+    {
+    itkExceptionMacro(<< "Input must be set to determine the kernel radius");
+    }
+
+  RadiusType radius;
+
+  // The box filters reach half their width each and the central differences one more pixel
+  if ( m_HessianMethod == BoxApproximation )
+    {
+    for ( unsigned int i = 0; i < TInputImage::ImageDimension; i++ )
+      {
+      radius[i] = 1;
+      for ( unsigned int width : this->GetBoxWidths(i) )
+        {
+        radius[i] += ( width - 1 ) / 2;
+        }
+      }
+    return radius;
+    }
+
+  // The smoothing kernel reaches its radius and the central differences one more pixel
+  if ( m_HessianMethod == IncrementalScaleSpace || m_HessianMethod == SmoothThenFiniteDifference
+       || m_HessianMethod == SlidingSlab )
+    {
+    for ( unsigned int i = 0; i < TInputImage::ImageDimension; i++ )
+      {
+      const double spacing = this->GetInput()->GetSpacing()[i];
+      if ( spacing == 0.0 )
+        {
+        itkExceptionMacro(<< "Pixel spacing cannot be zero");
+        }
+      const double sigma = this->GetSigma();
+      radius[i] = this->GetGaussianKernel(i, sigma * sigma / ( spacing * spacing )).size() / 2 + 1;
+      }
+    return radius;
     }
 
   // Build an operator so that we can determine the kernel size
   GaussianDerivativeOperator< InternalRealType, ImageDimension >  oper;
-  typename TInputImage::SizeType                                  radius;
 
   for ( unsigned int i = 0; i < TInputImage::ImageDimension; i++ )
     {
@@ -141,8 +210,40 @@ HessianGaussianImageFilter< TInputImage, TOutputImage >
     oper.CreateDirectional();
 
     radius[i] = oper.GetRadius(i);
+
     }
 
+  return radius;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion()
+{
+  // call the superclass' implementation of this method. this should
+  // copy the output requested region to the input requested region
+  Superclass::GenerateInputRequestedRegion();
+
+  // get pointers to the input
+  typename Superclass::InputImagePointer inputPtr =
+    const_cast< TInputImage * >( this->GetInput() );
+
+  if ( !inputPtr )
+    {
+    return;
+    }
+
+  // The incremental scale space keeps the whole input smoothed
+  if ( m_HessianMethod == IncrementalScaleSpace )
+    {
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+    return;
+    }
+
+  // Determine the kernel size
+  const RadiusType radius = this->GetKernelRadius();
+
   // get a copy of the input requested region (should equal the output
   // requested region)
   typename TInputImage::RegionType inputRequestedRegion;
@@ -184,6 +285,22 @@ HessianGaussianImageFilter< TInputImage, TOutputImage >
 {
   itkDebugMacro(<< "HessianGaussianImageFilter generating data ");
 
+  if ( m_HessianMethod == BoxApproximation || m_HessianMethod == SmoothThenFiniteDifference )
+    {
+    this->GenerateSmoothedFiniteDifference();
+    return;
+    }
+  if ( m_HessianMethod == IncrementalScaleSpace )
+    {
+    this->GenerateIncrementalScaleSpace();
+    return;
+    }
+  if ( m_HessianMethod == SlidingSlab )
+    {
+    this->GenerateSlidingSlab();
+    return;
+    }
+
   // Create a process accumulator for tracking the progress of this
   // minipipeline
   ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
@@ -212,63 +329,769 @@ HessianGaussianImageFilter< TInputImage, TOutputImage >
   m_ImageAdaptor->SetRequestedRegion(
     this->GetOutput()->GetRequestedRegion() );
 
-  m_ImageAdaptor->Allocate();
+  ParallelFirstTouchAllocator::Allocate(this->GetOutput(), this);
+
+  // The derivatives are only needed over the blocks which are not flat
+  const FlatBlockMapType * flatBlocks = m_FlatBlocks;
+  typename TOutputImage::RegionType derivativeRegion = this->GetOutput()->GetRequestedRegion();
+  if ( flatBlocks && !flatBlocks->GetNonFlatRegion(this->GetOutput()->GetRequestedRegion(), derivativeRegion) )
+    {
+    OutputPixelType zero;
+    zero.Fill( NumericTraits< OutputComponentType >::ZeroValue() );
+    this->GetOutput()->FillBuffer(zero);
+    return;
+    }
 
   m_DerivativeFilter->SetInput(inputImage);
-  m_DerivativeFilter->GetOutput()->SetRequestedRegion(this->GetOutput()->GetRequestedRegion());
+  m_DerivativeFilter->GetOutput()->SetRequestedRegion(derivativeRegion);
 
   unsigned int element = 0;
   int order[ImageDimension];
 
-  for ( unsigned int dima = 0; dima < ImageDimension; dima++ )
+  try
     {
-    for ( unsigned int dimb = dima; dimb < ImageDimension; dimb++ )
+    for ( unsigned int dima = 0; dima < ImageDimension; dima++ )
+      {
+      for ( unsigned int dimb = dima; dimb < ImageDimension; dimb++ )
+      {
+        // All directions have zero order derivative initially
+        for (int k = 0; k < ImageDimension; ++k) {
+          order[k] = 0;
+        }
+
+        // Now set derivative directions. Note that this takes care
+        // of the case when dima == dimb
+        order[dima] = order[dima] + 1;
+        order[dimb] = order[dimb] + 1;
+
+        // Set order and update
+        m_DerivativeFilter->SetOrder(order);
+        m_DerivativeFilter->Update();
+        typename RealImageType::Pointer derivativeImage;
+        derivativeImage = m_DerivativeFilter->GetOutput();
+
+        // Copy the results to the corresponding component
+        // on the output image of vectors
+        m_ImageAdaptor->SelectNthElement(element++);
+
+        const RealType spacingA = inputImage->GetSpacing()[dima];
+        const RealType spacingB = inputImage->GetSpacing()[dimb];
+
+        const RealType factor = spacingA * spacingB;
+
+        // Copy in parallel with the same split as the first touch of the output
+        OutputImageAdaptorType * adaptor = m_ImageAdaptor;
+        this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+        this->GetMultiThreader()->template ParallelizeImageRegion< ImageDimension >(
+          m_ImageAdaptor->GetRequestedRegion(),
+          [this, adaptor, derivativeImage, factor, flatBlocks](const typename TOutputImage::RegionType & region)
+          {
+          auto copyPart = [this, adaptor, derivativeImage, factor](const typename TOutputImage::RegionType & part, bool flat)
+            {
+            ImageScanlineIterator< OutputImageAdaptorType > ot( adaptor, part );
+
+            // Flat blocks are zero and have no derivative
+            if ( flat )
+              {
+              while ( !ot.IsAtEnd() )
+                {
+                while ( !ot.IsAtEndOfLine() )
+                  {
+                  ot.Set( NumericTraits< InternalRealType >::ZeroValue() );
+                  ++ot;
+                  }
+                ot.NextLine();
+                }
+              return;
+              }
+
+            ImageScanlineConstIterator< RealImageType > it( derivativeImage, part );
+            while ( !it.IsAtEnd() )
+              {
+              // Check for an abort request once per line
+              if ( this->GetAbortGenerateData() )
+                {
+                return;
+                }
+
+              while ( !it.IsAtEndOfLine() )
+                {
+                ot.Set(it.Get() / factor);
+                ++it;
+                ++ot;
+                }
+              it.NextLine();
+              ot.NextLine();
+              }
+            };
+
+          if ( flatBlocks )
+            {
+            flatBlocks->VisitBlocks(region, copyPart);
+            }
+          else
+            {
+            copyPart(region, false);
+            }
+          },
+          nullptr);
+
+        if ( this->GetAbortGenerateData() )
+          {
+          throw ProcessAborted(__FILE__, __LINE__);
+          }
+
+        derivativeImage->ReleaseData();
+        }
+      }
+    }
+  catch ( ProcessAborted & )
+    {
+    // Free the intermediate and partial results right away
+    m_DerivativeFilter->GetOutput()->ReleaseData();
+    this->GetOutput()->ReleaseData();
+    throw;
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+template< typename TLineFunction >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::FilterLinesAlongDimension(InternalRealType * buffer, const typename TInputImage::SizeType & size,
+                            unsigned int dimension, TLineFunction lineFunction)
+{
+  SizeValueType stride = 1;
+  for ( unsigned int k = 0; k < dimension; k++ )
     {
-      // All directions have zero order derivative initially
-      for (int k = 0; k < ImageDimension; ++k) {
-        order[k] = 0;
+    stride *= size[k];
+    }
+  SizeValueType numberOfPixels = 1;
+  for ( unsigned int k = 0; k < ImageDimension; k++ )
+    {
+    numberOfPixels *= size[k];
+    }
+  const SizeValueType length = size[dimension];
+  if ( numberOfPixels == 0 || length < 2 )
+    {
+    return;
+    }
+  const SizeValueType numberOfLines = numberOfPixels / length;
+  const SizeValueType numberOfChunks = std::min< SizeValueType >( this->GetNumberOfWorkUnits(), numberOfLines );
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [this, buffer, stride, length, numberOfLines, numberOfChunks, &lineFunction](SizeValueType chunk)
+    {
+    // Lines are filtered in double so running sums do not drift along long lines
+    std::vector< double > line(length);
+    std::vector< double > smoothed(length);
+    const SizeValueType firstLine = chunk * numberOfLines / numberOfChunks;
+    const SizeValueType lastLine = ( chunk + 1 ) * numberOfLines / numberOfChunks;
+
+    for ( SizeValueType l = firstLine; l < lastLine; l++ )
+      {
+      // Check for an abort request once per line
+      if ( this->GetAbortGenerateData() )
+        {
+        return;
+        }
+
+      // Lines along the dimension start in every slab of the dimensions above it
+      InternalRealType * start = buffer + ( l / stride ) * stride * length + ( l % stride );
+      for ( SizeValueType i = 0; i < length; i++ )
+        {
+        line[i] = start[i * stride];
+        }
+
+      lineFunction(line, smoothed);
+
+      for ( SizeValueType i = 0; i < length; i++ )
+        {
+        start[i * stride] = static_cast< InternalRealType >( line[i] );
+        }
       }
+    },
+    nullptr);
 
-      // Now set derivative directions. Note that this takes care
-      // of the case when dima == dimb
-      order[dima] = order[dima] + 1;
-      order[dimb] = order[dimb] + 1;
+  if ( this->GetAbortGenerateData() )
+    {
+    throw ProcessAborted(__FILE__, __LINE__);
+    }
+}
 
-      // Set order and update
-      m_DerivativeFilter->SetOrder(order);
-      m_DerivativeFilter->Update();
-      typename RealImageType::Pointer derivativeImage;
-      derivativeImage = m_DerivativeFilter->GetOutput();
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::BoxSmoothAlongDimension(InternalRealType * buffer, const typename TInputImage::SizeType & size,
+                          unsigned int dimension, const BoxWidthsType & widths)
+{
+  const IndexValueType last = static_cast< IndexValueType >( size[dimension] ) - 1;
+  this->FilterLinesAlongDimension(
+    buffer,
+    size,
+    dimension,
+    [last, &widths](std::vector< double > & line, std::vector< double > & smoothed)
+    {
+    // Each pass is a running sum with the edge pixels repeated
+    for ( unsigned int width : widths )
+      {
+      const IndexValueType radius = static_cast< IndexValueType >( width - 1 ) / 2;
+      if ( radius == 0 )
+        {
+        continue;
+        }
+      auto clamped = [&line, last](IndexValueType i) -> double
+        {
+        return line[std::min(std::max(i, IndexValueType(0)), last)];
+        };
+      double sum = 0.0;
+      for ( IndexValueType j = -radius; j <= radius; j++ )
+        {
+        sum += clamped(j);
+        }
+      smoothed[0] = sum / width;
+      for ( IndexValueType i = 1; i <= last; i++ )
+        {
+        sum += clamped(i + radius) - clamped(i - radius - 1);
+        smoothed[i] = sum / width;
+        }
+      line.swap(smoothed);
+      }
+    });
+}
 
-      // Copy the results to the corresponding component
-      // on the output image of vectors
-      m_ImageAdaptor->SelectNthElement(element++);
+template< typename TInputImage, typename TOutputImage >
+std::vector< double >
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GetGaussianKernel(unsigned int dimension, double variance) const
+{
+  // The discrete Gaussian kernel, truncated as the derivative kernels are
+  GaussianOperator< double, 1 > oper;
+  oper.SetVariance(variance);
+  oper.SetMaximumError(m_DerivativeFilter->GetMaximumError()[dimension]);
+  oper.SetMaximumKernelWidth(m_DerivativeFilter->GetMaximumKernelWidth());
+  oper.CreateDirectional();
+  return std::vector< double >(oper.Begin(), oper.End());
+}
 
-      ImageRegionIteratorWithIndex< RealImageType > it(
-        derivativeImage,
-        derivativeImage->GetRequestedRegion() );
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GaussianSmoothAlongDimension(InternalRealType * buffer, const typename TInputImage::SizeType & size,
+                               unsigned int dimension, double variance)
+{
+  const std::vector< double > kernel = this->GetGaussianKernel(dimension, variance);
+  const IndexValueType radius = static_cast< IndexValueType >( kernel.size() / 2 );
+  if ( radius == 0 )
+    {
+    return;
+    }
 
-      ImageRegionIteratorWithIndex< OutputImageAdaptorType > ot(
-        m_ImageAdaptor,
-        m_ImageAdaptor->GetRequestedRegion() );
+  const IndexValueType last = static_cast< IndexValueType >( size[dimension] ) - 1;
+  this->FilterLinesAlongDimension(
+    buffer,
+    size,
+    dimension,
+    [last, radius, &kernel](std::vector< double > & line, std::vector< double > & smoothed)
+    {
+    // Convolve with the edge pixels repeated
+    for ( IndexValueType i = 0; i <= last; i++ )
+      {
+      double sum = 0.0;
+      for ( IndexValueType j = -radius; j <= radius; j++ )
+        {
+        sum += kernel[j + radius] * line[std::min(std::max(i + j, IndexValueType(0)), last)];
+        }
+      smoothed[i] = sum;
+      }
+    line.swap(smoothed);
+    });
+}
 
-      const RealType spacingA = inputImage->GetSpacing()[dima];
-      const RealType spacingB = inputImage->GetSpacing()[dimb];
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::ComputeCentralDifferences(const InternalRealType * buffer, const typename TInputImage::RegionType & bufferRegion)
+{
+  using RegionType = typename TInputImage::RegionType;
+  using SizeType = typename TInputImage::SizeType;
+  using IndexType = typename TInputImage::IndexType;
 
-      const RealType factor = spacingA * spacingB;
+  const InputImageType * inputImage = this->GetInput();
+  TOutputImage * outputImage = this->GetOutput();
+  const RegionType outputRegion = outputImage->GetRequestedRegion();
+  const SizeType  bufferSize = bufferRegion.GetSize();
+  const IndexType bufferIndex = bufferRegion.GetIndex();
 
-      it.GoToBegin();
-      ot.GoToBegin();
-      while ( !it.IsAtEnd() )
+  OffsetValueType strides[ImageDimension];
+  OffsetValueType stride = 1;
+  for ( unsigned int k = 0; k < ImageDimension; k++ )
+    {
+    strides[k] = stride;
+    stride *= static_cast< OffsetValueType >( bufferSize[k] );
+    }
+
+  // Scale as the exact method does: the derivative operators divide by the spacing and the
+  // components are divided by it once more, with the scale-space factor if requested
+  RealType scales[ImageDimension][ImageDimension];
+  const RealType sigma = this->GetSigma();
+  const RealType norm = this->GetNormalizeAcrossScale() ? sigma * sigma : NumericTraits< RealType >::OneValue();
+  for ( unsigned int a = 0; a < ImageDimension; a++ )
+    {
+    for ( unsigned int b = 0; b < ImageDimension; b++ )
+      {
+      const RealType factor = inputImage->GetSpacing()[a] * inputImage->GetSpacing()[b];
+      scales[a][b] = norm / ( factor * factor );
+      }
+    }
+
+  // Central differences of the smoothed image, with the edge pixels repeated
+  this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  this->GetMultiThreader()->template ParallelizeImageRegion< ImageDimension >(
+    outputRegion,
+    [this, outputImage, buffer, &strides, &bufferIndex, &bufferSize, &scales](const RegionType & region)
+    {
+    auto differencePart = [this, outputImage, buffer, &strides, &bufferIndex, &bufferSize, &scales](const RegionType & part, bool flat)
+      {
+      ImageScanlineIterator< TOutputImage > ot( outputImage, part );
+
+      // Flat blocks are zero
+      if ( flat )
+        {
+        OutputPixelType zero;
+        zero.Fill( NumericTraits< OutputComponentType >::ZeroValue() );
+        while ( !ot.IsAtEnd() )
+          {
+          while ( !ot.IsAtEndOfLine() )
+            {
+            ot.Set(zero);
+            ++ot;
+            }
+          ot.NextLine();
+          }
+        return;
+        }
+
+      OffsetValueType plus[ImageDimension];
+      OffsetValueType minus[ImageDimension];
+      while ( !ot.IsAtEnd() )
+        {
+        // Check for an abort request once per line
+        if ( this->GetAbortGenerateData() )
+          {
+          return;
+          }
+
+        IndexType index = ot.GetIndex();
+        while ( !ot.IsAtEndOfLine() )
+          {
+          OffsetValueType offset = 0;
+          for ( unsigned int k = 0; k < ImageDimension; k++ )
+            {
+            const IndexValueType local = index[k] - bufferIndex[k];
+            offset += local * strides[k];
+            plus[k] = ( local + 1 < static_cast< IndexValueType >( bufferSize[k] ) ) ? strides[k] : 0;
+            minus[k] = ( local > 0 ) ? strides[k] : 0;
+            }
+          const InternalRealType * center = buffer + offset;
+
+          OutputPixelType pixel;
+          unsigned int element = 0;
+          for ( unsigned int a = 0; a < ImageDimension; a++ )
+            {
+            for ( unsigned int b = a; b < ImageDimension; b++ )
+              {
+              double value;
+              if ( a == b )
+                {
+                value = static_cast< double >( center[plus[a]] ) - 2.0 * center[0] + center[-minus[a]];
+                }
+              else
+                {
+                value = ( static_cast< double >( center[plus[a] + plus[b]] ) - center[plus[a] - minus[b]]
+                          - center[-minus[a] + plus[b]] + center[-minus[a] - minus[b]] ) / 4.0;
+                }
+              pixel[element++] = static_cast< OutputComponentType >( value * scales[a][b] );
+              }
+            }
+          ot.Set(pixel);
+          ++ot;
+          ++index[0];
+          }
+        ot.NextLine();
+        }
+      };
+
+    if ( m_FlatBlocks )
+      {
+      m_FlatBlocks->VisitBlocks(region, differencePart);
+      }
+    else
+      {
+      differencePart(region, false);
+      }
+    },
+    nullptr);
+
+  if ( this->GetAbortGenerateData() )
+    {
+    this->GetOutput()->ReleaseData();
+    throw ProcessAborted(__FILE__, __LINE__);
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GenerateSmoothedFiniteDifference()
+{
+  using RegionType = typename TInputImage::RegionType;
+  using SizeType = typename TInputImage::SizeType;
+  using IndexType = typename TInputImage::IndexType;
+
+  const InputImageType * inputImage = this->GetInput();
+  TOutputImage * outputImage = this->GetOutput();
+  const RegionType outputRegion = outputImage->GetRequestedRegion();
+  outputImage->SetBufferedRegion(outputRegion);
+  ParallelFirstTouchAllocator::Allocate(outputImage, this);
+
+  // Smooth a copy of the input padded by the kernel radius
+  RegionType paddedRegion = outputRegion;
+  paddedRegion.PadByRadius( this->GetKernelRadius() );
+  paddedRegion.Crop( inputImage->GetLargestPossibleRegion() );
+  const SizeType  paddedSize = paddedRegion.GetSize();
+  const IndexType paddedIndex = paddedRegion.GetIndex();
+
+  std::vector< InternalRealType > smoothed( paddedRegion.GetNumberOfPixels() );
+  InternalRealType * buffer = smoothed.data();
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  this->GetMultiThreader()->template ParallelizeImageRegion< ImageDimension >(
+    paddedRegion,
+    [inputImage, buffer, &paddedIndex, &paddedSize](const RegionType & region)
+    {
+    ImageScanlineConstIterator< InputImageType > it( inputImage, region );
+    while ( !it.IsAtEnd() )
+      {
+      const IndexType index = it.GetIndex();
+      OffsetValueType offset = 0;
+      OffsetValueType stride = 1;
+      for ( unsigned int k = 0; k < ImageDimension; k++ )
         {
-        ot.Set(it.Get() / factor);
+        offset += ( index[k] - paddedIndex[k] ) * stride;
+        stride *= static_cast< OffsetValueType >( paddedSize[k] );
+        }
+      InternalRealType * out = buffer + offset;
+      while ( !it.IsAtEndOfLine() )
+        {
+        *out++ = static_cast< InternalRealType >( it.Get() );
         ++it;
-        ++ot;
         }
+      it.NextLine();
+      }
+    },
+    nullptr);
+
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    if ( m_HessianMethod == BoxApproximation )
+      {
+      this->BoxSmoothAlongDimension( buffer, paddedSize, d, this->GetBoxWidths(d) );
+      }
+    else
+      {
+      const double spacing = inputImage->GetSpacing()[d];
+      const double sigma = this->GetSigma();
+      this->GaussianSmoothAlongDimension( buffer, paddedSize, d, sigma * sigma / ( spacing * spacing ) );
+      }
+    this->UpdateProgress( static_cast< float >( d + 1 ) / ( ImageDimension + 1 ) );
+    }
+
+  this->ComputeCentralDifferences( buffer, paddedRegion );
+  this->UpdateProgress(1.0f);
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GenerateIncrementalScaleSpace()
+{
+  using RegionType = typename TInputImage::RegionType;
+
+  const InputImageType * inputImage = this->GetInput();
+  TOutputImage * outputImage = this->GetOutput();
+  outputImage->SetBufferedRegion(outputImage->GetRequestedRegion());
+  ParallelFirstTouchAllocator::Allocate(outputImage, this);
+
+  // The kept image is reused for the same input data and a sigma at least as large
+  const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+  const RealType sigma = this->GetSigma();
+  if ( !m_ScaleSpaceImage || m_ScaleSpaceInput != inputImage || m_ScaleSpaceInputTime != inputImage->GetUpdateMTime()
+       || m_ScaleSpaceImage->GetBufferedRegion() != largestRegion || m_ScaleSpaceSigma > sigma )
+    {
+    this->ReleaseScaleSpace();
+    typename RealImageType::Pointer scaleSpaceImage = RealImageType::New();
+    scaleSpaceImage->CopyInformation(inputImage);
+    scaleSpaceImage->SetRegions(largestRegion);
+    ParallelFirstTouchAllocator::Allocate(scaleSpaceImage.GetPointer(), this);
+
+    RealImageType * scaleSpace = scaleSpaceImage;
+    this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+    this->GetMultiThreader()->template ParallelizeImageRegion< ImageDimension >(
+      largestRegion,
+      [inputImage, scaleSpace](const RegionType & region)
+      {
+      ImageScanlineConstIterator< InputImageType > it( inputImage, region );
+      ImageScanlineIterator< RealImageType > ot( scaleSpace, region );
+      while ( !it.IsAtEnd() )
+        {
+        while ( !it.IsAtEndOfLine() )
+          {
+          ot.Set(static_cast< InternalRealType >( it.Get() ));
+          ++it;
+          ++ot;
+          }
+        it.NextLine();
+        ot.NextLine();
+        }
+      },
+      nullptr);
+
+    m_ScaleSpaceImage = scaleSpaceImage;
+    m_ScaleSpaceInput = inputImage;
+    m_ScaleSpaceInputTime = inputImage->GetUpdateMTime();
+    }
+
+  // Smooth by the increment, which is nothing when only another piece of the output is requested
+  InternalRealType * buffer = m_ScaleSpaceImage->GetBufferPointer();
+  const double incrementVariance = static_cast< double >( sigma ) * sigma
+    - static_cast< double >( m_ScaleSpaceSigma ) * m_ScaleSpaceSigma;
+  if ( incrementVariance > 0.0 )
+    {
+    try
+      {
+      for ( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        const double spacing = inputImage->GetSpacing()[d];
+        this->GaussianSmoothAlongDimension( buffer, largestRegion.GetSize(), d, incrementVariance / ( spacing * spacing ) );
+        this->UpdateProgress( static_cast< float >( d + 1 ) / ( ImageDimension + 1 ) );
+        }
+      }
+    catch ( ProcessAborted & )
+      {
+      // The kept image is partially smoothed
+      this->ReleaseScaleSpace();
+      this->GetOutput()->ReleaseData();
+      throw;
+      }
+    m_ScaleSpaceSigma = sigma;
+    }
+
+  this->ComputeCentralDifferences( buffer, largestRegion );
+  this->UpdateProgress(1.0f);
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::GenerateSlidingSlab()
+{
+  using RegionType = typename TInputImage::RegionType;
+  using SizeType = typename TInputImage::SizeType;
+  using IndexType = typename TInputImage::IndexType;
+  const unsigned int slowest = ImageDimension - 1;
+
+  const InputImageType * inputImage = this->GetInput();
+  TOutputImage * outputImage = this->GetOutput();
+  const RegionType outputRegion = outputImage->GetRequestedRegion();
+  const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+
+  // Planes span the faster dimensions, other pieces are smoothed on their own
+  for ( unsigned int k = 0; k < slowest; k++ )
+    {
+    if ( outputRegion.GetIndex(k) != largestRegion.GetIndex(k) || outputRegion.GetSize(k) != largestRegion.GetSize(k) )
+      {
+      this->GenerateSmoothedFiniteDifference();
+      return;
+      }
+    }
+
+  outputImage->SetBufferedRegion(outputRegion);
+  ParallelFirstTouchAllocator::Allocate(outputImage, this);
+
+  // The kept planes are reused for the same input data and sigma. A streamed upstream
+  // filter executes again for every piece, so its pipeline time identifies the data.
+  const RealType sigma = this->GetSigma();
+  const ModifiedTimeType inputTime =
+    inputImage->GetSource() ? inputImage->GetPipelineMTime() : inputImage->GetUpdateMTime();
+  if ( m_ScaleSpaceInput != inputImage || m_ScaleSpaceInputTime != inputTime || m_SlabSigma != sigma )
+    {
+    this->ReleaseScaleSpace();
+    m_ScaleSpaceInput = inputImage;
+    m_ScaleSpaceInputTime = inputTime;
+    m_SlabSigma = sigma;
+    }
+
+  SizeType planeSize = largestRegion.GetSize();
+  planeSize[slowest] = 1;
+  SizeValueType planePixels = 1;
+  for ( unsigned int k = 0; k < ImageDimension; k++ )
+    {
+    planePixels *= planeSize[k];
+    }
+  const IndexValueType firstPlane = largestRegion.GetIndex(slowest);
+  const IndexValueType lastPlane = firstPlane + static_cast< IndexValueType >( largestRegion.GetSize(slowest) ) - 1;
+  const double slowestSpacing = inputImage->GetSpacing()[slowest];
+  const std::vector< double > kernel = this->GetGaussianKernel(slowest, sigma * sigma / ( slowestSpacing * slowestSpacing ));
+  const IndexValueType radius = static_cast< IndexValueType >( kernel.size() / 2 );
+
+  // Smoothed planes of the piece and one more on each side for the central differences
+  const IndexValueType pieceFirst = outputRegion.GetIndex(slowest);
+  const IndexValueType pieceLast = pieceFirst + static_cast< IndexValueType >( outputRegion.GetSize(slowest) ) - 1;
+  const IndexValueType bufferFirst = std::max(pieceFirst - 1, firstPlane);
+  const IndexValueType bufferLast = std::min(pieceLast + 1, lastPlane);
+  const IndexValueType neededFirst = std::max(bufferFirst - radius, firstPlane);
+  const IndexValueType neededLast = std::min(bufferLast + radius, lastPlane);
+
+  // Drop the planes behind the piece, or all of them if the piece is behind the ring
+  while ( !m_SlabPlanes.empty() && m_SlabFirstPlane < neededFirst )
+    {
+    m_SlabPlanes.pop_front();
+    ++m_SlabFirstPlane;
+    }
+  if ( m_SlabPlanes.empty() || m_SlabFirstPlane > neededFirst )
+    {
+    m_SlabPlanes.clear();
+    m_SlabFirstPlane = neededFirst;
+    }
+
+  // Smooth the new planes across the faster dimensions
+  for ( IndexValueType plane = m_SlabFirstPlane + static_cast< IndexValueType >( m_SlabPlanes.size() ); plane <= neededLast; plane++ )
+    {
+    m_SlabPlanes.emplace_back(planePixels);
+    InternalRealType * buffer = m_SlabPlanes.back().data();
+    RegionType planeRegion = largestRegion;
+    planeRegion.SetIndex(slowest, plane);
+    planeRegion.SetSize(slowest, 1);
+    const IndexType planeIndex = planeRegion.GetIndex();
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+    this->GetMultiThreader()->template ParallelizeImageRegion< ImageDimension >(
+      planeRegion,
+      [inputImage, buffer, &planeIndex, &planeSize](const RegionType & region)
+      {
+      ImageScanlineConstIterator< InputImageType > it( inputImage, region );
+      while ( !it.IsAtEnd() )
+        {
+        const IndexType index = it.GetIndex();
+        OffsetValueType offset = 0;
+        OffsetValueType stride = 1;
+        for ( unsigned int k = 0; k < ImageDimension; k++ )
+          {
+          offset += ( index[k] - planeIndex[k] ) * stride;
+          stride *= static_cast< OffsetValueType >( planeSize[k] );
+          }
+        InternalRealType * out = buffer + offset;
+        while ( !it.IsAtEndOfLine() )
+          {
+          *out++ = static_cast< InternalRealType >( it.Get() );
+          ++it;
+          }
+        it.NextLine();
+        }
+      },
+      nullptr);
 
-      derivativeImage->ReleaseData();
+    try
+      {
+      for ( unsigned int d = 0; d < slowest; d++ )
+        {
+        const double spacing = inputImage->GetSpacing()[d];
+        this->GaussianSmoothAlongDimension( buffer, planeSize, d, sigma * sigma / ( spacing * spacing ) );
+        }
       }
+    catch ( ProcessAborted & )
+      {
+      // The last plane is partially smoothed
+      this->ReleaseScaleSpace();
+      this->GetOutput()->ReleaseData();
+      throw;
+      }
+    m_MaximumNumberOfSlabPlanes = std::max< SizeValueType >( m_MaximumNumberOfSlabPlanes, m_SlabPlanes.size() );
     }
+  this->UpdateProgress(0.5f);
+
+  // Smooth along the slowest dimension from the ring, with the edge planes repeated
+  const SizeValueType numberOfBufferPlanes = static_cast< SizeValueType >( bufferLast - bufferFirst + 1 );
+  std::vector< InternalRealType > smoothed( numberOfBufferPlanes * planePixels );
+  InternalRealType * smoothedBuffer = smoothed.data();
+  const SizeValueType numberOfChunks = std::min< SizeValueType >( this->GetNumberOfWorkUnits(), planePixels );
+  this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [this, smoothedBuffer, planePixels, numberOfChunks, bufferFirst, bufferLast, firstPlane, lastPlane, radius, &kernel](SizeValueType chunk)
+    {
+    const SizeValueType firstPixel = chunk * planePixels / numberOfChunks;
+    const SizeValueType lastPixel = ( chunk + 1 ) * planePixels / numberOfChunks;
+    std::vector< double > sum( lastPixel - firstPixel );
+    for ( IndexValueType plane = bufferFirst; plane <= bufferLast; plane++ )
+      {
+      // Check for an abort request once per plane
+      if ( this->GetAbortGenerateData() )
+        {
+        return;
+        }
+
+      std::fill(sum.begin(), sum.end(), 0.0);
+      for ( IndexValueType j = -radius; j <= radius; j++ )
+        {
+        const IndexValueType source = std::min(std::max(plane + j, firstPlane), lastPlane);
+        const InternalRealType * in = m_SlabPlanes[source - m_SlabFirstPlane].data() + firstPixel;
+        const double weight = kernel[j + radius];
+        for ( SizeValueType p = 0; p < sum.size(); p++ )
+          {
+          sum[p] += weight * in[p];
+          }
+        }
+      InternalRealType * out = smoothedBuffer + ( plane - bufferFirst ) * planePixels + firstPixel;
+      for ( SizeValueType p = 0; p < sum.size(); p++ )
+        {
+        out[p] = static_cast< InternalRealType >( sum[p] );
+        }
+      }
+    },
+    nullptr);
+
+  if ( this->GetAbortGenerateData() )
+    {
+    this->GetOutput()->ReleaseData();
+    throw ProcessAborted(__FILE__, __LINE__);
+    }
+
+  RegionType bufferRegion = outputRegion;
+  bufferRegion.SetIndex(slowest, bufferFirst);
+  bufferRegion.SetSize(slowest, numberOfBufferPlanes);
+  this->ComputeCentralDifferences( smoothedBuffer, bufferRegion );
+  this->UpdateProgress(1.0f);
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+HessianGaussianImageFilter< TInputImage, TOutputImage >
+::ReleaseScaleSpace()
+{
+  m_ScaleSpaceImage = nullptr;
+  m_ScaleSpaceSigma = NumericTraits< RealType >::ZeroValue();
+  m_ScaleSpaceInput = nullptr;
+  m_ScaleSpaceInputTime = 0;
+  m_SlabPlanes.clear();
+  m_SlabFirstPlane = 0;
+  m_SlabSigma = NumericTraits< RealType >::ZeroValue();
+  m_MaximumNumberOfSlabPlanes = 0;
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -278,6 +1101,10 @@ HessianGaussianImageFilter< TInputImage, TOutputImage >
 {
   Superclass::PrintSelf(os, indent);
   os << "DerivativeFilter: " << m_DerivativeFilter << std::endl;
+  os << indent << "HessianMethod: " << m_HessianMethod << std::endl;
+  os << indent << "NumberOfBoxPasses: " << m_NumberOfBoxPasses << std::endl;
+  os << indent << "ScaleSpaceSigma: " << m_ScaleSpaceSigma << std::endl;
+  os << indent << "FlatBlocks: " << m_FlatBlocks.GetPointer() << std::endl;
 }
 
 } // end namespace itk
@@ -0,0 +1,404 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageBufferPool_h
+#define itkImageBufferPool_h
+
+#include "itkIntTypes.h"
+#include "itkMacro.h"
+#include "itkObject.h"
+#include "itksys/SystemTools.hxx"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace itk
+{
+/** \class ImageBufferPool
+ * \brief Module-wide pool of large image buffers.
+ *
+ * The multi-scale filter allocates and frees several volume sized buffers for every sigma
+ * value. Returning them to the system and asking for them again causes page faults on every
+ * scale. When enabled, the buffers of the filters in this module are taken from this pool and
+ * returned to it when released. A returned block is kept and handed out again for a request of
+ * a similar size, within one execution and across executions.
+ *
+ * Only requests of at least MinimumBlockSize bytes are pooled. Block sizes are rounded up to a
+ * multiple of BlockAlignment, which is the size of a huge page on x86-64, and blocks are aligned
+ * to it so that they can be backed by huge pages. A cached block is reused for any request which
+ * rounds up to between half its size and its size. Cached blocks are kept until
+ * ReleaseCachedBlocks( ) is called or their total size would exceed MaximumCachedBytes.
+ *
+ * The pool is global, thread safe and disabled by default. It can be enabled for every filter
+ * with SetGlobalEnabled( ) or by setting the environment variable ITK_BONEENHANCEMENT_BUFFER_POOL
+ * to ON. The global policies should be set before filters run, since a change is seen by
+ * every filter which allocates afterwards. A filter can instead be enabled on its own with
+ * EnableForFilter( ), which does not affect other filters running at the same time.
+ *
+ * Blocks are cached only while the pool is enabled, globally or for some filter. Once it is
+ * disabled everywhere, the cached blocks are returned to the system and blocks released later
+ * are not cached. Allocation statistics are available from GetStatistics( ).
+ *
+ * \sa PooledImportImageContainer
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+class ImageBufferPool
+{
+public:
+  /** Allocation statistics since the last ResetStatistics( ) */
+  struct Statistics
+  {
+    SizeValueType m_NumberOfRequests;
+    SizeValueType m_NumberOfReuses;
+    SizeValueType m_NumberOfSystemAllocations;
+    SizeValueType m_NumberOfSystemReleases;
+    SizeValueType m_NumberOfHugePageBlocks;
+    SizeValueType m_BytesInUse;
+    SizeValueType m_PeakBytesInUse;
+    SizeValueType m_BytesCached;
+  };
+
+  static constexpr SizeValueType BlockAlignment = 2 * 1024 * 1024;
+
+  /** Set/Get whether the filters of this module take their buffers from the pool. */
+  static void SetGlobalEnabled(bool enabled)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self::Instance().m_Enabled = enabled;
+    Self::Instance().TrimCacheIfUnused();
+  }
+  static bool GetGlobalEnabled()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    return Self::Instance().m_Enabled;
+  }
+  static void GlobalEnabledOn() { Self::SetGlobalEnabled(true); }
+  static void GlobalEnabledOff() { Self::SetGlobalEnabled(false); }
+
+  /**
+   * Set/Get whether new blocks are advised to be backed by transparent huge pages with
+   * madvise(MADV_HUGEPAGE). This only has an effect on Linux. Default is off.
+   */
+  static void SetGlobalHugePages(bool hugePages)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self::Instance().m_HugePages = hugePages;
+  }
+  static bool GetGlobalHugePages()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    return Self::Instance().m_HugePages;
+  }
+
+  /**
+   * Enable the pool for the allocations of one filter, independent of the global policy. With
+   * hugePages, new blocks of that filter are advised to be backed by transparent huge pages.
+   * Every call must be matched by a call to DisableForFilter( ).
+   */
+  static void EnableForFilter(const Object * filter, bool hugePages)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self::Instance().m_FilterPolicies.emplace(filter, hugePages);
+  }
+  static void DisableForFilter(const Object * filter)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self & pool = Self::Instance();
+    auto found = pool.m_FilterPolicies.find(filter);
+    if (found != pool.m_FilterPolicies.end())
+    {
+      pool.m_FilterPolicies.erase(found);
+    }
+    pool.TrimCacheIfUnused();
+  }
+
+  /** Whether the allocations of a filter are taken from the pool, globally or for that filter. */
+  static bool GetEnabled(const Object * filter)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self & pool = Self::Instance();
+    return pool.m_Enabled || ( filter && pool.m_FilterPolicies.count(filter) > 0 );
+  }
+
+  /** Whether new blocks of a filter are advised to be backed by huge pages, globally or for that filter. */
+  static bool GetHugePages(const Object * filter)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self & pool = Self::Instance();
+    if (pool.m_HugePages)
+    {
+      return true;
+    }
+    const auto range = pool.m_FilterPolicies.equal_range(filter);
+    return filter && std::any_of(range.first, range.second, [](const std::pair< const Object * const, bool > & policy) { return policy.second; });
+  }
+
+  /** Set/Get the smallest request in bytes which is pooled. Default is one block. */
+  static void SetMinimumBlockSize(SizeValueType size)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self::Instance().m_MinimumBlockSize = size;
+  }
+  static SizeValueType GetMinimumBlockSize()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    return Self::Instance().m_MinimumBlockSize;
+  }
+
+  /** Set/Get the largest total size in bytes of cached blocks. Default is unlimited. */
+  static void SetMaximumCachedBytes(SizeValueType size)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self::Instance().m_MaximumCachedBytes = size;
+    Self::Instance().TrimCache(size);
+  }
+  static SizeValueType GetMaximumCachedBytes()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    return Self::Instance().m_MaximumCachedBytes;
+  }
+
+  /** Whether a request of this many bytes is large enough to be served by the pool. */
+  static bool IsPooledSize(SizeValueType bytes)
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    return bytes >= Self::Instance().m_MinimumBlockSize;
+  }
+
+  /**
+   * Get a block of at least the given number of bytes. The number of bytes of the block is
+   * returned in blockSize and must be passed back to Release( ). A new block is advised to be
+   * backed by huge pages if hugePages or the global policy is on. Throws on failure.
+   */
+  static void * Acquire(SizeValueType bytes, SizeValueType & blockSize, bool hugePages = false)
+  {
+    Self & pool = Self::Instance();
+    std::lock_guard< std::mutex > lock(pool.m_Mutex);
+    pool.m_Statistics.m_NumberOfRequests += 1;
+
+    /* Best fit among the cached blocks */
+    const SizeValueType roundedBytes = ( ( bytes + BlockAlignment - 1 ) / BlockAlignment ) * BlockAlignment;
+    void * block = nullptr;
+    auto found = pool.m_CachedBlocks.lower_bound(roundedBytes);
+    if (found != pool.m_CachedBlocks.end() && found->first <= 2 * roundedBytes)
+    {
+      blockSize = found->first;
+      block = found->second;
+      pool.m_CachedBlocks.erase(found);
+      pool.m_Statistics.m_BytesCached -= blockSize;
+      pool.m_Statistics.m_NumberOfReuses += 1;
+    }
+    else
+    {
+      blockSize = roundedBytes;
+      block = pool.SystemAllocate(blockSize, hugePages || pool.m_HugePages);
+      if (!block)
+      {
+        /* Give the cache back to the system and try again */
+        pool.TrimCache(0);
+        block = pool.SystemAllocate(blockSize, hugePages || pool.m_HugePages);
+      }
+      if (!block)
+      {
+        itkGenericExceptionMacro(<< "ImageBufferPool failed to allocate " << blockSize << " bytes");
+      }
+      pool.m_Statistics.m_NumberOfSystemAllocations += 1;
+    }
+
+    pool.m_Statistics.m_BytesInUse += blockSize;
+    pool.m_Statistics.m_PeakBytesInUse = std::max(pool.m_Statistics.m_PeakBytesInUse, pool.m_Statistics.m_BytesInUse);
+    return block;
+  }
+
+  /** Return a block obtained from Acquire( ) to the pool. */
+  static void Release(void * block, SizeValueType blockSize)
+  {
+    if (!block)
+    {
+      return;
+    }
+    Self & pool = Self::Instance();
+    std::lock_guard< std::mutex > lock(pool.m_Mutex);
+    pool.m_Statistics.m_BytesInUse -= std::min(blockSize, pool.m_Statistics.m_BytesInUse);
+    if (blockSize > pool.m_MaximumCachedBytes || !pool.IsInUse())
+    {
+      Self::SystemRelease(block);
+      pool.m_Statistics.m_NumberOfSystemReleases += 1;
+      return;
+    }
+    pool.TrimCache(pool.m_MaximumCachedBytes - blockSize);
+    pool.m_CachedBlocks.emplace(blockSize, block);
+    pool.m_Statistics.m_BytesCached += blockSize;
+  }
+
+  /** Return all cached blocks to the system. Blocks in use are not affected. */
+  static void ReleaseCachedBlocks()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Self::Instance().TrimCache(0);
+  }
+
+  /** Get and reset the allocation statistics. Bytes in use and cached are not reset. */
+  static Statistics GetStatistics()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    return Self::Instance().m_Statistics;
+  }
+  static void ResetStatistics()
+  {
+    std::lock_guard< std::mutex > lock(Self::Instance().m_Mutex);
+    Statistics & statistics = Self::Instance().m_Statistics;
+    statistics.m_NumberOfRequests = 0;
+    statistics.m_NumberOfReuses = 0;
+    statistics.m_NumberOfSystemAllocations = 0;
+    statistics.m_NumberOfSystemReleases = 0;
+    statistics.m_NumberOfHugePageBlocks = 0;
+    statistics.m_PeakBytesInUse = statistics.m_BytesInUse;
+  }
+
+  static void PrintStatistics(std::ostream & os)
+  {
+    const Statistics statistics = Self::GetStatistics();
+    os << "Requests: " << statistics.m_NumberOfRequests
+       << ", Reuses: " << statistics.m_NumberOfReuses
+       << ", SystemAllocations: " << statistics.m_NumberOfSystemAllocations
+       << ", SystemReleases: " << statistics.m_NumberOfSystemReleases
+       << ", HugePageBlocks: " << statistics.m_NumberOfHugePageBlocks
+       << ", BytesInUse: " << statistics.m_BytesInUse
+       << ", PeakBytesInUse: " << statistics.m_PeakBytesInUse
+       << ", BytesCached: " << statistics.m_BytesCached;
+  }
+
+private:
+  using Self = ImageBufferPool;
+
+  ImageBufferPool()
+    : m_Enabled(Self::GetEnabledFromEnvironment()),
+      m_HugePages(false),
+      m_MinimumBlockSize(BlockAlignment),
+      m_MaximumCachedBytes(std::numeric_limits< SizeValueType >::max())
+  {
+    m_Statistics.m_NumberOfRequests = 0;
+    m_Statistics.m_NumberOfReuses = 0;
+    m_Statistics.m_NumberOfSystemAllocations = 0;
+    m_Statistics.m_NumberOfSystemReleases = 0;
+    m_Statistics.m_NumberOfHugePageBlocks = 0;
+    m_Statistics.m_BytesInUse = 0;
+    m_Statistics.m_PeakBytesInUse = 0;
+    m_Statistics.m_BytesCached = 0;
+  }
+
+  /* Never destroyed, since images may release their buffers during static destruction */
+  static Self & Instance()
+  {
+    static Self * pool = new Self;
+    return *pool;
+  }
+
+  static bool GetEnabledFromEnvironment()
+  {
+    std::string value;
+    if (!itksys::SystemTools::GetEnv("ITK_BONEENHANCEMENT_BUFFER_POOL", value))
+    {
+      return false;
+    }
+    value = itksys::SystemTools::UpperCase(value);
+    return value == "ON" || value == "1" || value == "TRUE";
+  }
+
+  /* Allocate a new block from the system. Lock must be held. */
+  void * SystemAllocate(SizeValueType bytes, bool hugePages)
+  {
+    (void)hugePages;
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, BlockAlignment);
+#else
+    void * block = nullptr;
+    if (posix_memalign(&block, BlockAlignment, bytes) != 0)
+    {
+      return nullptr;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    /* The advice has to be given before the pages are first touched */
+    if (hugePages && madvise(block, bytes, MADV_HUGEPAGE) == 0)
+    {
+      m_Statistics.m_NumberOfHugePageBlocks += 1;
+    }
+#endif
+    return block;
+#endif
+  }
+
+  static void SystemRelease(void * block)
+  {
+#if defined(_WIN32)
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+  }
+
+  /* Release the largest cached blocks until at most the given number of bytes are cached. Lock must be held. */
+  void TrimCache(SizeValueType bytes)
+  {
+    while (m_Statistics.m_BytesCached > bytes && !m_CachedBlocks.empty())
+    {
+      auto largest = std::prev(m_CachedBlocks.end());
+      m_Statistics.m_BytesCached -= largest->first;
+      Self::SystemRelease(largest->second);
+      m_Statistics.m_NumberOfSystemReleases += 1;
+      m_CachedBlocks.erase(largest);
+    }
+  }
+
+  /* Whether the pool is enabled anywhere. Lock must be held. */
+  bool IsInUse() const
+  {
+    return m_Enabled || !m_FilterPolicies.empty();
+  }
+
+  /* Return the cached blocks to the system once the pool is not enabled anywhere. Lock must be held. */
+  void TrimCacheIfUnused()
+  {
+    if (!this->IsInUse())
+    {
+      this->TrimCache(0);
+    }
+  }
+
+  std::mutex                            m_Mutex;
+  bool                                  m_Enabled;
+  bool                                  m_HugePages;
+  std::multimap< const Object *, bool > m_FilterPolicies;
+  SizeValueType                         m_MinimumBlockSize;
+  SizeValueType                         m_MaximumCachedBytes;
+  std::multimap< SizeValueType, void * > m_CachedBlocks;
+  Statistics                            m_Statistics;
+};
+} // end namespace itk
+
+#endif // itkImageBufferPool_h
@@ -118,13 +118,21 @@ protected:
 
   OutputImagePixelType ProcessPixel(const InputImagePixelType& pixel) override;
 
-  /** Check the input has the right number of parameters. */
+  /** Check the input has the right number of parameters and cache them for the threads. */
   void BeforeThreadedGenerateData() override;
 
   void PrintSelf(std::ostream & os, Indent indent) const override;
 private:
   /* Member variables */
   RealType    m_EnhanceType;
+
+  /* Parameters of the current execution and the scales of the lookup table arguments */
+  RealType    m_Alpha;
+  RealType    m_Beta;
+  RealType    m_Gamma;
+  double      m_SheetScale;
+  double      m_TubeScale;
+  double      m_NoiseScale;
 }; // end class
 } /* end namespace itk */
 
@@ -28,7 +28,13 @@ template< typename TInputImage, typename TOutputImage >
 KrcahEigenToMeasureImageFilter< TInputImage, TOutputImage >
 ::KrcahEigenToMeasureImageFilter() :
   Superclass(),
-  m_EnhanceType(-1.0f)
+  m_EnhanceType(-1.0f),
+  m_Alpha(0),
+  m_Beta(0),
+  m_Gamma(0),
+  m_SheetScale(0),
+  m_TubeScale(0),
+  m_NoiseScale(0)
 {}
 
 template< typename TInputImage, typename TOutputImage >
@@ -41,6 +47,15 @@ KrcahEigenToMeasureImageFilter< TInputImage, TOutputImage >
   {
     itkExceptionMacro(<< "Parameters must have size 3. Given array of size " << parameters.GetSize());
   }
+  Superclass::BeforeThreadedGenerateData();
+
+  /* Read the parameters once instead of for every pixel */
+  m_Alpha = parameters[0];
+  m_Beta = parameters[1];
+  m_Gamma = parameters[2];
+  m_SheetScale = 1.0 / (m_Alpha * m_Alpha);
+  m_TubeScale = 1.0 / (m_Beta * m_Beta);
+  m_NoiseScale = 1.0 / (m_Gamma * m_Gamma);
 }
 
 template< typename TInputImage, typename TOutputImage >
@@ -49,10 +64,9 @@ KrcahEigenToMeasureImageFilter< TInputImage, TOutputImage >
 ::ProcessPixel(const InputImagePixelType& pixel)
 {
   /* Grab parameters */
-  ParameterArrayType parameters = this->GetParametersInput()->Get();
-  RealType alpha = parameters[0];
-  RealType beta = parameters[1];
-  RealType gamma = parameters[2];
+  const RealType alpha = m_Alpha;
+  const RealType beta = m_Beta;
+  const RealType gamma = m_Gamma;
 
   /* Grab pixel values */
   double sheetness = 0.0;
@@ -78,6 +92,13 @@ KrcahEigenToMeasureImageFilter< TInputImage, TOutputImage >
 
   /* Multiply together to get sheetness */
   sheetness = (m_EnhanceType*a3/l3);
+  if ( this->GetUseLookupTable() )
+  {
+    sheetness *= this->NegativeExponential(Rsheet * Rsheet * m_SheetScale);
+    sheetness *= this->NegativeExponential(Rtube * Rtube * m_TubeScale);
+    sheetness *= (1.0 - this->NegativeExponential(Rnoise * Rnoise * m_NoiseScale));
+    return static_cast<OutputImagePixelType>( sheetness );
+  }
   sheetness *= std::exp(-(Rsheet * Rsheet) / (alpha * alpha));
   sheetness *= std::exp(-(Rtube * Rtube) / (beta * beta));
   sheetness *= (1.0 - std::exp(-(Rnoise * Rnoise) / (gamma * gamma)));
@@ -22,7 +22,7 @@
 #include "itkImageToImageFilter.h"
 #include "itkNumericTraits.h"
 #include "itkSimpleDataObjectDecorator.h"
-#include "itkArray.h"
+#include <vector>
 
 namespace itk {
 /** \class KrcahEigenToScalarParameterEstimationImageFilter
@@ -69,6 +69,10 @@ namespace itk {
  * are defined, parameters are estimated only in the intersection of
  * the two image regions. However, the mask region must be a proper sub
  * subset (contained) in the image region.
+ *
+ * Before the threads run, the bounding box of the mask foreground is computed.
+ * Only this region is split between the work units, so no thread visits slabs
+ * without foreground. The work units accumulate into separate cache lines.
  * 
  * \sa KrcahEigenToScalarImageFilter
  * 
@@ -120,6 +124,9 @@ public:
   itkSetMacro(BackgroundValue, MaskPixelType);
   itkGetConstMacro(BackgroundValue, MaskPixelType);
 
+  /** Get the region which was visited by the last update. This is the bounding box of the mask foreground. */
+  itkGetConstReferenceMacro(ForegroundRegion, InputRegionType);
+
   typedef enum {
     UseImplementationParameters = 1,
     UseJournalParameters
@@ -175,16 +182,17 @@ protected:
   /** Pass the input through unmodified. Do this by Grafting in the AllocateOutputs method. */
   void AllocateOutputs() override;
 
-  /** Initialize some accumulators before the threads run. */
+  /** Compute the foreground region and initialize the accumulators before the threads run. */
   void BeforeThreadedGenerateData() override;
 
   /** Do final mean and variance computation from data accumulated in threads. */
   void AfterThreadedGenerateData() override;
 
-  /** Multi-thread version GenerateData. */
-  void  ThreadedGenerateData(const OutputRegionType &
-                             outputRegionForThread,
-                             ThreadIdType threadId) override;
+  /** Split the foreground region between the work units instead of the whole output region. */
+  void GenerateData() override;
+
+  /** Compute the bounding box of the mask foreground inside the requested region. */
+  InputRegionType ComputeForegroundRegion() const;
 
   /** Override since the filter needs all the data for the algorithm */
   void GenerateInputRequestedRegion() override;
@@ -205,9 +213,23 @@ private:
   /* Inputs */
   MaskPixelType m_BackgroundValue{NumericTraits< MaskPixelType >::Zero};
 
-  /* Arrays for threads */
-  Array< RealType >       m_AccumulatedAverageTrace{1};
-  Array< SizeValueType >  m_NumVoxels{1};
+  /* Sums of one work unit. The padding keeps the sums of two work units out of
+   * a common cache line, whatever the alignment of the vector. */
+  struct PaddedAccumulator
+  {
+    RealType      m_AccumulatedAverageTrace;
+    SizeValueType m_NumVoxels;
+    char          m_Padding[2 * 64 - sizeof(RealType) - sizeof(SizeValueType)];
+  };
+
+  /** Accumulate the trace over the foreground of a region */
+  void ThreadedAccumulate(const InputRegionType & region, PaddedAccumulator & accumulator);
+
+  /* Region visited by the threads */
+  InputRegionType m_ForegroundRegion;
+
+  /* Accumulators for work units */
+  std::vector< PaddedAccumulator > m_Accumulators;
 }; //end class
 } // end namespace
 
@@ -20,9 +20,9 @@
 #define itkKrcahEigenToScalarParameterEstimationImageFilter_hxx
 
 #include "itkKrcahEigenToScalarParameterEstimationImageFilter.h"
-#include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkProgressReporter.h"
+#include "itkImageScanlineConstIterator.h"
 #include "itkMath.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -41,7 +41,6 @@ KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
     output->Set( 0.5 );
     this->ProcessObject::SetNthOutput( i,  output.GetPointer() );
   }
-  this->DynamicMultiThreadingOff();
 }
 
 template< typename TInputImage, typename TMaskImage >
@@ -82,19 +81,131 @@ KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
   data->SetRequestedRegionToLargestPossibleRegion();
 }
 
+template< typename TInputImage, typename TMaskImage >
+typename KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >::InputRegionType
+KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
+::ComputeForegroundRegion() const
+{
+  InputRegionType region = this->GetOutput()->GetRequestedRegion();
+  MaskImageConstPointer maskPointer = this->GetMaskImage();
+  if (!maskPointer)
+  {
+    return region;
+  }
+
+  /* Empty region at the start of the requested region */
+  InputRegionType emptyRegion = region;
+  InputSizeType emptySize;
+  emptySize.Fill(0);
+  emptyRegion.SetSize(emptySize);
+
+  /* Only the intersection with the mask is visited. The mask region being outside the
+   * image region is taken care of by Superclass::GenerateInputRequestedRegion().
+   */
+  if (!region.Crop( maskPointer->GetBufferedRegion() ))
+  {
+    return emptyRegion;
+  }
+
+  /* Find the first and last foreground pixel of every line */
+  InputIndexType lower, upper;
+  bool foundForeground = false;
+  ImageScanlineConstIterator< TMaskImage > maskIt(maskPointer, region);
+  while ( !maskIt.IsAtEnd() )
+  {
+    const InputIndexType lineIndex = maskIt.GetIndex();
+    IndexValueType first = NumericTraits< IndexValueType >::max();
+    IndexValueType last = NumericTraits< IndexValueType >::NonpositiveMin();
+    for (IndexValueType i = lineIndex[0]; !maskIt.IsAtEndOfLine(); ++maskIt, ++i)
+    {
+      if ( maskIt.Get() != m_BackgroundValue )
+      {
+        first = std::min(first, i);
+        last = i;
+      }
+    }
+    maskIt.NextLine();
+
+    if (first > last)
+    {
+      continue;
+    }
+    if (!foundForeground)
+    {
+      lower = lineIndex;
+      upper = lineIndex;
+      lower[0] = first;
+      upper[0] = last;
+      foundForeground = true;
+      continue;
+    }
+    lower[0] = std::min(lower[0], first);
+    upper[0] = std::max(upper[0], last);
+    for (unsigned int d = 1; d < TInputImage::ImageDimension; ++d)
+    {
+      lower[d] = std::min(lower[d], lineIndex[d]);
+      upper[d] = std::max(upper[d], lineIndex[d]);
+    }
+  }
+
+  if (!foundForeground)
+  {
+    return emptyRegion;
+  }
+
+  InputSizeType size;
+  for (unsigned int d = 0; d < TInputImage::ImageDimension; ++d)
+  {
+    size[d] = static_cast< SizeValueType >( upper[d] - lower[d] + 1 );
+  }
+  return InputRegionType(lower, size);
+}
+
 template< typename TInputImage, typename TMaskImage >
 void
 KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
 ::BeforeThreadedGenerateData()
 {
-  ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
+  /* Restrict the work to the foreground */
+  m_ForegroundRegion = this->ComputeForegroundRegion();
 
-  /* Resize threads */
-  m_AccumulatedAverageTrace.SetSize(numberOfThreads);
-  m_NumVoxels.SetSize(numberOfThreads);
+  /* One accumulator per work unit */
+  unsigned int numberOfPieces = 0;
+  if (m_ForegroundRegion.GetNumberOfPixels() > 0)
+  {
+    numberOfPieces = this->GetImageRegionSplitter()->GetNumberOfSplits(m_ForegroundRegion, this->GetNumberOfWorkUnits());
+  }
+  m_Accumulators.assign(numberOfPieces, PaddedAccumulator());
+}
 
-  m_AccumulatedAverageTrace.Fill(NumericTraits< RealType >::ZeroValue());
-  m_NumVoxels.Fill(NumericTraits< SizeValueType >::ZeroValue());
+template< typename TInputImage, typename TMaskImage >
+void
+KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
+::GenerateData()
+{
+  this->AllocateOutputs();
+  this->BeforeThreadedGenerateData();
+
+  /* Each work unit accumulates one split of the foreground region. Progress is reported per split. */
+  const unsigned int numberOfPieces = static_cast< unsigned int >( m_Accumulators.size() );
+  if (numberOfPieces > 0)
+  {
+    const InputRegionType foregroundRegion = m_ForegroundRegion;
+    MultiThreaderBase * threader = this->GetMultiThreader();
+    threader->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    threader->ParallelizeArray(
+      0,
+      numberOfPieces,
+      [this, &foregroundRegion, numberOfPieces](SizeValueType piece)
+      {
+        InputRegionType pieceRegion = foregroundRegion;
+        this->GetImageRegionSplitter()->GetSplit(static_cast< unsigned int >( piece ), numberOfPieces, pieceRegion);
+        this->ThreadedAccumulate(pieceRegion, m_Accumulators[piece]);
+      },
+      this);
+  }
+
+  this->AfterThreadedGenerateData();
 }
 
 template< typename TInputImage, typename TMaskImage >
@@ -102,8 +213,6 @@ void
 KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
 ::AfterThreadedGenerateData()
 {
-  ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
-
   /* Determine default parameters */
   RealType alpha, beta, gamma;
   switch(m_ParameterSet)
@@ -123,14 +232,14 @@ KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
       break;
   }
 
-  /* Accumulate over threads */
+  /* Accumulate over work units */
   SizeValueType numVoxels = NumericTraits< SizeValueType >::ZeroValue();
   RealType accumulatedAverageTrace = NumericTraits< RealType >::ZeroValue();
 
-  for (unsigned int i = 0; i < numberOfThreads; ++i )
+  for (const PaddedAccumulator & accumulator : m_Accumulators)
   {
-    numVoxels += m_NumVoxels[i];
-    accumulatedAverageTrace += m_AccumulatedAverageTrace[i];
+    numVoxels += accumulator.m_NumVoxels;
+    accumulatedAverageTrace += accumulator.m_AccumulatedAverageTrace;
   }
 
   /* Do derived measure */
@@ -148,8 +257,7 @@ KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
 template< typename TInputImage, typename TMaskImage >
 void
 KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
-::ThreadedGenerateData(const OutputRegionType & outputRegionForThread,
-                       ThreadIdType threadId)
+::ThreadedAccumulate(const InputRegionType & region, PaddedAccumulator & accumulator)
 {
   /* Determine which function to call */
   RealType (Self::*traceFunction)(InputPixelType);
@@ -173,51 +281,64 @@ KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
   /* Get input pointer */
   InputImageConstPointer inputPointer = this->GetInput();
 
-  /* Get mask pointer */
+  /* Get mask pointer. The region is already inside the mask. */
   MaskImageConstPointer maskPointer = this->GetMaskImage();
 
-  /* If we have a mask pointer we need to crop outputRegionForThread to the mask region */
-  InputRegionType croppedRegion = outputRegionForThread;
-  if (maskPointer) {
-    croppedRegion.Crop( maskPointer->GetLargestPossibleRegion() );
-    /* No check for one region being inside the other. Superclass::GenerateInputRequestedRegion()
-     * takes care of the case of the mask region being outside the image region. It's actually
-     * impossible to determine if the mask region is valid inside ThreadedGenerateData because
-     * outputRegionForThread is a sub region of the output region.
-     */
-  }
-
   /* If size is zero, return */
-  const SizeValueType size0 = croppedRegion.GetSize(0);
+  const SizeValueType size0 = region.GetSize(0);
   if (size0 == 0)
   {
     return;
   }
 
-  /* Setup progress reporter */
-  ProgressReporter progress( this, threadId, croppedRegion.GetNumberOfPixels() );
-
-  /* Setup iterator */
-  ImageRegionConstIteratorWithIndex< TInputImage > inputIt(inputPointer, croppedRegion);
+  /* Walk the image and mask buffers side by side */
+  ImageScanlineConstIterator< TInputImage > inputIt(inputPointer, region);
+  ImageScanlineConstIterator< TMaskImage > maskIt;
+  if (maskPointer)
+  {
+    maskIt = ImageScanlineConstIterator< TMaskImage >(maskPointer, region);
+  }
 
   /* Iterate and count */
-  inputIt.GoToBegin();
   while ( !inputIt.IsAtEnd() )
   {
-    if ( (!maskPointer) ||  (maskPointer->GetPixel(inputIt.GetIndex()) != m_BackgroundValue) )
+    /* Check for an abort request once per line */
+    if ( this->GetAbortGenerateData() )
     {
-      numVoxels++;
+      throw ProcessAborted(__FILE__, __LINE__);
+    }
 
-      /* Compute trace */
-      accumulatedAverageTrace += (this->*traceFunction)(inputIt.Get());
+    if (maskPointer)
+    {
+      while ( !inputIt.IsAtEndOfLine() )
+      {
+        if ( maskIt.Get() != m_BackgroundValue )
+        {
+          numVoxels++;
+
+          /* Compute trace */
+          accumulatedAverageTrace += (this->*traceFunction)(inputIt.Get());
+        }
+        ++inputIt;
+        ++maskIt;
+      }
+      maskIt.NextLine();
+    }
+    else
+    {
+      while ( !inputIt.IsAtEndOfLine() )
+      {
+        numVoxels++;
+        accumulatedAverageTrace += (this->*traceFunction)(inputIt.Get());
+        ++inputIt;
+      }
     }
-    ++inputIt;
-    progress.CompletedPixel();
+    inputIt.NextLine();
   }
 
-  /* Store this thread */
-  m_AccumulatedAverageTrace[threadId] = accumulatedAverageTrace;
-  m_NumVoxels[threadId] = numVoxels;
+  /* Store this work unit */
+  accumulator.m_AccumulatedAverageTrace = accumulatedAverageTrace;
+  accumulator.m_NumVoxels = numVoxels;
 }
 
 template< typename TInputImage, typename TMaskImage >
@@ -297,6 +418,7 @@ KrcahEigenToScalarParameterEstimationImageFilter< TInputImage, TMaskImage >
   os << indent << "m_Gamma: " << this->GetGamma() << std::endl;
   os << indent << "m_BackgroundValue: " << m_BackgroundValue << std::endl;
   os << indent << "m_ParameterSet: " << m_ParameterSet << std::endl;
+  os << indent << "m_ForegroundRegion: " << m_ForegroundRegion << std::endl;
 }
 
 } // end namespace itk
@@ -46,7 +46,13 @@ namespace itk
  * conserves memory at the expense of computation time if ScalingConstant
  * or Sigma are changed. This flag is on by default.
  * 
+ * Only the requested region padded by the radius of the Gaussian kernel
+ * is requested from the input, so the filter can be streamed. This is how
+ * MultiScaleHessianEnhancementImageFilter::SetPreprocessingFilter( )
+ * preprocesses each piece of the input on the fly.
+ * 
  * \sa KrcahEigenToScalarImageFilter
+ * \sa MultiScaleHessianEnhancementImageFilter
  * 
  * \author: Thomas Fitze
  * \ingroup BoneEnhancement
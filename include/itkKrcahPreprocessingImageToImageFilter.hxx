@@ -44,14 +44,46 @@ void
 KrcahPreprocessingImageToImageFilter< TInputImage, TOutputImage >
 ::GenerateInputRequestedRegion()
 {
-  // Gaussian filter needs expanding around kernel. Since this filter is typically used
-  // with the Kcrah enhancing filter, we just expand everything.
+  // Gaussian filter needs expanding around kernel. The radius is computed as in
+  // DiscreteGaussianImageFilter so that a region of the output equals the same
+  // region of the whole output, and the filter can be streamed with a halo.
   Superclass::GenerateInputRequestedRegion();
   auto * input = const_cast<TInputImage *>(this->GetInput());
-  if( input )
+  if( !input )
     {
-    input->SetRequestedRegionToLargestPossibleRegion();
+    return;
     }
+
+  typename TInputImage::SizeType radius;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    double variance = Math::squared_magnitude(this->GetSigma());
+    if ( m_GaussianFilter->GetUseImageSpacing() )
+      {
+      const double spacing = input->GetSpacing()[i];
+      variance /= spacing * spacing;
+      }
+    GaussianOperator< RealType, ImageDimension > oper;
+    oper.SetDirection(i);
+    oper.SetVariance(variance);
+    oper.SetMaximumError(m_GaussianFilter->GetMaximumError()[i]);
+    oper.SetMaximumKernelWidth(m_GaussianFilter->GetMaximumKernelWidth());
+    oper.CreateDirectional();
+    radius[i] = oper.GetRadius(i);
+    }
+
+  typename TInputImage::RegionType inputRequestedRegion = input->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(radius);
+  if ( !inputRequestedRegion.Crop( input->GetLargestPossibleRegion() ) )
+    {
+    input->SetRequestedRegion(inputRequestedRegion);
+    InvalidRequestedRegionError e(__FILE__, __LINE__);
+    e.SetLocation(ITK_LOCATION);
+    e.SetDescription("Requested region is (at least partially) outside the largest possible region.");
+    e.SetDataObject(input);
+    throw e;
+    }
+  input->SetRequestedRegion(inputRequestedRegion);
 }
 
 template< typename TInputImage, typename TOutputImage >
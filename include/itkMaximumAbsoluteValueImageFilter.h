@@ -93,6 +93,7 @@ public:
   using Input1PixelType = typename TInputImage1::PixelType;
   using Input2PixelType = typename TInputImage2::PixelType;
   using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
 
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
@@ -115,7 +116,18 @@ protected:
 
     virtual ~MaximumAbsoluteValueImageFilter() {
     }
+
+    /** Allocate the output with the module's first touch policy unless running in place. */
+    void AllocateOutputs() override;
+
+    /** Process scanlines so an abort request is seen quickly. Constant inputs are
+     * handled by the superclass. */
+    void DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
 }; // end of class
 } // end namespace itk
 
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMaximumAbsoluteValueImageFilter.hxx"
+#endif
+
 #endif // itkMaximumAbsoluteValueImageFilter_h
@@ -0,0 +1,89 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMaximumAbsoluteValueImageFilter_hxx
+#define itkMaximumAbsoluteValueImageFilter_hxx
+
+#include "itkMaximumAbsoluteValueImageFilter.h"
+#include "itkImageScanlineIterator.h"
+#include "itkParallelFirstTouchAllocator.h"
+
+namespace itk {
+
+template<typename TInputImage1, typename TInputImage2, typename TOutputImage>
+void
+MaximumAbsoluteValueImageFilter<TInputImage1, TInputImage2, TOutputImage>
+::AllocateOutputs()
+{
+  /* Take the buffer from the module's pool unless the first input's buffer is reused */
+  PooledImportImageContainer< SizeValueType, typename TOutputImage::PixelType >::UsePool(this->GetOutput(0), this);
+  Superclass::AllocateOutputs();
+
+  /* Running in place reuses the buffer of the first input which is already touched */
+  if ( ParallelFirstTouchAllocator::GetEnabled(this) && !this->GetRunningInPlace() )
+  {
+    ParallelFirstTouchAllocator::FirstTouch(this->GetOutput(0), this);
+  }
+}
+
+template<typename TInputImage1, typename TInputImage2, typename TOutputImage>
+void
+MaximumAbsoluteValueImageFilter<TInputImage1, TInputImage2, TOutputImage>
+::DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread)
+{
+  const TInputImage1 * input1Ptr = dynamic_cast< const TInputImage1 * >( ProcessObject::GetInput(0) );
+  const TInputImage2 * input2Ptr = dynamic_cast< const TInputImage2 * >( ProcessObject::GetInput(1) );
+  if ( !input1Ptr || !input2Ptr )
+  {
+    Superclass::DynamicThreadedGenerateData(outputRegionForThread);
+    return;
+  }
+
+  TOutputImage * outputPtr = this->GetOutput(0);
+  if ( outputRegionForThread.GetSize(0) == 0 )
+  {
+    return;
+  }
+
+  ImageScanlineConstIterator< TInputImage1 > input1It(input1Ptr, outputRegionForThread);
+  ImageScanlineConstIterator< TInputImage2 > input2It(input2Ptr, outputRegionForThread);
+  ImageScanlineIterator< TOutputImage >      outputIt(outputPtr, outputRegionForThread);
+
+  while ( !outputIt.IsAtEnd() )
+  {
+    /* Check for an abort request once per line */
+    if ( this->GetAbortGenerateData() )
+    {
+      throw ProcessAborted(__FILE__, __LINE__);
+    }
+
+    while ( !outputIt.IsAtEndOfLine() )
+    {
+      outputIt.Set( this->GetFunctor()( input1It.Get(), input2It.Get() ) );
+      ++input1It;
+      ++input2It;
+      ++outputIt;
+    }
+    input1It.NextLine();
+    input2It.NextLine();
+    outputIt.NextLine();
+  }
+}
+
+} // end namespace itk
+
+#endif // itkMaximumAbsoluteValueImageFilter_hxx
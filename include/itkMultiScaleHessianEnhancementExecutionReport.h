@@ -0,0 +1,400 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMultiScaleHessianEnhancementExecutionReport_h
+#define itkMultiScaleHessianEnhancementExecutionReport_h
+
+#include "itkIntTypes.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+/** \class MultiScaleHessianEnhancementExecutionReport
+ * \brief Per-stage timing and memory report of a MultiScaleHessianEnhancementImageFilter execution.
+ *
+ * The multi-scale filter runs five internal stages for every sigma value: the Hessian,
+ * the eigenvalue analysis, the parameter estimation, the measure and the maximum over
+ * scales. One StageRecord is kept for each stage and sigma value.
+ *
+ * Stages are nested by the pipeline. For instance, the parameter estimation streams its
+ * input which executes the Hessian and eigenvalue analysis. Times are reported exclusive
+ * of nested stages so the records add up to the total time. Wall time is measured with a
+ * steady clock. CPU time is the process CPU time from std::clock and includes all threads.
+ *
+ * Stages may run concurrently on different threads. Nesting is tracked per thread and the
+ * current scale is set per thread. When stages overlap, their wall and CPU times overlap too
+ * and the records no longer add up to the total time.
+ *
+ * BytesAllocated is the sum of the output buffer sizes over every execution of a stage.
+ * PeakBufferSize is the largest output buffer of a single execution.
+ *
+ * When flat blocks are skipped, one FlatBlockRecord per sigma value tells how many blocks and
+ * pixels were written directly instead of computed.
+ *
+ * The report can be written as JSON with ToJSON( ) for logging.
+ *
+ * \sa MultiScaleHessianEnhancementImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+class MultiScaleHessianEnhancementExecutionReport
+{
+public:
+  /** Stages of the multi-scale pipeline */
+  typedef enum {
+    HessianStage = 0,
+    EigenAnalysisStage = 1,
+    ParameterEstimationStage = 2,
+    MeasureStage = 3,
+    MaximumAbsoluteValueStage = 4,
+    NumberOfStages = 5
+  } StageEnum;
+
+  /** Timing and memory of one stage at one sigma value */
+  struct StageRecord
+  {
+    StageEnum     m_Stage;
+    unsigned int  m_ScaleLevel;
+    double        m_Sigma;
+    SizeValueType m_NumberOfExecutions;
+    double        m_WallTime;
+    double        m_CPUTime;
+    SizeValueType m_BytesAllocated;
+    SizeValueType m_PeakBufferSize;
+  };
+  using StageRecordContainerType = std::vector< StageRecord >;
+
+  /** Blocks skipped at one sigma value because they were flat */
+  struct FlatBlockRecord
+  {
+    unsigned int  m_ScaleLevel;
+    double        m_Sigma;
+    SizeValueType m_NumberOfBlocks;
+    SizeValueType m_NumberOfFlatBlocks;
+    SizeValueType m_NumberOfPixels;
+    SizeValueType m_NumberOfFlatPixels;
+  };
+  using FlatBlockRecordContainerType = std::vector< FlatBlockRecord >;
+
+  MultiScaleHessianEnhancementExecutionReport()
+  {
+    this->Clear();
+  }
+
+  /** Remove all records */
+  void Clear()
+  {
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    m_StageRecords.clear();
+    m_FlatBlockRecords.clear();
+    m_Threads.clear();
+    m_TotalWallTime = 0.0;
+    m_TotalCPUTime = 0.0;
+  }
+
+  /** Set the scale which subsequent stages on the calling thread are attributed to */
+  void SetCurrentScale(unsigned int scaleLevel, double sigma)
+  {
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    ThreadState & state = m_Threads[std::this_thread::get_id()];
+    state.m_ScaleLevel = scaleLevel;
+    state.m_Sigma = sigma;
+  }
+
+  /** Mark the start and end of a stage. Calls must be nested within a thread. */
+  void BeginStage(StageEnum stage)
+  {
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    ThreadState & state = m_Threads[std::this_thread::get_id()];
+    ActiveStage active;
+    active.m_Record = this->FindOrCreateRecord(stage, state.m_ScaleLevel, state.m_Sigma);
+    active.m_StartWallTime = Self::WallClock();
+    active.m_StartCPUTime = Self::CPUClock();
+    active.m_NestedWallTime = 0.0;
+    active.m_NestedCPUTime = 0.0;
+    state.m_ActiveStages.push_back(active);
+  }
+
+  void EndStage(StageEnum stage, SizeValueType bufferSize)
+  {
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    std::vector< ActiveStage > & activeStages = m_Threads[std::this_thread::get_id()].m_ActiveStages;
+    if (activeStages.empty() || m_StageRecords[activeStages.back().m_Record].m_Stage != stage)
+    {
+      /* Unbalanced events, for instance when a stage was aborted */
+      return;
+    }
+    const ActiveStage active = activeStages.back();
+    activeStages.pop_back();
+
+    const double wallTime = Self::WallClock() - active.m_StartWallTime;
+    const double cpuTime = Self::CPUClock() - active.m_StartCPUTime;
+
+    StageRecord & record = m_StageRecords[active.m_Record];
+    record.m_NumberOfExecutions += 1;
+    record.m_WallTime += wallTime - active.m_NestedWallTime;
+    record.m_CPUTime += cpuTime - active.m_NestedCPUTime;
+    record.m_BytesAllocated += bufferSize;
+    record.m_PeakBufferSize = std::max(record.m_PeakBufferSize, bufferSize);
+
+    /* Remove our time from the enclosing stage */
+    if (!activeStages.empty())
+    {
+      activeStages.back().m_NestedWallTime += wallTime;
+      activeStages.back().m_NestedCPUTime += cpuTime;
+    }
+  }
+
+  /** Record the flat blocks of the current scale of the calling thread */
+  void SetFlatBlocks(SizeValueType numberOfBlocks, SizeValueType numberOfFlatBlocks,
+                     SizeValueType numberOfPixels, SizeValueType numberOfFlatPixels)
+  {
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    const ThreadState & state = m_Threads[std::this_thread::get_id()];
+    FlatBlockRecord record;
+    record.m_ScaleLevel = state.m_ScaleLevel;
+    record.m_Sigma = state.m_Sigma;
+    record.m_NumberOfBlocks = numberOfBlocks;
+    record.m_NumberOfFlatBlocks = numberOfFlatBlocks;
+    record.m_NumberOfPixels = numberOfPixels;
+    record.m_NumberOfFlatPixels = numberOfFlatPixels;
+    for (FlatBlockRecord & existing : m_FlatBlockRecords)
+    {
+      if (existing.m_ScaleLevel == record.m_ScaleLevel)
+      {
+        existing = record;
+        return;
+      }
+    }
+    m_FlatBlockRecords.push_back(record);
+  }
+
+  /** Set/Get the time of the whole execution */
+  void SetTotalWallTime(double time) { m_TotalWallTime = time; }
+  double GetTotalWallTime() const { return m_TotalWallTime; }
+  void SetTotalCPUTime(double time) { m_TotalCPUTime = time; }
+  double GetTotalCPUTime() const { return m_TotalCPUTime; }
+
+  /** Get the records in order of first execution */
+  const StageRecordContainerType & GetStageRecords() const
+  {
+    return m_StageRecords;
+  }
+
+  /** Sum a stage over all sigma values */
+  StageRecord GetStageTotal(StageEnum stage) const
+  {
+    StageRecord total = Self::EmptyRecord(stage, 0, 0.0);
+    for (const StageRecord & record : m_StageRecords)
+    {
+      if (record.m_Stage == stage)
+      {
+        total.m_NumberOfExecutions += record.m_NumberOfExecutions;
+        total.m_WallTime += record.m_WallTime;
+        total.m_CPUTime += record.m_CPUTime;
+        total.m_BytesAllocated += record.m_BytesAllocated;
+        total.m_PeakBufferSize = std::max(total.m_PeakBufferSize, record.m_PeakBufferSize);
+      }
+    }
+    return total;
+  }
+
+  /** Get the flat block records in order of scale */
+  const FlatBlockRecordContainerType & GetFlatBlockRecords() const
+  {
+    return m_FlatBlockRecords;
+  }
+
+  /** Fraction of the pixels of all scales which were skipped, zero without flat block records */
+  double GetFlatPixelFraction() const
+  {
+    SizeValueType numberOfPixels = 0;
+    SizeValueType numberOfFlatPixels = 0;
+    for (const FlatBlockRecord & record : m_FlatBlockRecords)
+    {
+      numberOfPixels += record.m_NumberOfPixels;
+      numberOfFlatPixels += record.m_NumberOfFlatPixels;
+    }
+    return numberOfPixels > 0 ? static_cast< double >(numberOfFlatPixels) / numberOfPixels : 0.0;
+  }
+
+  /** Largest output buffer produced by any stage */
+  SizeValueType GetPeakBufferSize() const
+  {
+    SizeValueType peak = 0;
+    for (const StageRecord & record : m_StageRecords)
+    {
+      peak = std::max(peak, record.m_PeakBufferSize);
+    }
+    return peak;
+  }
+
+  static const char * GetStageName(StageEnum stage)
+  {
+    switch (stage)
+    {
+    case HessianStage:
+      return "Hessian";
+    case EigenAnalysisStage:
+      return "EigenAnalysis";
+    case ParameterEstimationStage:
+      return "ParameterEstimation";
+    case MeasureStage:
+      return "Measure";
+    case MaximumAbsoluteValueStage:
+      return "MaximumAbsoluteValue";
+    default:
+      return "Unknown";
+    }
+  }
+
+  /** Write the report as a JSON object. Times are in seconds and sizes in bytes. */
+  void ToJSON(std::ostream & os) const
+  {
+    std::ostringstream json;
+    json << std::setprecision(9);
+    json << "{\"TotalWallTime\": " << m_TotalWallTime
+         << ", \"TotalCPUTime\": " << m_TotalCPUTime
+         << ", \"PeakBufferSize\": " << this->GetPeakBufferSize()
+         << ", \"Stages\": [";
+    for (SizeValueType i = 0; i < m_StageRecords.size(); ++i)
+    {
+      const StageRecord & record = m_StageRecords[i];
+      json << (i > 0 ? ", " : "")
+           << "{\"Stage\": \"" << Self::GetStageName(record.m_Stage) << "\""
+           << ", \"ScaleLevel\": " << record.m_ScaleLevel
+           << ", \"Sigma\": " << record.m_Sigma
+           << ", \"NumberOfExecutions\": " << record.m_NumberOfExecutions
+           << ", \"WallTime\": " << record.m_WallTime
+           << ", \"CPUTime\": " << record.m_CPUTime
+           << ", \"BytesAllocated\": " << record.m_BytesAllocated
+           << ", \"PeakBufferSize\": " << record.m_PeakBufferSize
+           << "}";
+    }
+    json << "], \"FlatPixelFraction\": " << this->GetFlatPixelFraction()
+         << ", \"FlatBlocks\": [";
+    for (SizeValueType i = 0; i < m_FlatBlockRecords.size(); ++i)
+    {
+      const FlatBlockRecord & record = m_FlatBlockRecords[i];
+      json << (i > 0 ? ", " : "")
+           << "{\"ScaleLevel\": " << record.m_ScaleLevel
+           << ", \"Sigma\": " << record.m_Sigma
+           << ", \"NumberOfBlocks\": " << record.m_NumberOfBlocks
+           << ", \"NumberOfFlatBlocks\": " << record.m_NumberOfFlatBlocks
+           << ", \"NumberOfPixels\": " << record.m_NumberOfPixels
+           << ", \"NumberOfFlatPixels\": " << record.m_NumberOfFlatPixels
+           << "}";
+    }
+    json << "]}";
+    os << json.str();
+  }
+
+  std::string ToJSON() const
+  {
+    std::ostringstream os;
+    this->ToJSON(os);
+    return os.str();
+  }
+
+  /** Clocks used by the report, in seconds */
+  static double WallClock()
+  {
+    return std::chrono::duration< double >(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static double CPUClock()
+  {
+    return static_cast< double >(std::clock()) / CLOCKS_PER_SEC;
+  }
+
+private:
+  using Self = MultiScaleHessianEnhancementExecutionReport;
+
+  /* A stage which has started but not ended */
+  struct ActiveStage
+  {
+    SizeValueType m_Record;
+    double        m_StartWallTime;
+    double        m_StartCPUTime;
+    double        m_NestedWallTime;
+    double        m_NestedCPUTime;
+  };
+
+  static StageRecord EmptyRecord(StageEnum stage, unsigned int scaleLevel, double sigma)
+  {
+    StageRecord record;
+    record.m_Stage = stage;
+    record.m_ScaleLevel = scaleLevel;
+    record.m_Sigma = sigma;
+    record.m_NumberOfExecutions = 0;
+    record.m_WallTime = 0.0;
+    record.m_CPUTime = 0.0;
+    record.m_BytesAllocated = 0;
+    record.m_PeakBufferSize = 0;
+    return record;
+  }
+
+  /* Stages and scale of one thread */
+  struct ThreadState
+  {
+    ThreadState() : m_ScaleLevel(0), m_Sigma(0.0) {}
+    unsigned int                m_ScaleLevel;
+    double                      m_Sigma;
+    std::vector< ActiveStage >  m_ActiveStages;
+  };
+
+  SizeValueType FindOrCreateRecord(StageEnum stage, unsigned int scaleLevel, double sigma)
+  {
+    for (SizeValueType i = 0; i < m_StageRecords.size(); ++i)
+    {
+      if (m_StageRecords[i].m_Stage == stage && m_StageRecords[i].m_ScaleLevel == scaleLevel)
+      {
+        return i;
+      }
+    }
+    m_StageRecords.push_back(Self::EmptyRecord(stage, scaleLevel, sigma));
+    return m_StageRecords.size() - 1;
+  }
+
+  std::mutex                                  m_Mutex;
+  StageRecordContainerType                    m_StageRecords;
+  FlatBlockRecordContainerType                m_FlatBlockRecords;
+  std::map< std::thread::id, ThreadState >    m_Threads;
+  double                                      m_TotalWallTime;
+  double                                      m_TotalCPUTime;
+};
+
+inline std::ostream &
+operator<<(std::ostream & os, const MultiScaleHessianEnhancementExecutionReport & report)
+{
+  report.ToJSON(os);
+  return os;
+}
+} // end namespace itk
+
+#endif // itkMultiScaleHessianEnhancementExecutionReport_h
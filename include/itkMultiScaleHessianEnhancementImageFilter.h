@@ -20,13 +20,27 @@
 
 #include "itkImageToImageFilter.h"
 #include "itkHessianGaussianImageFilter.h"
-#include "itkSymmetricEigenAnalysisImageFilter.h"
+#include "itkFlatBlockSymmetricEigenAnalysisImageFilter.h"
+#include "itkFlatBlockMap.h"
 #include "itkMaximumAbsoluteValueImageFilter.h"
 #include "itkNumericTraits.h"
 #include "itkArray.h"
 #include "itkSpatialObject.h"
 #include "itkEigenToMeasureImageFilter.h"
 #include "itkEigenToMeasureParameterEstimationFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkMultiScaleHessianEnhancementExecutionReport.h"
+#include "itkImageBufferPool.h"
+#include "itkParallelFirstTouchAllocator.h"
+#include "itkCommand.h"
+#include "itkFixedArray.h"
+#include "itkMetaDataObject.h"
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace itk
 {
@@ -51,6 +65,110 @@ namespace itk
  * MaximumAbsoluteValueImageFilter. This is valid for filters which enhance both the positive and negative
  * second derivatives.
  * 
+ * The wall time, CPU time and memory of every internal stage at every sigma value are recorded during
+ * execution. They are available after an update through GetExecutionReport( ).
+ * 
+ * Progress covers every internal stage, including the Hessian and eigenvalue analysis which are streamed
+ * by the parameter estimation. Each execution of a stage is weighted by a cost model of the number of
+ * voxels it produces times a per voxel cost. For the Hessian, the per voxel cost is proportional to the
+ * kernel width at that sigma. The per voxel costs are scaled by StageCostCoefficients. If
+ * CalibrateStageCosts is on, calibrated coefficients are measured from the execution report after every
+ * update so that progress of the next update is roughly linear in time. The calibrated coefficients are
+ * used only while StageCostCoefficients have not been set explicitly.
+ * 
+ * If PipelineScales is on, the measure and maximum over scales of one sigma value run on a separate
+ * thread while the parameters of the next sigma value are estimated. Both use the ITK thread pool. The
+ * output is identical, but one more eigenvalue image is held in memory and progress events may be
+ * invoked from the separate thread.
+ * 
+ * By default, the parameter estimation keeps a copy of the eigenvalue image for the measure. If
+ * LazyEigenImage is on, the estimation only computes the parameters and the measure is streamed in
+ * the same pieces, computing the Hessian and eigenvalues of each piece again. This removes the
+ * eigenvalue image from memory at the cost of a second Hessian pass. PipelineScales is ignored
+ * when LazyEigenImage is on.
+ * 
+ * Writing a large buffer for the first time page faults on every page. UseHugePages takes the
+ * buffers of the internal filters from ImageBufferPool with transparent huge page advice, which
+ * reduces the number of faults and keeps the buffers across scales. PrefaultBuffers faults them in
+ * parallel when they are allocated instead of in the stage which first writes them. Both options
+ * enable the policies for this filter and its internal filters during an update, without changing
+ * the global policies of the module. Blocks cached by the pool are returned to the system after
+ * the update unless the pool is also enabled globally or for another filter.
+ * 
+ * When the parameters are fixed by a protocol, set them with SetFixedParameters( ). The parameter
+ * estimation filter is then not needed and not run. The measure reads the eigenvalues directly, which
+ * saves a copy of the eigenvalue image and the streaming of the estimation at every sigma value.
+ * With LazyEigenImage on, the measure is streamed instead of holding the eigenvalue image.
+ * 
+ * The parameters of a normalized Hessian vary smoothly with sigma. If NumberOfAnchorScales is set
+ * below the number of sigma values, the parameters are only estimated at that many anchor scales
+ * spread evenly over the sigma array, including the first and last. The anchor scales are processed
+ * first, then the parameters of the other scales are fitted with FitScaleParameters( ) and the
+ * measure reads their eigenvalues directly. ComputeParameterFitError( ) estimates the parameters of a
+ * scale on demand and returns the relative error of the fitted ones.
+ * 
+ * The parameters estimated at every sigma value are kept after an update. ComputeROI( ) uses them to
+ * compute the response of a small region with the exact Hessian, whatever the Hessian method of the
+ * update. Only the requested region and the halo of the Hessian kernel are read, and no parameters
+ * are estimated. The parameters are discarded once the sigma
+ * values, the input or the measure filter are modified.
+ * 
+ * If IncrementalScaleSpace is on, the Hessian keeps the input smoothed at the last sigma value and
+ * only smooths it by the increment to the next, then takes central differences. The cost of a scale
+ * then depends on the increment of sigma instead of sigma. Sigma values are processed in the order
+ * of the sigma array, which is increasing for the generated arrays. Anchor scales are processed
+ * out of order and the input is smoothed again whenever sigma decreases. The smoothed input is held
+ * in memory during an update. See HessianGaussianImageFilter for the accuracy.
+ * 
+ * For volumes which do not fit in memory, set SlabThickness. The Hessian, eigenvalues, parameter
+ * estimation and measure are then streamed in slabs of that many planes along the slowest dimension,
+ * and the Hessian keeps a ring buffer of input planes smoothed across the faster dimensions
+ * (HessianGaussianImageFilter::SlidingSlab). The input is requested one slab plus the halo of the
+ * kernel at a time, so a streaming reader or upstream filter never produces the whole volume. The
+ * measure of every slab is folded into the running maximum, which becomes the output, in place.
+ * Besides the output, and the quantized output if any, memory is then proportional to the area of a
+ * plane times the slab thickness plus the height of the kernel. The input is read at least twice per
+ * estimated sigma value, once by the estimation and once by the measure. The Hessian is taken by
+ * smoothing and central differences instead of the exact derivative kernels, with a relative error of
+ * up to about 25% at a sigma of one voxel, see HessianGaussianImageFilter. IncrementalScaleSpace and
+ * PipelineScales are ignored. The number of stream divisions of the parameter estimation is set from
+ * the thickness during an update. With SkipFlatBlocks, the block ranges are streamed one row of blocks
+ * at a time.
+ * 
+ * Most of the range of the float response is not needed to store or view it. If QuantizeOutput is on,
+ * the response is also quantized to the integer pixel type of GetQuantizedOutput( ), short by default
+ * or signed char for 8 bits. QuantizationMinimum and QuantizationMaximum are mapped to the range of
+ * the pixel type and values outside are clamped. The quantization is done in the pass which takes
+ * the maximum over the last scale, and the scale and offset are recorded in the meta data dictionary
+ * of the quantized image under "QuantizationScale" and "QuantizationOffset" so that
+ * response = scale * value + offset.
+ * 
+ * Preprocessing such as the unsharp mask of KrcahPreprocessingImageToImageFilter can be applied on
+ * the fly with SetPreprocessingFilter( ). The filter is connected between the input and the Hessian,
+ * so it only computes the pieces requested by the Hessian, padded by its own kernel radius. Since
+ * the parameter estimation streams the Hessian, and the measure too with LazyEigenImage or
+ * SlabThickness, the preprocessed image is never held over the whole volume nor written out and read
+ * back. The pieces are preprocessed again at every sigma value. The scales whose eigenvalues are
+ * read directly by the measure request the whole preprocessed image, which is then released after
+ * the update. The preprocessing filter must stream correctly, that is produce the same values for a
+ * region as for the whole image. It cannot be combined with SkipFlatBlocks.
+ * 
+ * Large parts of CT volumes are nearly uniform. If SkipFlatBlocks is on, the minimum and maximum of
+ * every block of FlatBlockSize voxels of the input are computed once per update. At each sigma value,
+ * a block is flat if the range over the blocks within the Hessian kernel radius of it is at most
+ * FlatBlockThreshold. The Hessian, eigenvalues and measure of flat blocks are written as zero,
+ * or as the measure of zero eigenvalues, instead of being computed (see FlatBlockMap). The smoothing
+ * passes of the central difference methods are not skipped. The normalized Hessian of a region whose
+ * values lie within a range R is bounded by about R/2 whatever the sigma, so the same threshold is
+ * used at every sigma and the error of a skipped block stays below about half of it. The ranges are
+ * taken over the input, so an update throws if a PreprocessingFilter is set as well; preprocess the
+ * input beforehand instead. The parameters are estimated from the zero eigenvalues of the flat
+ * blocks. The blocks skipped at every sigma value are recorded in the execution report. ComputeROI( )
+ * and ComputeParameterFitError( ) do not skip blocks.
+ * 
+ * An abort request is forwarded to the internal filters which check it once per scanline. When aborted,
+ * the intermediate images are released and ProcessAborted is thrown.
+ * 
  * This class is heavily derived from \see MultiScaleHessianBasedMeasureImageFilter
  * 
  * \sa MaximumAbsoluteValueImageFilter
@@ -61,7 +179,8 @@ namespace itk
  * \author: Bryce Besler
  * \ingroup BoneEnhancement
  */
-template< typename TInputImage, typename TOutputImage = TInputImage >
+template< typename TInputImage, typename TOutputImage = TInputImage,
+          typename TQuantizedImage = Image< short, TInputImage::ImageDimension > >
 class ITK_TEMPLATE_EXPORT MultiScaleHessianEnhancementImageFilter
   : public ImageToImageFilter< TInputImage, TOutputImage >
 {
@@ -95,6 +214,14 @@ public:
   using OutputImageRegionType   = typename OutputImageType::RegionType;
   using OutputImagePixelType    = typename OutputImageType::PixelType;
 
+  /** Quantized output image typedefs. */
+  using QuantizedImageType      = TQuantizedImage;
+  using QuantizedImagePointer   = typename QuantizedImageType::Pointer;
+  using QuantizedImagePixelType = typename QuantizedImageType::PixelType;
+
+  /** Preprocessing of the input related typedefs. */
+  using PreprocessingFilterType = ImageToImageFilter< TInputImage, TInputImage >;
+
   /** Mask related typedefs. */
   using MaskSpatialObjectType             = SpatialObject< ImageDimension >;
   using MaskSpatialObjectTypeConstPointer = typename MaskSpatialObjectType::ConstPointer;
@@ -117,7 +244,7 @@ public:
   using FloatType               = typename NumericTraits< InputImagePixelType >::FloatType;
   using EigenValueArrayType     = Vector< FloatType, HessianPixelType::Dimension >;
   using EigenValueImageType     = Image< EigenValueArrayType, TInputImage::ImageDimension >;
-  using EigenAnalysisFilterType = SymmetricEigenAnalysisImageFilter< HessianImageType, EigenValueImageType >;
+  using EigenAnalysisFilterType = FlatBlockSymmetricEigenAnalysisImageFilter< HessianImageType, EigenValueImageType >;
 
   /** Maximum over scale related type alias. */
   using MaximumAbsoluteValueFilterType = MaximumAbsoluteValueImageFilter< TOutputImage >;
@@ -125,6 +252,8 @@ public:
   /** Eigenvalue image to measure image related typedefs */
   using EigenToMeasureImageFilterType               = EigenToMeasureImageFilter< EigenValueImageType, TOutputImage >;
   using EigenToMeasureParameterEstimationFilterType = EigenToMeasureParameterEstimationFilter< EigenValueImageType >;
+  using MeasureStreamingFilterType                  = StreamingImageFilter< TOutputImage, TOutputImage >;
+  using MeasureParameterArrayType                   = typename EigenToMeasureImageFilterType::ParameterArrayType;
   
   /** Need some types to determine how to order the eigenvalues */
   using InternalEigenValueOrderType = typename EigenAnalysisFilterType::FunctorType::EigenValueOrderType;
@@ -138,6 +267,10 @@ public:
   itkSetObjectMacro(EigenToMeasureParameterEstimationFilter, EigenToMeasureParameterEstimationFilterType);
   itkGetModifiableObjectMacro(EigenToMeasureParameterEstimationFilter, EigenToMeasureParameterEstimationFilterType);
 
+  /** Set/Get the filter applied to each piece of the input before the Hessian. Default is none. */
+  itkSetObjectMacro(PreprocessingFilter, PreprocessingFilterType);
+  itkGetModifiableObjectMacro(PreprocessingFilter, PreprocessingFilterType);
+
   /** Sigma values. */
   using SigmaType       = RealType;
   using SigmaArrayType  = Array< SigmaType >;
@@ -161,10 +294,189 @@ public:
   static SigmaArrayType GenerateEquispacedSigmaArray(SigmaType SigmaMinimum, SigmaType SigmaMaximum, SigmaStepsType NumberOfSigmaSteps);
   static SigmaArrayType GenerateLogarithmicSigmaArray(SigmaType SigmaMinimum, SigmaType SigmaMaximum, SigmaStepsType NumberOfSigmaSteps);
 
+  /** Per-stage timing and memory report type */
+  using ExecutionReportType = MultiScaleHessianEnhancementExecutionReport;
+
+  /** Set/Get the cost coefficient of each stage, indexed by ExecutionReportType::StageEnum. Once set,
+   * these coefficients are used instead of the calibrated ones. */
+  using StageCostCoefficientsType = FixedArray< double, ExecutionReportType::NumberOfStages >;
+  virtual void SetStageCostCoefficients(const StageCostCoefficientsType & coefficients);
+  itkGetConstReferenceMacro(StageCostCoefficients, StageCostCoefficientsType);
+
+  /** Get the cost coefficients measured after the last update. */
+  itkGetConstReferenceMacro(CalibratedStageCostCoefficients, StageCostCoefficientsType);
+
+  /** Set/Get whether the calibrated stage cost coefficients are measured after each update. Default is on. */
+  itkSetMacro(CalibrateStageCosts, bool);
+  itkGetConstMacro(CalibrateStageCosts, bool);
+  itkBooleanMacro(CalibrateStageCosts);
+
+  /** Set/Get whether the measure of one sigma value runs while the next sigma value is estimated. Default is off. */
+  itkSetMacro(PipelineScales, bool);
+  itkGetConstMacro(PipelineScales, bool);
+  itkBooleanMacro(PipelineScales);
+
+  /**
+   * Set/Get whether the eigenvalues are computed again for the measure instead of being held in
+   * memory after the parameter estimation. Default is off.
+   */
+  itkSetMacro(LazyEigenImage, bool);
+  itkGetConstMacro(LazyEigenImage, bool);
+  itkBooleanMacro(LazyEigenImage);
+
+  /**
+   * Set/Get whether the large buffers of the internal filters are taken from ImageBufferPool
+   * with transparent huge page advice during an update. Default is off.
+   */
+  itkSetMacro(UseHugePages, bool);
+  itkGetConstMacro(UseHugePages, bool);
+  itkBooleanMacro(UseHugePages);
+
+  /**
+   * Set/Get whether the large buffers of the internal filters are prefaulted in parallel with
+   * ParallelFirstTouchAllocator during an update. Default is off.
+   */
+  itkSetMacro(PrefaultBuffers, bool);
+  itkGetConstMacro(PrefaultBuffers, bool);
+  itkBooleanMacro(PrefaultBuffers);
+
+  /** Set/Get whether the response is also quantized to GetQuantizedOutput( ). Default is off. */
+  itkSetMacro(QuantizeOutput, bool);
+  itkGetConstMacro(QuantizeOutput, bool);
+  itkBooleanMacro(QuantizeOutput);
+
+  /** Set/Get the response values mapped to the minimum and maximum of the quantized pixel type. Default is -1 and 1. */
+  itkSetMacro(QuantizationMinimum, double);
+  itkGetConstMacro(QuantizationMinimum, double);
+  itkSetMacro(QuantizationMaximum, double);
+  itkGetConstMacro(QuantizationMaximum, double);
+
+  /** Scale and offset such that response = scale * quantized value + offset */
+  double GetQuantizationScale() const;
+  double GetQuantizationOffset() const;
+
+  /** Get the quantized response, an optional output. Its buffer is released by an update with QuantizeOutput off. */
+  QuantizedImageType * GetQuantizedOutput();
+
+  /** Keys of the scale and offset in the meta data dictionary of the quantized output */
+  static const char * GetQuantizationScaleKey()
+  {
+    return "QuantizationScale";
+  }
+  static const char * GetQuantizationOffsetKey()
+  {
+    return "QuantizationOffset";
+  }
+
+  /**
+   * Set/Get the number of planes along the slowest dimension streamed at once by the sliding slab
+   * Hessian. Zero processes whole images with the exact Hessian. A non-zero thickness replaces the
+   * exact Hessian by central differences of the smoothed input, which have a relative error of up to
+   * about 25% at a sigma of one voxel and 6% at two voxels. Default is zero.
+   */
+  itkSetMacro(SlabThickness, SizeValueType);
+  itkGetConstMacro(SlabThickness, SizeValueType);
+
+  /**
+   * Set/Get whether each scale smooths the input of the previous scale by the increment of sigma
+   * and takes the Hessian by central differences. Default is off.
+   */
+  itkSetMacro(IncrementalScaleSpace, bool);
+  itkGetConstMacro(IncrementalScaleSpace, bool);
+  itkBooleanMacro(IncrementalScaleSpace);
+
+  /** Flat block related typedefs. */
+  using FlatBlockMapType  = FlatBlockMap< ImageDimension >;
+  using FlatBlockSizeType = typename FlatBlockMapType::SizeType;
+
+  /** Set/Get whether the Hessian, eigenvalues and measure of flat blocks are skipped. Default is off. */
+  itkSetMacro(SkipFlatBlocks, bool);
+  itkGetConstMacro(SkipFlatBlocks, bool);
+  itkBooleanMacro(SkipFlatBlocks);
+
+  /** Set/Get the largest intensity range of a flat block, the same at every sigma. Default is zero. */
+  itkSetMacro(FlatBlockThreshold, double);
+  itkGetConstMacro(FlatBlockThreshold, double);
+
+  /** Set/Get the size of the blocks in voxels. Default is 16 along every dimension. */
+  itkSetMacro(FlatBlockSize, FlatBlockSizeType);
+  itkGetConstReferenceMacro(FlatBlockSize, FlatBlockSizeType);
+
+  /** Forward an abort request to the internal filters so they stop within a scanline. */
+  void SetAbortGenerateData(const bool abort) override;
+
+  /**
+   * Compute the response over a region using the fixed parameters, or else the parameters estimated
+   * by the last update, instead of estimating them again. The region is cropped to the largest possible
+   * region of the input. The returned image is buffered over the cropped region. The output of this
+   * filter is not modified. The Hessian is always computed with the exact method over the region, so
+   * with IncrementalScaleSpace or SlabThickness the response differs from the update by the error of
+   * the central differences. Throws if no parameters are fixed and the filter has not been updated since the
+   * sigma values, the input or the measure filter were modified.
+   */
+  typename TOutputImage::Pointer ComputeROI(const OutputImageRegionType & region);
+
+  /** Get the parameters used at a scale level by the last update, estimated or fixed. */
+  const MeasureParameterArrayType & GetScaleParameters(SigmaStepsType scaleLevel) const;
+
+  /**
+   * Set parameters of the measure which replace the parameter estimation. Either one entry is used at
+   * every sigma value or there is one entry per sigma value. ClearFixedParameters( ) estimates them again.
+   */
+  using ScaleParametersType = std::vector< MeasureParameterArrayType >;
+  void SetFixedParameters(const ScaleParametersType & parameters);
+  void SetFixedParameters(const MeasureParameterArrayType & parameters);
+  itkGetConstReferenceMacro(FixedParameters, ScaleParametersType);
+  void ClearFixedParameters();
+  bool GetUseFixedParameters() const
+  {
+    return !m_FixedParameters.empty();
+  }
+
+  /**
+   * Set/Get the number of scales at which the parameters are estimated. The parameters of the other
+   * scales are fitted. Zero, or at least the number of sigma values, estimates at every scale.
+   * Otherwise at least two anchors are used. Default is zero. Ignored with fixed parameters.
+   */
+  itkSetMacro(NumberOfAnchorScales, SigmaStepsType);
+  itkGetConstMacro(NumberOfAnchorScales, SigmaStepsType);
+
+  /** Get the scale levels at which the parameters were estimated by the last update, empty if all were. */
+  const std::vector< SigmaStepsType > & GetAnchorScaleLevels() const
+  {
+    return m_AnchorScaleLevels;
+  }
+
+  /**
+   * Fit the parameters at a sigma value from the parameters at anchor sigma values. A parameter
+   * positive at every anchor is fitted by a least squares power law, log(p) linear in log(sigma).
+   * Otherwise it is interpolated linearly in log(sigma) and held constant beyond the anchors.
+   */
+  static MeasureParameterArrayType FitScaleParameters(const std::vector< SigmaType > & anchorSigmas,
+                                                      const ScaleParametersType & anchorParameters, SigmaType sigma);
+
+  /**
+   * Estimate the parameters of a scale level and return the largest relative error of the
+   * parameters used by the last update. Zero for estimated scales, up to the estimation being
+   * deterministic. This runs the Hessian, eigenvalue analysis and estimation of the scale. The
+   * internal filters are left connected as the last update left them.
+   */
+  double ComputeParameterFitError(SigmaStepsType scaleLevel);
+
+  /** Get the per-stage timing and memory report of the last execution. */
+  const ExecutionReportType & GetExecutionReport() const
+  {
+    return m_ExecutionReport;
+  }
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   // Begin concept checking
   itkConceptMacro( InputOutputHaveSamePixelDimensionCheck,
                    ( Concept::SameDimension< TInputImage::ImageDimension, TOutputImage::ImageDimension >) );
+  itkConceptMacro( InputQuantizedHaveSamePixelDimensionCheck,
+                   ( Concept::SameDimension< TInputImage::ImageDimension, TQuantizedImage::ImageDimension >) );
+  itkConceptMacro( QuantizedPixelIsIntegerCheck,
+                   ( Concept::IsInteger< QuantizedImagePixelType >) );
   // End concept checking
 #endif
 protected:
@@ -177,19 +489,103 @@ protected:
   /** Internal function to generate the response at a scale */
   inline typename TOutputImage::Pointer generateResponseAtScale(SigmaStepsType scaleLevel);
 
+  /** Internal function to take the maximum with the response of the last scale and quantize it in one pass */
+  typename TOutputImage::Pointer mergeAndQuantizeResponse(const TOutputImage * maximum, TOutputImage * response);
+
+  /** Internal function to generate the response over all scales with overlapping scales */
+  typename TOutputImage::Pointer generatePipelinedResponse();
+
+  /** Internal function to generate the response over all scales in slabs, in the given order of scale levels */
+  typename TOutputImage::Pointer generateSlabbedResponse(const std::vector< SigmaStepsType > & scaleOrder);
+
+  /**
+   * Internal function to fold the response of a slab into the running maximum and quantize it if
+   * requested. The response of the first scale is copied.
+   */
+  void foldSlabResponse(TOutputImage * maximum, const TOutputImage * response, bool firstScale, bool quantize);
+
+  /** Internal function to set the parameters and connect the Hessian and eigenvalue analysis */
+  void ConnectEigenAnalysis();
+
+  /** Internal function to determine if the eigenvalues are streamed instead of held in memory */
+  bool GetStreamEigenImage() const
+  {
+    return m_LazyEigenImage || m_SlabThickness > 0;
+  }
+
+  /**
+   * Internal function to determine if the parameters kept by the last update are valid for the sigma
+   * values, the input and the measure filter.
+   */
+  bool ScaleParametersAreCurrent() const;
+
+  /** Internal function to determine if the parameters of a scale level are estimated in this execution */
+  bool IsEstimatedScale(SigmaStepsType scaleLevel) const;
+
+  /** Internal function to set the flat blocks of the sigma set on the Hessian. Returns null if blocks are not skipped. */
+  typename FlatBlockMapType::ConstPointer ComputeFlatBlocksAtScale();
+
+  /** Internal function to remove the flat blocks from the internal filters */
+  void ReleaseFlatBlocks();
+
+  /** Internal function to fit the parameters of the scales which are not anchors */
+  void FitNonAnchorScaleParameters();
+
+  /** Internal function to get the fixed parameters of a scale level */
+  const MeasureParameterArrayType & GetFixedParametersOfScale(SigmaStepsType scaleLevel) const;
+
+  /** Internal function to convert the parameters of the estimation to the type of the measure */
+  MeasureParameterArrayType GetEstimatedParameters() const;
+
   /** Internal function to convert types for EigenValueOrder */
   InternalEigenValueOrderType ConvertType(ExternalEigenValueOrderType order);
 
-  /** Override since the filter needs all the data for the algorithm */
+  /**
+   * Override since the filter needs all the data for the algorithm. With SlabThickness, only the first
+   * plane is requested and the slabs are requested from the input during the update.
+   */
   void GenerateInputRequestedRegion() override;
 
   OutputImageRegionType GetOutputRegion();
 
+  /** Create the float output or the quantized output */
+  using Superclass::MakeOutput;
+  DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx) override;
+
   /** Override since the filter produces all of its output */
   void EnlargeOutputRequestedRegion(DataObject *data) override;
 
   void PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Record start and end events of the internal filters in the execution report */
+  void RecordStageEvent(Object * caller, const EventObject & event);
+
+  /** Convert start, progress and end events of the internal filters to the progress of this filter */
+  void UpdateStageProgress(Object * caller, const EventObject & event);
+
+  /** Determine which stage an internal filter runs. Returns false for unknown filters. */
+  bool GetStageOfFilter(const Object * caller, ExecutionReportType::StageEnum & stage) const;
+
+  /** Modeled cost per voxel of a stage at the current sigma, not including the coefficient. */
+  double GetStageCostPerVoxel(ExecutionReportType::StageEnum stage) const;
+
+  /** The cost coefficients of the progress model, either set by the user or calibrated. */
+  const StageCostCoefficientsType & GetActiveStageCostCoefficients() const;
+
+  /** Modeled cost per voxel of the Hessian at the sigma currently set on the Hessian filter. */
+  double ComputeHessianCostPerVoxel() const;
+
+  /** Size of an image buffer in bytes */
+  template< typename TImage >
+  static SizeValueType GetBufferSizeInBytes(const TImage * image)
+  {
+    if (!image || !image->GetPixelContainer())
+    {
+      return 0;
+    }
+    return image->GetPixelContainer()->Size() * sizeof(typename TImage::PixelType);
+  }
+
 private:
   /** Internal filters. */
   typename HessianFilterType::Pointer                           m_HessianFilter;
@@ -197,9 +593,66 @@ private:
   typename MaximumAbsoluteValueFilterType::Pointer              m_MaximumAbsoluteValueFilter;
   typename EigenToMeasureImageFilterType::Pointer               m_EigenToMeasureImageFilter;
   typename EigenToMeasureParameterEstimationFilterType::Pointer m_EigenToMeasureParameterEstimationFilter;
+  typename MeasureStreamingFilterType::Pointer                  m_MeasureStreamingFilter;
+  typename PreprocessingFilterType::Pointer                     m_PreprocessingFilter;
 
   /** Sigma member variables. */
   SigmaArrayType  m_SigmaArray;
+  bool            m_PipelineScales;
+  bool            m_LazyEigenImage;
+  bool            m_IncrementalScaleSpace;
+  SizeValueType   m_SlabThickness;
+
+  /** Parameters set by the user instead of estimated. */
+  ScaleParametersType m_FixedParameters;
+
+  /** Scales at which the parameters are estimated. */
+  SigmaStepsType                 m_NumberOfAnchorScales;
+  std::vector< SigmaStepsType >  m_AnchorScaleLevels;
+
+  /** Parameters estimated at every sigma value by the last update. */
+  std::vector< MeasureParameterArrayType > m_ScaleParameters;
+  SigmaArrayType                           m_ScaleParametersSigmaArray;
+  TimeStamp                                m_ScaleParametersTime;
+
+  /** Quantization of the output. */
+  bool    m_QuantizeOutput;
+  double  m_QuantizationMinimum;
+  double  m_QuantizationMaximum;
+
+  /** Skipping of flat blocks. */
+  bool                                m_SkipFlatBlocks;
+  double                              m_FlatBlockThreshold;
+  FlatBlockSizeType                   m_FlatBlockSize;
+  typename FlatBlockMapType::Pointer  m_FlatBlockRanges;
+
+  /** Allocation policies. */
+  bool  m_UseHugePages;
+  bool  m_PrefaultBuffers;
+
+  /** Profiling of the last execution. */
+  ExecutionReportType m_ExecutionReport;
+
+  /** Progress cost model. */
+  StageCostCoefficientsType m_StageCostCoefficients;
+  bool                      m_StageCostCoefficientsSet;
+  StageCostCoefficientsType m_CalibratedStageCostCoefficients;
+  bool                      m_CalibrateStageCosts;
+  double                    m_HessianCostPerVoxel;
+
+  /** Progress state of the current execution. */
+  struct ProgressStage
+  {
+    const Object *  m_Filter;
+    double          m_Work;
+    bool            m_HasNestedStages;
+  };
+  std::map< std::thread::id, std::vector< ProgressStage > > m_ProgressStages;
+  std::mutex                    m_ProgressMutex;
+  StageCostCoefficientsType     m_StageModelCosts;
+  double                        m_TotalWork;
+  double                        m_CompletedWork;
+  std::atomic< float >          m_ReportedProgress;
 
 }; // end of class
 } // end namespace itk
@@ -20,16 +20,24 @@
 
 #include "itkMultiScaleHessianEnhancementImageFilter.h"
 #include "itkMath.h"
-#include "itkProgressAccumulator.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMultiThreaderBase.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <utility>
+#include <vector>
 
 namespace itk
 {
-template< typename TInputImage, typename TOutputImage >
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::MultiScaleHessianEnhancementImageFilter()
 {
   /* Sigma member variables */
   m_SigmaArray.SetSize(0);
+  m_ScaleParametersSigmaArray.SetSize(0);
 
   /* Instantiate filters. */
   m_HessianFilter                           = HessianFilterType::New();
@@ -37,14 +45,101 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   m_MaximumAbsoluteValueFilter              = MaximumAbsoluteValueFilterType::New();
   m_EigenToMeasureImageFilter               = nullptr; // has to be provided by the user.
   m_EigenToMeasureParameterEstimationFilter = nullptr; // has to be provided by the user.
+  m_PreprocessingFilter                     = nullptr; // optional, provided by the user.
+  m_MeasureStreamingFilter                  = MeasureStreamingFilterType::New();
+  m_MeasureStreamingFilter->SetRegionSplitter(ImageRegionSplitterSlowDimension::New());
+
+  /* Progress cost model */
+  m_StageCostCoefficients.Fill(1.0);
+  m_StageCostCoefficientsSet = false;
+  m_CalibratedStageCostCoefficients.Fill(1.0);
+  m_CalibrateStageCosts = true;
+  m_HessianCostPerVoxel = 0.0;
+  m_StageModelCosts.Fill(0.0);
+  m_TotalWork = 0.0;
+  m_CompletedWork = 0.0;
+  m_ReportedProgress = 0.0f;
+
+  /* Scales are processed one after the other by default */
+  m_PipelineScales = false;
+
+  /* Large buffers use the default allocation */
+  m_UseHugePages = false;
+  m_PrefaultBuffers = false;
+
+  /* The eigenvalue image is held in memory by default */
+  m_LazyEigenImage = false;
+
+  /* Every scale smooths the input from scratch by default */
+  m_IncrementalScaleSpace = false;
+
+  /* Whole images are processed by default */
+  m_SlabThickness = 0;
+
+  /* The parameters are estimated at every scale by default */
+  m_NumberOfAnchorScales = 0;
+
+  /* Every block is computed by default */
+  m_SkipFlatBlocks = false;
+  m_FlatBlockThreshold = 0.0;
+  m_FlatBlockSize.Fill(16);
+  m_FlatBlockRanges = nullptr;
+
+  /* The output is not quantized by default */
+  m_QuantizeOutput = false;
+  m_QuantizationMinimum = -1.0;
+  m_QuantizationMaximum = 1.0;
 
   /* We require an input image */
   this->SetNumberOfRequiredInputs( 1 );
+
+  /* The second output is the quantized response, which is only produced with QuantizeOutput on */
+  this->SetNumberOfRequiredOutputs( 1 );
+  this->SetNthOutput( 1, this->MakeOutput( 1 ) );
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+DataObject::Pointer
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::MakeOutput(DataObjectPointerArraySizeType idx)
+{
+  if ( idx == 1 )
+  {
+    return QuantizedImageType::New().GetPointer();
+  }
+  return Superclass::MakeOutput(idx);
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::QuantizedImageType *
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetQuantizedOutput()
+{
+  return dynamic_cast< QuantizedImageType * >( this->ProcessObject::GetOutput(1) );
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+double
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetQuantizationScale() const
+{
+  const double range = static_cast< double >( NumericTraits< QuantizedImagePixelType >::max() )
+    - static_cast< double >( NumericTraits< QuantizedImagePixelType >::NonpositiveMin() );
+  return ( m_QuantizationMaximum - m_QuantizationMinimum ) / range;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+double
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetQuantizationOffset() const
+{
+  return m_QuantizationMinimum
+    - this->GetQuantizationScale() * static_cast< double >( NumericTraits< QuantizedImagePixelType >::NonpositiveMin() );
 }
 
-template< typename TInputImage, typename TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
 void
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::GenerateInputRequestedRegion()
 {
   Superclass::GenerateInputRequestedRegion();
@@ -58,16 +153,25 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
     return;
   }
 
+  /* The slabs pull their own pieces of the input during the update, so only ask for one plane */
+  if ( m_SlabThickness > 0 )
+  {
+    InputImageRegionType region = inputPtr->GetLargestPossibleRegion();
+    region.SetSize(ImageDimension - 1, std::min< SizeValueType >( region.GetSize(ImageDimension - 1), 1 ));
+    inputPtr->SetRequestedRegion(region);
+    return;
+  }
+
   inputPtr->SetRequestedRegionToLargestPossibleRegion();
 }
 
-template< typename TInputImage, typename TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
 void
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::EnlargeOutputRequestedRegion(DataObject *data)
 {
   Superclass::EnlargeOutputRequestedRegion(data);
-  OutputImagePointer imgData = dynamic_cast< TOutputImage * >( data );
+  ImageBase< ImageDimension > * imgData = dynamic_cast< ImageBase< ImageDimension > * >( data );
 
   // if ( this->GetInput() )
   // {
@@ -100,9 +204,9 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   }
 }
 
-template< typename TInputImage, typename TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
 void
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::GenerateData()
 {
   /* Test all inputs are set */
@@ -111,7 +215,8 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
     itkExceptionMacro(<< "m_EigenToMeasureImageFilter is not present");
   }
 
-  if (!m_EigenToMeasureParameterEstimationFilter )
+  const bool useFixedParameters = this->GetUseFixedParameters();
+  if ( !m_EigenToMeasureParameterEstimationFilter && !useFixedParameters )
   {
     itkExceptionMacro(<< "m_EigenToMeasureParameterEstimationFilter is not present");
   }
@@ -121,26 +226,96 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
     itkExceptionMacro(<< "SigmaArray must have at least one sigma value. Given array of size " << m_SigmaArray.GetSize());
   }
 
-  /* Set filters parameters */
-  m_HessianFilter->SetNormalizeAcrossScale(true);
-  m_EigenAnalysisFilter->SetDimension(ImageDimension);
-  m_EigenAnalysisFilter->OrderEigenValuesBy(this->ConvertType(m_EigenToMeasureImageFilter->GetEigenValueOrder()));
+  if ( useFixedParameters && m_FixedParameters.size() != 1 && m_FixedParameters.size() != m_SigmaArray.GetSize() )
+  {
+    itkExceptionMacro(<< "FixedParameters must have one entry or one entry per sigma value. Given "
+                      << m_FixedParameters.size() << " entries for " << m_SigmaArray.GetSize() << " sigma values");
+  }
 
-  /* Connect filters */
-  m_HessianFilter->SetInput(this->GetInput());
-  m_EigenAnalysisFilter->SetInput(m_HessianFilter->GetOutput());
-  m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
-  m_EigenToMeasureImageFilter->SetInput(m_EigenToMeasureParameterEstimationFilter->GetOutput());
-  m_EigenToMeasureImageFilter->SetParametersInput(m_EigenToMeasureParameterEstimationFilter->GetParametersOutput());
+  if ( m_QuantizeOutput && !( m_QuantizationMaximum > m_QuantizationMinimum ) )
+  {
+    itkExceptionMacro(<< "QuantizationMaximum must be larger than QuantizationMinimum. Given "
+                      << m_QuantizationMinimum << " and " << m_QuantizationMaximum);
+  }
+
+  /* The ranges of the flat blocks are taken over the input, which says nothing about the preprocessed image */
+  if ( m_SkipFlatBlocks && m_PreprocessingFilter )
+  {
+    itkExceptionMacro(<< "SkipFlatBlocks cannot be combined with a PreprocessingFilter. Preprocess the input first.");
+  }
+
+  /* Set filters parameters and connect filters. The measure is connected for each scale. */
+  this->ConnectEigenAnalysis();
+  if (!useFixedParameters)
+  {
+    m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+  }
+  const unsigned int estimationStreamDivisions =
+    m_EigenToMeasureParameterEstimationFilter ? m_EigenToMeasureParameterEstimationFilter->GetNumberOfStreamDivisions() : 0;
+  if (m_SlabThickness > 0)
+  {
+    /* The estimation streams slabs of the given thickness along the slowest dimension */
+    const SizeValueType numberOfPlanes = this->GetInput()->GetLargestPossibleRegion().GetSize(ImageDimension - 1);
+    const unsigned int numberOfSlabs = static_cast< unsigned int >( ( numberOfPlanes + m_SlabThickness - 1 ) / m_SlabThickness );
+    if (m_EigenToMeasureParameterEstimationFilter)
+    {
+      m_EigenToMeasureParameterEstimationFilter->SetNumberOfStreamDivisions(numberOfSlabs);
+    }
+  }
+  else if (m_LazyEigenImage)
+  {
+    m_MeasureStreamingFilter->SetInput(m_EigenToMeasureImageFilter->GetOutput());
+    if (m_EigenToMeasureParameterEstimationFilter)
+    {
+      m_MeasureStreamingFilter->SetNumberOfStreamDivisions(estimationStreamDivisions);
+    }
+  }
+
+  /* Choose the scales at which the parameters are estimated */
+  m_AnchorScaleLevels.clear();
+  const SigmaStepsType numberOfScales = m_SigmaArray.GetSize();
+  if (!useFixedParameters && m_NumberOfAnchorScales > 0 && m_NumberOfAnchorScales < numberOfScales)
+  {
+    const SigmaStepsType numberOfAnchors = std::max< SigmaStepsType >(m_NumberOfAnchorScales, 2);
+    for (SigmaStepsType i = 0; i < numberOfAnchors; ++i)
+    {
+      m_AnchorScaleLevels.push_back(Math::Round< SigmaStepsType >( static_cast< double >( i * ( numberOfScales - 1 ) ) / ( numberOfAnchors - 1 ) ));
+    }
+  }
 
   /* Set the mask */
   MaskSpatialObjectTypeConstPointer mask = this->GetImageMask();
-  if (mask)
+  if (mask && !useFixedParameters)
   {
     m_EigenToMeasureParameterEstimationFilter->SetMask(mask);
     m_EigenToMeasureParameterEstimationFilter->SetMask(mask);
   }
 
+  /* The range of every block of the input is found once, the flat blocks of each scale follow from it */
+  m_FlatBlockRanges = nullptr;
+  if (m_SkipFlatBlocks)
+  {
+    m_FlatBlockRanges = FlatBlockMapType::New();
+    m_FlatBlockRanges->SetBlockSize(m_FlatBlockSize);
+    if (m_SlabThickness > 0)
+    {
+      /* Only one row of blocks of the input is requested at a time */
+      InputImagePointer inputPtr = const_cast< TInputImage * >( this->GetInput() );
+      m_FlatBlockRanges->InitializeBlockRanges(inputPtr->GetLargestPossibleRegion());
+      for (SizeValueType row = 0; row < m_FlatBlockRanges->GetGridSize()[ImageDimension - 1]; ++row)
+      {
+        inputPtr->SetRequestedRegion(m_FlatBlockRanges->GetBlockRowRegion(row));
+        inputPtr->PropagateRequestedRegion();
+        inputPtr->UpdateOutputData();
+        m_FlatBlockRanges->ComputeBlockRowRanges(inputPtr.GetPointer(), row, this);
+      }
+    }
+    else
+    {
+      m_FlatBlockRanges->ComputeBlockRanges(this->GetInput(), this);
+    }
+  }
+
   /* After executing we want to release data to save memory */
   // m_HessianFilter->ReleaseDataFlagOn();
   // m_EigenAnalysisFilter->ReleaseDataFlagOn();
@@ -148,81 +323,1300 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   // m_EigenToMeasureParameterEstimationFilter->ReleaseDataFlagOn();
   // m_MaximumAbsoluteValueFilter->ReleaseDataFlagOn();
 
-  /* Setup progress reporter */
-  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
-  progress->SetMiniPipelineFilter(this);
-
   /*
-   * We checked that m_SigmaArray.GetSize() > 0 above and do not need to repeat the check. However,
-   * if we are only given one sigma value we do not need to take the maximum over scales.
-   * 
-   * Two filters, ran m_SigmaArray.GetSize() times
-   * One filter, ran (m_SigmaArray.GetSize() - 1) times
-   * 
-   * We do not count the hessian or eigenanalysis filters since they will be streamed many times.
+   * Predict the total work from the cost model. Every stage produces every voxel once per sigma,
+   * even when streamed. With a lazy eigenvalue image, the Hessian and eigenvalues are produced
+   * twice. The maximum over scales is not needed for the first sigma, and the parameter estimation
+   * is only needed at the scales which are estimated.
    */
-  float numberOfFiltersToProcess = 2*m_SigmaArray.GetSize() + 1*(m_SigmaArray.GetSize()-1);
-  float perFilterProccessPercentage = 1.0 / numberOfFiltersToProcess;
-  itkDebugMacro(<< "each filter accounts for " << perFilterProccessPercentage*100.0 << "% of processing");
-
+  const double numberOfVoxels = static_cast< double >( this->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels() );
+  m_TotalWork = 0.0;
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    m_HessianFilter->SetSigma(m_SigmaArray.GetElement(scaleLevel));
+    m_HessianCostPerVoxel = this->ComputeHessianCostPerVoxel();
+    for (unsigned int stage = 0; stage < ExecutionReportType::NumberOfStages; ++stage)
+    {
+      const bool estimated = this->IsEstimatedScale(scaleLevel);
+      if ( ( stage == ExecutionReportType::MaximumAbsoluteValueStage && scaleLevel == 0 )
+           || ( stage == ExecutionReportType::ParameterEstimationStage && !estimated ) )
+      {
+        continue;
+      }
+      const double passes =
+        ( this->GetStreamEigenImage() && estimated && stage <= ExecutionReportType::EigenAnalysisStage ) ? 2.0 : 1.0;
+      m_TotalWork += passes * this->GetActiveStageCostCoefficients()[stage] * numberOfVoxels
+        * this->GetStageCostPerVoxel(static_cast< ExecutionReportType::StageEnum >(stage));
+    }
+  }
+  m_CompletedWork = 0.0;
+  m_StageModelCosts.Fill(0.0);
+  m_ProgressStages.clear();
+  m_ReportedProgress = 0.0f;
+  itkDebugMacro(<< "predicted total work " << m_TotalWork);
 
-  progress->RegisterInternalFilter(m_EigenToMeasureParameterEstimationFilter, 1.5*m_SigmaArray.GetSize()*perFilterProccessPercentage);
-  progress->RegisterInternalFilter(m_EigenToMeasureImageFilter, 0.5*m_SigmaArray.GetSize()*perFilterProccessPercentage);
+  /* Observe the internal filters to build the execution report */
+  m_ExecutionReport.Clear();
+  const double startWallTime = ExecutionReportType::WallClock();
+  const double startCPUTime = ExecutionReportType::CPUClock();
 
-  /* Check if we need to run the MaximumAbsoluteValueFilter at all */ 
-  if (m_SigmaArray.GetSize() > 1)
+  typename MemberCommand< Self >::Pointer stageCommand = MemberCommand< Self >::New();
+  stageCommand->SetCallbackFunction(this, &Self::RecordStageEvent);
+  typename MemberCommand< Self >::Pointer progressCommand = MemberCommand< Self >::New();
+  progressCommand->SetCallbackFunction(this, &Self::UpdateStageProgress);
+  std::vector< std::pair< ProcessObject *, unsigned long > > observerTags;
+  for (ProcessObject * filter : std::initializer_list< ProcessObject * >{m_HessianFilter, m_EigenAnalysisFilter,
+        m_EigenToMeasureParameterEstimationFilter, m_EigenToMeasureImageFilter, m_MaximumAbsoluteValueFilter})
   {
-    progress->RegisterInternalFilter(m_MaximumAbsoluteValueFilter, (m_SigmaArray.GetSize()-1)*perFilterProccessPercentage);
+    if (!filter)
+    {
+      continue;
+    }
+    observerTags.emplace_back(filter, filter->AddObserver(StartEvent(), stageCommand));
+    observerTags.emplace_back(filter, filter->AddObserver(EndEvent(), stageCommand));
+    observerTags.emplace_back(filter, filter->AddObserver(StartEvent(), progressCommand));
+    observerTags.emplace_back(filter, filter->AddObserver(ProgressEvent(), progressCommand));
+    observerTags.emplace_back(filter, filter->AddObserver(EndEvent(), progressCommand));
   }
-  else
+  auto removeObservers = [&observerTags]()
+  {
+    for (const auto & tag : observerTags)
+    {
+      tag.first->RemoveObserver(tag.second);
+    }
+  };
+
+  /*
+   * Allocation policies of this execution. They are enabled for this filter and its internal
+   * filters only, so other filters running at the same time keep the global policies.
+   */
+  std::vector< const Object * > allocatingFilters;
+  for (const Object * filter : std::initializer_list< const Object * >{this, m_HessianFilter, m_EigenAnalysisFilter,
+        m_EigenToMeasureParameterEstimationFilter, m_EigenToMeasureImageFilter, m_MaximumAbsoluteValueFilter,
+        m_PreprocessingFilter})
   {
-    itkDebugMacro(<< "maximumAbsoluteValueFilter is not being used");
+    if (!filter)
+    {
+      continue;
+    }
+    if (m_UseHugePages)
+    {
+      ImageBufferPool::EnableForFilter(filter, true);
+    }
+    if (m_PrefaultBuffers)
+    {
+      ParallelFirstTouchAllocator::EnableForFilter(filter);
+    }
+    allocatingFilters.push_back(filter);
   }
+  const bool useHugePages = m_UseHugePages;
+  const bool prefaultBuffers = m_PrefaultBuffers;
+  auto restoreAllocationPolicies = [allocatingFilters, useHugePages, prefaultBuffers]()
+  {
+    for (const Object * filter : allocatingFilters)
+    {
+      if (useHugePages)
+      {
+        ImageBufferPool::DisableForFilter(filter);
+      }
+      if (prefaultBuffers)
+      {
+        ParallelFirstTouchAllocator::DisableForFilter(filter);
+      }
+    }
+  };
+
+  /* The slabs override the stream divisions of the estimation set by the user */
+  auto restoreEstimationStreamDivisions = [this, estimationStreamDivisions]()
+  {
+    if (m_EigenToMeasureParameterEstimationFilter)
+    {
+      m_EigenToMeasureParameterEstimationFilter->SetNumberOfStreamDivisions(estimationStreamDivisions);
+    }
+  };
 
   /* We store a single pointer that we will graft to the output */
   typename TOutputImage::Pointer outputImagePointer;
+  m_ScaleParameters.assign(numberOfScales, MeasureParameterArrayType());
 
-  /* Process the first scale */
-  outputImagePointer = generateResponseAtScale((SigmaStepsType)0);
+  /* The anchor scales are processed first so the parameters of the others can be fitted */
+  std::vector< SigmaStepsType > scaleOrder(m_AnchorScaleLevels);
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < numberOfScales; ++scaleLevel)
+  {
+    if (std::find(m_AnchorScaleLevels.begin(), m_AnchorScaleLevels.end(), scaleLevel) == m_AnchorScaleLevels.end())
+    {
+      scaleOrder.push_back(scaleLevel);
+    }
+  }
 
-  /* Process the remaining sigma values */
-  for (SigmaStepsType scaleLevel = 1; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  try
   {
-    /* Calculate next response value */
-    typename TOutputImage::Pointer tempResponseImagePointer = generateResponseAtScale(scaleLevel);
+    if (m_PipelineScales && !this->GetStreamEigenImage() && !useFixedParameters && m_AnchorScaleLevels.empty())
+    {
+      outputImagePointer = generatePipelinedResponse();
+    }
+    else if (m_SlabThickness > 0)
+    {
+      outputImagePointer = generateSlabbedResponse(scaleOrder);
+    }
+    else
+    {
+      /* Process the first scale */
+      outputImagePointer = generateResponseAtScale(scaleOrder[0]);
+      if (m_QuantizeOutput && numberOfScales == 1)
+      {
+        outputImagePointer = this->mergeAndQuantizeResponse(nullptr, outputImagePointer);
+      }
 
-    /* Take absolute value maximum */
-    m_MaximumAbsoluteValueFilter->SetInput1(outputImagePointer);
-    m_MaximumAbsoluteValueFilter->SetInput2(tempResponseImagePointer);
-    // m_MaximumAbsoluteValueFilter->GetOutput()->SetRequestedRegion(this->GetOutputRegion());
-    m_MaximumAbsoluteValueFilter->Update();
+      /* Process the remaining sigma values */
+      for (SigmaStepsType i = 1; i < numberOfScales; ++i)
+      {
+        if (i == m_AnchorScaleLevels.size())
+        {
+          this->FitNonAnchorScaleParameters();
+        }
 
-    /* Save max and go to next sigma value */
-    outputImagePointer = m_MaximumAbsoluteValueFilter->GetOutput();
+        /* Calculate next response value */
+        typename TOutputImage::Pointer tempResponseImagePointer = generateResponseAtScale(scaleOrder[i]);
+        if (m_QuantizeOutput && i + 1 == numberOfScales)
+        {
+          outputImagePointer = this->mergeAndQuantizeResponse(outputImagePointer, tempResponseImagePointer);
+          break;
+        }
+
+        /* Take absolute value maximum */
+        m_MaximumAbsoluteValueFilter->SetInput1(outputImagePointer);
+        m_MaximumAbsoluteValueFilter->SetInput2(tempResponseImagePointer);
+        // m_MaximumAbsoluteValueFilter->GetOutput()->SetRequestedRegion(this->GetOutputRegion());
+        m_MaximumAbsoluteValueFilter->UpdateLargestPossibleRegion();
+
+        /* Save max and go to next sigma value */
+        outputImagePointer = m_MaximumAbsoluteValueFilter->GetOutput();
+        outputImagePointer->DisconnectPipeline();
+      }
+    }
+  }
+  catch (...)
+  {
+    /*
+     * Free the intermediate images right away. A filter which failed while updating its
+     * inputs is still marked as updating, so reset the internal pipeline as well.
+     */
+    removeObservers();
+    restoreAllocationPolicies();
+    restoreEstimationStreamDivisions();
+    m_HessianFilter->ReleaseScaleSpace();
+    this->ReleaseFlatBlocks();
+    m_ScaleParameters.clear();
+    for (ProcessObject * filter : std::initializer_list< ProcessObject * >{m_PreprocessingFilter, m_HessianFilter,
+          m_EigenAnalysisFilter, m_EigenToMeasureParameterEstimationFilter, m_EigenToMeasureImageFilter,
+          m_MaximumAbsoluteValueFilter, m_MeasureStreamingFilter})
+    {
+      if (!filter)
+      {
+        continue;
+      }
+      filter->GetOutput(0)->ReleaseData();
+      filter->ResetPipeline();
+    }
+    throw;
+  }
+  removeObservers();
+  restoreAllocationPolicies();
+  restoreEstimationStreamDivisions();
+  m_HessianFilter->ReleaseScaleSpace();
+  this->ReleaseFlatBlocks();
+  if (m_PreprocessingFilter)
+  {
+    m_PreprocessingFilter->GetOutput()->ReleaseData();
+  }
+  m_ScaleParametersSigmaArray = m_SigmaArray;
+  m_ScaleParametersTime.Modified();
+
+  m_ExecutionReport.SetTotalWallTime(ExecutionReportType::WallClock() - startWallTime);
+  m_ExecutionReport.SetTotalCPUTime(ExecutionReportType::CPUClock() - startCPUTime);
+  itkDebugMacro(<< "execution report " << m_ExecutionReport);
+
+  /* Measure the cost coefficients so the next execution reports time-linear progress */
+  if (m_CalibrateStageCosts)
+  {
+    for (unsigned int stage = 0; stage < ExecutionReportType::NumberOfStages; ++stage)
+    {
+      const double wallTime = m_ExecutionReport.GetStageTotal(static_cast< ExecutionReportType::StageEnum >(stage)).m_WallTime;
+      if (wallTime > 0.0 && m_StageModelCosts[stage] > 0.0)
+      {
+        m_CalibratedStageCostCoefficients[stage] = wallTime / m_StageModelCosts[stage];
+      }
+    }
+    itkDebugMacro(<< "calibrated stage cost coefficients " << m_CalibratedStageCostCoefficients);
+  }
+
+  /* The quantized output is optional, so do not leave the response of an earlier execution in it */
+  if (!m_QuantizeOutput)
+  {
+    this->GetQuantizedOutput()->ReleaseData();
   }
 
   /* Graft output and we're done! */
   this->GraftOutput(outputImagePointer);
 }
 
-template< typename TInputImage, typename TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::SetAbortGenerateData(const bool abort)
+{
+  Superclass::SetAbortGenerateData(abort);
+  if (!abort)
+  {
+    /* Internal filters clear their own flag when they start */
+    return;
+  }
+
+  for (ProcessObject * filter : std::initializer_list< ProcessObject * >{m_PreprocessingFilter, m_HessianFilter,
+        m_EigenAnalysisFilter, m_EigenToMeasureParameterEstimationFilter, m_EigenToMeasureImageFilter,
+        m_MaximumAbsoluteValueFilter})
+  {
+    if (filter)
+    {
+      filter->SetAbortGenerateData(true);
+    }
+  }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::RecordStageEvent(Object * caller, const EventObject & event)
+{
+  ExecutionReportType::StageEnum stage;
+  if (!this->GetStageOfFilter(caller, stage))
+  {
+    return;
+  }
+
+  /* Determine the size of the buffer the stage produced */
+  const bool isEnd = EndEvent().CheckEvent(&event);
+  SizeValueType bufferSize = 0;
+  if (isEnd)
+  {
+    switch (stage)
+    {
+    case ExecutionReportType::HessianStage:
+      bufferSize = GetBufferSizeInBytes(m_HessianFilter->GetOutput());
+      break;
+    case ExecutionReportType::EigenAnalysisStage:
+      bufferSize = GetBufferSizeInBytes(m_EigenAnalysisFilter->GetOutput());
+      break;
+    case ExecutionReportType::ParameterEstimationStage:
+      bufferSize = GetBufferSizeInBytes(m_EigenToMeasureParameterEstimationFilter->GetOutput());
+      break;
+    case ExecutionReportType::MeasureStage:
+      bufferSize = GetBufferSizeInBytes(m_EigenToMeasureImageFilter->GetOutput());
+      break;
+    case ExecutionReportType::MaximumAbsoluteValueStage:
+      bufferSize = GetBufferSizeInBytes(m_MaximumAbsoluteValueFilter->GetOutput());
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (isEnd)
+  {
+    m_ExecutionReport.EndStage(stage, bufferSize);
+  }
+  else if (StartEvent().CheckEvent(&event))
+  {
+    m_ExecutionReport.BeginStage(stage);
+  }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::UpdateStageProgress(Object * caller, const EventObject & event)
+{
+  ExecutionReportType::StageEnum stage;
+  if (!this->GetStageOfFilter(caller, stage))
+  {
+    return;
+  }
+  ProcessObject * filter = static_cast< ProcessObject * >(caller);
+
+  /* Stages may run on several threads when scales are pipelined */
+  double work;
+  {
+    std::lock_guard< std::mutex > lock(m_ProgressMutex);
+    std::vector< ProgressStage > & progressStages = m_ProgressStages[std::this_thread::get_id()];
+    work = m_CompletedWork;
+    if (StartEvent().CheckEvent(&event))
+    {
+      /* The work of an execution is proportional to the voxels it produces */
+      double numberOfVoxels = 0.0;
+      const ImageBase< ImageDimension > * output = dynamic_cast< const ImageBase< ImageDimension > * >( filter->GetOutput(0) );
+      if (output)
+      {
+        numberOfVoxels = static_cast< double >( output->GetRequestedRegion().GetNumberOfPixels() );
+      }
+      const double modelCost = numberOfVoxels * this->GetStageCostPerVoxel(stage);
+      m_StageModelCosts[stage] += modelCost;
+
+      if (!progressStages.empty())
+      {
+        progressStages.back().m_HasNestedStages = true;
+      }
+      ProgressStage progressStage;
+      progressStage.m_Filter = caller;
+      progressStage.m_Work = this->GetActiveStageCostCoefficients()[stage] * modelCost;
+      progressStage.m_HasNestedStages = false;
+      progressStages.push_back(progressStage);
+      return;
+    }
+    else if (ProgressEvent().CheckEvent(&event))
+    {
+      /* Propagate an abort request to the internal filter */
+      if (this->GetAbortGenerateData())
+      {
+        filter->AbortGenerateDataOn();
+      }
+
+      /* The progress of a stage which streams nested stages would count them twice */
+      if (progressStages.empty() || progressStages.back().m_Filter != caller || progressStages.back().m_HasNestedStages)
+      {
+        return;
+      }
+      work += filter->GetProgress() * progressStages.back().m_Work;
+    }
+    else if (EndEvent().CheckEvent(&event))
+    {
+      if (progressStages.empty() || progressStages.back().m_Filter != caller)
+      {
+        return;
+      }
+      m_CompletedWork += progressStages.back().m_Work;
+      progressStages.pop_back();
+      work = m_CompletedWork;
+    }
+    else
+    {
+      return;
+    }
+  }
+
+  /* Only ever increase the reported progress */
+  const float progress = (m_TotalWork > 0.0) ? static_cast< float >( std::min(work / m_TotalWork, 1.0) ) : 0.0f;
+  float reported = m_ReportedProgress.load();
+  while (progress > reported)
+  {
+    if (m_ReportedProgress.compare_exchange_weak(reported, progress))
+    {
+      this->UpdateProgress(progress);
+      break;
+    }
+  }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+bool
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetStageOfFilter(const Object * caller, ExecutionReportType::StageEnum & stage) const
+{
+  if (caller == m_HessianFilter.GetPointer())
+  {
+    stage = ExecutionReportType::HessianStage;
+  }
+  else if (caller == m_EigenAnalysisFilter.GetPointer())
+  {
+    stage = ExecutionReportType::EigenAnalysisStage;
+  }
+  else if (caller == m_EigenToMeasureParameterEstimationFilter.GetPointer())
+  {
+    stage = ExecutionReportType::ParameterEstimationStage;
+  }
+  else if (caller == m_EigenToMeasureImageFilter.GetPointer())
+  {
+    stage = ExecutionReportType::MeasureStage;
+  }
+  else if (caller == m_MaximumAbsoluteValueFilter.GetPointer())
+  {
+    stage = ExecutionReportType::MaximumAbsoluteValueStage;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::SetStageCostCoefficients(const StageCostCoefficientsType & coefficients)
+{
+  /* Explicit coefficients take precedence over the calibrated ones */
+  if (m_StageCostCoefficientsSet && m_StageCostCoefficients == coefficients)
+  {
+    return;
+  }
+  m_StageCostCoefficients = coefficients;
+  m_StageCostCoefficientsSet = true;
+  this->Modified();
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+const typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::StageCostCoefficientsType &
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetActiveStageCostCoefficients() const
+{
+  if (m_StageCostCoefficientsSet || !m_CalibrateStageCosts)
+  {
+    return m_StageCostCoefficients;
+  }
+  return m_CalibratedStageCostCoefficients;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+double
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetStageCostPerVoxel(ExecutionReportType::StageEnum stage) const
+{
+  /* Relative number of operations per output voxel. The Hessian depends on sigma and is cached. */
+  const double numberOfDerivatives = ImageDimension * (ImageDimension + 1) / 2.0;
+  switch (stage)
+  {
+  case ExecutionReportType::HessianStage:
+    return m_HessianCostPerVoxel;
+  case ExecutionReportType::EigenAnalysisStage:
+    return 10.0 * numberOfDerivatives;
+  case ExecutionReportType::ParameterEstimationStage:
+    return 2.0 * ImageDimension;
+  case ExecutionReportType::MeasureStage:
+    return 4.0 * ImageDimension;
+  case ExecutionReportType::MaximumAbsoluteValueStage:
+    return 1.0;
+  default:
+    return 0.0;
+  }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+double
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ComputeHessianCostPerVoxel() const
+{
+  /* Every derivative is a separable convolution followed by a copy */
+  const typename HessianFilterType::RadiusType radius = m_HessianFilter->GetKernelRadius();
+  double kernelWidths = 1.0;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    kernelWidths += 2.0 * radius[i] + 1.0;
+  }
+  return ImageDimension * (ImageDimension + 1) / 2.0 * kernelWidths;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
 typename TOutputImage::Pointer
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::generateResponseAtScale(SigmaStepsType scaleLevel)
 {
   /* Get this sigma value */
   SigmaType thisSigma = m_SigmaArray.GetElement(scaleLevel);
 
   /* Process pipeline and return */
+  m_ExecutionReport.SetCurrentScale(scaleLevel, thisSigma);
   m_HessianFilter->SetSigma(thisSigma);
+  m_HessianCostPerVoxel = this->ComputeHessianCostPerVoxel();
+  m_EigenToMeasureImageFilter->SetFlatBlocks(this->ComputeFlatBlocksAtScale());
   // m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(this->GetOutputRegion());
-  m_EigenToMeasureImageFilter->Update();
-  return m_EigenToMeasureImageFilter->GetOutput();
+  typename TOutputImage::Pointer responseImagePointer;
+  if (!this->IsEstimatedScale(scaleLevel))
+  {
+    /* No estimation, the measure pulls the eigenvalues directly with fixed or fitted parameters */
+    if (this->GetUseFixedParameters())
+    {
+      m_ScaleParameters[scaleLevel] = this->GetFixedParametersOfScale(scaleLevel);
+    }
+    m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+    m_EigenToMeasureImageFilter->SetParameters(m_ScaleParameters[scaleLevel]);
+    if (this->GetStreamEigenImage())
+    {
+      m_MeasureStreamingFilter->UpdateLargestPossibleRegion();
+      responseImagePointer = m_MeasureStreamingFilter->GetOutput();
+    }
+    else
+    {
+      m_EigenToMeasureImageFilter->UpdateLargestPossibleRegion();
+      responseImagePointer = m_EigenToMeasureImageFilter->GetOutput();
+    }
+    responseImagePointer->DisconnectPipeline();
+    return responseImagePointer;
+  }
+
+  m_EigenToMeasureImageFilter->SetParametersInput(m_EigenToMeasureParameterEstimationFilter->GetParametersOutput());
+  if (this->GetStreamEigenImage())
+  {
+    /* Estimate the parameters first, then stream the measure over the eigenvalues again */
+    m_EigenToMeasureParameterEstimationFilter->CopyInputToOutputOff();
+    m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+    m_EigenToMeasureParameterEstimationFilter->UpdateLargestPossibleRegion();
+    m_MeasureStreamingFilter->UpdateLargestPossibleRegion();
+    responseImagePointer = m_MeasureStreamingFilter->GetOutput();
+  }
+  else
+  {
+    m_EigenToMeasureParameterEstimationFilter->CopyInputToOutputOn();
+    m_EigenToMeasureImageFilter->SetInput(m_EigenToMeasureParameterEstimationFilter->GetOutput());
+    m_EigenToMeasureImageFilter->UpdateLargestPossibleRegion();
+    responseImagePointer = m_EigenToMeasureImageFilter->GetOutput();
+  }
+  m_ScaleParameters[scaleLevel] = this->GetEstimatedParameters();
+
+  /* The next scale would overwrite the response otherwise */
+  responseImagePointer->DisconnectPipeline();
+  return responseImagePointer;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename TOutputImage::Pointer
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::generatePipelinedResponse()
+{
+  /*
+   * The measure and maximum over scales of one sigma value run on a worker thread while the
+   * parameters of the next sigma value are estimated. The images passed between the two are
+   * disconnected so the two pipelines do not share any data objects.
+   */
+  typename TOutputImage::Pointer outputImagePointer;
+  std::future< typename TOutputImage::Pointer > pendingResponse;
+  m_EigenToMeasureParameterEstimationFilter->CopyInputToOutputOn();
+  try
+  {
+    for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+    {
+      /* Estimate the parameters, which streams the Hessian and eigenvalue analysis */
+      const SigmaType thisSigma = m_SigmaArray.GetElement(scaleLevel);
+      m_ExecutionReport.SetCurrentScale(scaleLevel, thisSigma);
+      m_HessianFilter->SetSigma(thisSigma);
+      m_HessianCostPerVoxel = this->ComputeHessianCostPerVoxel();
+      const typename FlatBlockMapType::ConstPointer flatBlocks = this->ComputeFlatBlocksAtScale();
+      m_EigenToMeasureParameterEstimationFilter->UpdateLargestPossibleRegion();
+
+      typename EigenValueImageType::Pointer eigenImage = m_EigenToMeasureParameterEstimationFilter->GetOutput();
+      eigenImage->DisconnectPipeline();
+      const MeasureParameterArrayType parameters = this->GetEstimatedParameters();
+      m_ScaleParameters[scaleLevel] = parameters;
+
+      /* The previous scale has to be merged before this one can be */
+      if (pendingResponse.valid())
+      {
+        outputImagePointer = pendingResponse.get();
+      }
+
+      pendingResponse = std::async(std::launch::async,
+        [this, scaleLevel, thisSigma, eigenImage, parameters, flatBlocks, outputImagePointer]() -> typename TOutputImage::Pointer
+        {
+          m_ExecutionReport.SetCurrentScale(scaleLevel, thisSigma);
+          m_EigenToMeasureImageFilter->SetFlatBlocks(flatBlocks);
+          m_EigenToMeasureImageFilter->SetInput(eigenImage);
+          m_EigenToMeasureImageFilter->SetParameters(parameters);
+          m_EigenToMeasureImageFilter->UpdateLargestPossibleRegion();
+          typename TOutputImage::Pointer responseImagePointer = m_EigenToMeasureImageFilter->GetOutput();
+          responseImagePointer->DisconnectPipeline();
+          if (m_QuantizeOutput && scaleLevel + 1 == m_SigmaArray.GetSize())
+          {
+            return this->mergeAndQuantizeResponse(outputImagePointer, responseImagePointer);
+          }
+          if (!outputImagePointer)
+          {
+            return responseImagePointer;
+          }
+
+          m_MaximumAbsoluteValueFilter->SetInput1(outputImagePointer);
+          m_MaximumAbsoluteValueFilter->SetInput2(responseImagePointer);
+          m_MaximumAbsoluteValueFilter->UpdateLargestPossibleRegion();
+          typename TOutputImage::Pointer maximumImagePointer = m_MaximumAbsoluteValueFilter->GetOutput();
+          maximumImagePointer->DisconnectPipeline();
+          return maximumImagePointer;
+        });
+    }
+    outputImagePointer = pendingResponse.get();
+  }
+  catch (...)
+  {
+    /* Never leave the worker running on filters which are about to be reset */
+    if (pendingResponse.valid())
+    {
+      pendingResponse.wait();
+    }
+    throw;
+  }
+
+  /* Release the references held by the internal filters */
+  m_EigenToMeasureImageFilter->SetInput(nullptr);
+  m_MaximumAbsoluteValueFilter->SetInput1(nullptr);
+  m_MaximumAbsoluteValueFilter->SetInput2(nullptr);
+  return outputImagePointer;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename TOutputImage::Pointer
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::generateSlabbedResponse(const std::vector< SigmaStepsType > & scaleOrder)
+{
+  /*
+   * The running maximum is the only image held over the whole volume. The measure of every slab
+   * is folded into it in place, so the response of a scale is never held over the whole volume.
+   */
+  const OutputImageRegionType largestRegion = this->GetOutput()->GetLargestPossibleRegion();
+  typename TOutputImage::Pointer maximumImagePointer = TOutputImage::New();
+  maximumImagePointer->CopyInformation(this->GetOutput());
+  maximumImagePointer->SetRegions(largestRegion);
+  ParallelFirstTouchAllocator::Allocate(maximumImagePointer.GetPointer(), this);
+  if (m_QuantizeOutput)
+  {
+    QuantizedImageType * quantized = this->GetQuantizedOutput();
+    quantized->CopyInformation(maximumImagePointer);
+    quantized->SetBufferedRegion(largestRegion);
+    ParallelFirstTouchAllocator::Allocate(quantized, this);
+  }
+
+  const unsigned int slowest = ImageDimension - 1;
+  const SizeValueType numberOfPlanes = largestRegion.GetSize(slowest);
+  for (SigmaStepsType i = 0; i < scaleOrder.size(); ++i)
+  {
+    if (i > 0 && i == m_AnchorScaleLevels.size())
+    {
+      this->FitNonAnchorScaleParameters();
+    }
+
+    const SigmaStepsType scaleLevel = scaleOrder[i];
+    const SigmaType thisSigma = m_SigmaArray.GetElement(scaleLevel);
+    m_ExecutionReport.SetCurrentScale(scaleLevel, thisSigma);
+    m_HessianFilter->SetSigma(thisSigma);
+    m_HessianCostPerVoxel = this->ComputeHessianCostPerVoxel();
+    m_EigenToMeasureImageFilter->SetFlatBlocks(this->ComputeFlatBlocksAtScale());
+
+    /* The estimation streams the slabs without keeping the eigenvalues */
+    if (this->IsEstimatedScale(scaleLevel))
+    {
+      m_EigenToMeasureParameterEstimationFilter->CopyInputToOutputOff();
+      m_EigenToMeasureParameterEstimationFilter->UpdateLargestPossibleRegion();
+      m_ScaleParameters[scaleLevel] = this->GetEstimatedParameters();
+    }
+    else if (this->GetUseFixedParameters())
+    {
+      m_ScaleParameters[scaleLevel] = this->GetFixedParametersOfScale(scaleLevel);
+    }
+    m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+    m_EigenToMeasureImageFilter->SetParameters(m_ScaleParameters[scaleLevel]);
+
+    /* Each slab pulls its planes and the halo of the kernel from the input */
+    const bool quantize = m_QuantizeOutput && i + 1 == scaleOrder.size();
+    for (SizeValueType firstPlane = 0; firstPlane < numberOfPlanes; firstPlane += m_SlabThickness)
+    {
+      if ( this->GetAbortGenerateData() )
+      {
+        throw ProcessAborted(__FILE__, __LINE__);
+      }
+      OutputImageRegionType slab = largestRegion;
+      slab.SetIndex(slowest, largestRegion.GetIndex(slowest) + static_cast< IndexValueType >( firstPlane ));
+      slab.SetSize(slowest, std::min(m_SlabThickness, numberOfPlanes - firstPlane));
+      m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(slab);
+      m_EigenToMeasureImageFilter->Update();
+      this->foldSlabResponse(maximumImagePointer, m_EigenToMeasureImageFilter->GetOutput(), i == 0, quantize);
+    }
+  }
+
+  /* Release the slabs held by the internal filters */
+  m_EigenToMeasureImageFilter->SetInput(nullptr);
+  m_EigenToMeasureImageFilter->GetOutput()->ReleaseData();
+  m_EigenAnalysisFilter->GetOutput()->ReleaseData();
+  m_HessianFilter->GetOutput()->ReleaseData();
+
+  if (m_QuantizeOutput)
+  {
+    /* Record how to convert back to the response */
+    MetaDataDictionary & dictionary = this->GetQuantizedOutput()->GetMetaDataDictionary();
+    EncapsulateMetaData< double >(dictionary, GetQuantizationScaleKey(), this->GetQuantizationScale());
+    EncapsulateMetaData< double >(dictionary, GetQuantizationOffsetKey(), this->GetQuantizationOffset());
+  }
+  return maximumImagePointer;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::foldSlabResponse(TOutputImage * maximum, const TOutputImage * response, bool firstScale, bool quantize)
+{
+  const OutputImageRegionType region = response->GetBufferedRegion();
+  QuantizedImageType * quantized = quantize ? this->GetQuantizedOutput() : nullptr;
+  const double scale = this->GetQuantizationScale();
+  const double offset = this->GetQuantizationOffset();
+  const double lower = static_cast< double >( NumericTraits< QuantizedImagePixelType >::NonpositiveMin() );
+  const double upper = static_cast< double >( NumericTraits< QuantizedImagePixelType >::max() );
+
+  /* The fold replaces the maximum filter from the second scale on, so it is reported as that filter */
+  ProcessObject * progressFilter = nullptr;
+  if (!firstScale)
+  {
+    m_ExecutionReport.BeginStage(ExecutionReportType::MaximumAbsoluteValueStage);
+    progressFilter = m_MaximumAbsoluteValueFilter;
+    m_MaximumAbsoluteValueFilter->GetOutput()->SetRequestedRegion(region);
+    m_MaximumAbsoluteValueFilter->SetAbortGenerateData(false);
+    this->UpdateStageProgress(progressFilter, StartEvent());
+  }
+  MultiThreaderBase * multiThreader = this->GetMultiThreader();
+  multiThreader->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  multiThreader->template ParallelizeImageRegion< ImageDimension >(
+    region,
+    [maximum, response, quantized, firstScale, scale, offset, lower, upper](const OutputImageRegionType & lineRegion)
+    {
+    ImageScanlineConstIterator< TOutputImage > rt(response, lineRegion);
+    ImageScanlineIterator< TOutputImage > mt(maximum, lineRegion);
+    ImageScanlineIterator< QuantizedImageType > qt;
+    if (quantized)
+      {
+      qt = ImageScanlineIterator< QuantizedImageType >(quantized, lineRegion);
+      }
+    while ( !rt.IsAtEnd() )
+      {
+      while ( !rt.IsAtEndOfLine() )
+        {
+        OutputImagePixelType value = rt.Get();
+        if ( !firstScale && Math::abs(mt.Get()) > Math::abs(value) )
+          {
+          value = mt.Get();
+          }
+        mt.Set(value);
+        if (quantized)
+          {
+          const double level = std::min(std::max(std::round(( static_cast< double >( value ) - offset ) / scale), lower), upper);
+          qt.Set(static_cast< QuantizedImagePixelType >( level ));
+          ++qt;
+          }
+        ++rt;
+        ++mt;
+        }
+      if (quantized)
+        {
+        qt.NextLine();
+        }
+      rt.NextLine();
+      mt.NextLine();
+      }
+    },
+    progressFilter);
+  if (!firstScale)
+  {
+    this->UpdateStageProgress(progressFilter, EndEvent());
+    m_ExecutionReport.EndStage(ExecutionReportType::MaximumAbsoluteValueStage, GetBufferSizeInBytes(response));
+  }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename TOutputImage::Pointer
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::mergeAndQuantizeResponse(const TOutputImage * maximum, TOutputImage * response)
+{
+  /*
+   * The maximum is written over the response, which is disconnected and not used afterwards,
+   * and quantized in the same pass so the response is only read once.
+   */
+  const OutputImageRegionType region = response->GetBufferedRegion();
+  QuantizedImageType * quantized = this->GetQuantizedOutput();
+  quantized->CopyInformation(response);
+  quantized->SetBufferedRegion(region);
+  ParallelFirstTouchAllocator::Allocate(quantized, this);
+
+  const double scale = this->GetQuantizationScale();
+  const double offset = this->GetQuantizationOffset();
+  const double lower = static_cast< double >( NumericTraits< QuantizedImagePixelType >::NonpositiveMin() );
+  const double upper = static_cast< double >( NumericTraits< QuantizedImagePixelType >::max() );
+
+  /*
+   * The merge replaces the last execution of the maximum filter, so it is reported as that
+   * filter. Its requested region sets the work of the stage.
+   */
+  ProcessObject * progressFilter = nullptr;
+  if (maximum)
+  {
+    m_ExecutionReport.BeginStage(ExecutionReportType::MaximumAbsoluteValueStage);
+    progressFilter = m_MaximumAbsoluteValueFilter;
+    m_MaximumAbsoluteValueFilter->GetOutput()->SetRequestedRegion(region);
+    m_MaximumAbsoluteValueFilter->SetAbortGenerateData(false);
+    this->UpdateStageProgress(progressFilter, StartEvent());
+  }
+  MultiThreaderBase * multiThreader = this->GetMultiThreader();
+  multiThreader->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  multiThreader->template ParallelizeImageRegion< ImageDimension >(
+    region,
+    [maximum, response, quantized, scale, offset, lower, upper](const OutputImageRegionType & lineRegion)
+    {
+    ImageScanlineIterator< TOutputImage > rt(response, lineRegion);
+    ImageScanlineIterator< QuantizedImageType > qt(quantized, lineRegion);
+    ImageScanlineConstIterator< TOutputImage > mt;
+    if (maximum)
+      {
+      mt = ImageScanlineConstIterator< TOutputImage >(maximum, lineRegion);
+      }
+    while ( !rt.IsAtEnd() )
+      {
+      while ( !rt.IsAtEndOfLine() )
+        {
+        OutputImagePixelType value = rt.Get();
+        if (maximum)
+          {
+          const OutputImagePixelType other = mt.Get();
+          if ( Math::abs(other) > Math::abs(value) )
+            {
+            value = other;
+            rt.Set(value);
+            }
+          ++mt;
+          }
+        const double level = std::min(std::max(std::round(( static_cast< double >( value ) - offset ) / scale), lower), upper);
+        qt.Set(static_cast< QuantizedImagePixelType >( level ));
+        ++rt;
+        ++qt;
+        }
+      if (maximum)
+        {
+        mt.NextLine();
+        }
+      rt.NextLine();
+      qt.NextLine();
+      }
+    },
+    progressFilter);
+  if (maximum)
+  {
+    this->UpdateStageProgress(progressFilter, EndEvent());
+    m_ExecutionReport.EndStage(ExecutionReportType::MaximumAbsoluteValueStage, GetBufferSizeInBytes(response));
+  }
+
+  /* Record how to convert back to the response */
+  MetaDataDictionary & dictionary = quantized->GetMetaDataDictionary();
+  EncapsulateMetaData< double >(dictionary, GetQuantizationScaleKey(), scale);
+  EncapsulateMetaData< double >(dictionary, GetQuantizationOffsetKey(), offset);
+  return response;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename TOutputImage::Pointer
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ComputeROI(const OutputImageRegionType & region)
+{
+  /* Test all inputs are set */
+  if ( !m_EigenToMeasureImageFilter )
+  {
+    itkExceptionMacro(<< "m_EigenToMeasureImageFilter is not present");
+  }
+
+  const bool useFixedParameters = this->GetUseFixedParameters();
+  if ( m_SigmaArray.GetSize() < 1 )
+  {
+    itkExceptionMacro(<< "SigmaArray must have at least one sigma value. Given array of size " << m_SigmaArray.GetSize());
+  }
+  if ( useFixedParameters && m_FixedParameters.size() != 1 && m_FixedParameters.size() != m_SigmaArray.GetSize() )
+  {
+    itkExceptionMacro(<< "FixedParameters must have one entry or one entry per sigma value. Given "
+                      << m_FixedParameters.size() << " entries for " << m_SigmaArray.GetSize() << " sigma values");
+  }
+
+  InputImagePointer inputPtr = const_cast< TInputImage * >( this->GetInput() );
+  if ( !inputPtr )
+  {
+    itkExceptionMacro(<< "Input image must be set to run this filter.");
+  }
+  inputPtr->UpdateOutputInformation();
+  if ( !useFixedParameters && !this->ScaleParametersAreCurrent() )
+  {
+    itkExceptionMacro(<< "ComputeROI needs the parameters of every sigma value. Update the filter or set FixedParameters first.");
+  }
+
+  OutputImageRegionType roi = region;
+  if ( !roi.Crop(inputPtr->GetLargestPossibleRegion()) )
+  {
+    itkExceptionMacro(<< "Region " << region << " is outside the largest possible region of the input.");
+  }
+
+  /*
+   * The exact Hessian only requests the region padded by its kernel radius from the input, so
+   * nothing outside the halo is read. The incremental scale space would smooth the whole input,
+   * and the sliding slab would fall back to central differences for a region smaller than a plane.
+   * The exact Hessian is used whatever the method of the update. The measure uses the stored
+   * parameters of each scale.
+   */
+  this->ConnectEigenAnalysis();
+  const typename HessianFilterType::HessianMethodType hessianMethod = m_HessianFilter->GetHessianMethod();
+  m_HessianFilter->SetHessianMethod(HessianFilterType::ExactGaussian);
+  m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+
+  typename TOutputImage::Pointer outputImagePointer;
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    m_HessianFilter->SetSigma(m_SigmaArray.GetElement(scaleLevel));
+    m_EigenToMeasureImageFilter->SetParameters(
+      useFixedParameters ? this->GetFixedParametersOfScale(scaleLevel) : m_ScaleParameters[scaleLevel]);
+    m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(roi);
+    m_EigenToMeasureImageFilter->Update();
+    typename TOutputImage::Pointer responseImagePointer = m_EigenToMeasureImageFilter->GetOutput();
+    responseImagePointer->DisconnectPipeline();
+
+    if (!outputImagePointer)
+    {
+      outputImagePointer = responseImagePointer;
+      continue;
+    }
+
+    m_MaximumAbsoluteValueFilter->SetInput1(outputImagePointer);
+    m_MaximumAbsoluteValueFilter->SetInput2(responseImagePointer);
+    m_MaximumAbsoluteValueFilter->GetOutput()->SetRequestedRegion(roi);
+    m_MaximumAbsoluteValueFilter->Update();
+    outputImagePointer = m_MaximumAbsoluteValueFilter->GetOutput();
+    outputImagePointer->DisconnectPipeline();
+  }
+
+  /* Release the references held by the internal filters */
+  m_HessianFilter->SetHessianMethod(hessianMethod);
+  m_EigenToMeasureImageFilter->SetInput(nullptr);
+  m_MaximumAbsoluteValueFilter->SetInput1(nullptr);
+  m_MaximumAbsoluteValueFilter->SetInput2(nullptr);
+  m_HessianFilter->GetOutput()->ReleaseData();
+  m_HessianFilter->ReleaseScaleSpace();
+  m_EigenAnalysisFilter->GetOutput()->ReleaseData();
+  if (m_PreprocessingFilter)
+  {
+    m_PreprocessingFilter->GetOutput()->ReleaseData();
+  }
+
+  /* Setting the parameters modified the measure filter, not the user */
+  if (!useFixedParameters)
+  {
+    m_ScaleParametersTime.Modified();
+  }
+  return outputImagePointer;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+const typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::MeasureParameterArrayType &
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetScaleParameters(SigmaStepsType scaleLevel) const
+{
+  if ( scaleLevel >= m_ScaleParameters.size() )
+  {
+    itkExceptionMacro(<< "No parameters were estimated for scale level " << scaleLevel);
+  }
+  return m_ScaleParameters[scaleLevel];
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+bool
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ScaleParametersAreCurrent() const
+{
+  if ( m_ScaleParameters.size() != m_SigmaArray.GetSize() || m_ScaleParametersSigmaArray != m_SigmaArray )
+  {
+    return false;
+  }
+
+  /* A new input or measure invalidates the parameters, even if the sigma values are unchanged */
+  const ModifiedTimeType parametersTime = m_ScaleParametersTime.GetMTime();
+  const TInputImage * input = this->GetInput();
+  if ( !input || input->GetMTime() > parametersTime || input->GetPipelineMTime() > parametersTime )
+  {
+    return false;
+  }
+  if ( m_EigenToMeasureImageFilter->GetMTime() > parametersTime )
+  {
+    return false;
+  }
+  return !m_PreprocessingFilter || m_PreprocessingFilter->GetMTime() <= parametersTime;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+bool
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::IsEstimatedScale(SigmaStepsType scaleLevel) const
+{
+  if (this->GetUseFixedParameters())
+  {
+    return false;
+  }
+  return m_AnchorScaleLevels.empty()
+    || std::find(m_AnchorScaleLevels.begin(), m_AnchorScaleLevels.end(), scaleLevel) != m_AnchorScaleLevels.end();
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::FlatBlockMapType::ConstPointer
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ComputeFlatBlocksAtScale()
+{
+  typename FlatBlockMapType::Pointer flatBlocks;
+  if (m_FlatBlockRanges)
+  {
+    /*
+     * Blocks are flat over the whole kernel of the Hessian. The normalized Hessian of a range R is
+     * bounded by about R/2 at every sigma, so the threshold does not depend on the sigma.
+     */
+    flatBlocks = m_FlatBlockRanges->ComputeFlatBlocks(m_HessianFilter->GetKernelRadius(), m_FlatBlockThreshold);
+    m_ExecutionReport.SetFlatBlocks(flatBlocks->GetNumberOfBlocks(), flatBlocks->GetNumberOfFlatBlocks(),
+                                    flatBlocks->GetRegion().GetNumberOfPixels(), flatBlocks->GetNumberOfFlatPixels());
+    itkDebugMacro(<< "skipping " << flatBlocks->GetNumberOfFlatBlocks() << " of " << flatBlocks->GetNumberOfBlocks()
+                  << " blocks at sigma " << m_HessianFilter->GetSigma());
+  }
+
+  m_HessianFilter->SetFlatBlocks(flatBlocks);
+  m_EigenAnalysisFilter->SetFlatBlocks(flatBlocks);
+  return flatBlocks.GetPointer();
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ReleaseFlatBlocks()
+{
+  m_HessianFilter->SetFlatBlocks(nullptr);
+  m_EigenAnalysisFilter->SetFlatBlocks(nullptr);
+  if (m_EigenToMeasureImageFilter)
+  {
+    m_EigenToMeasureImageFilter->SetFlatBlocks(nullptr);
+  }
+  m_FlatBlockRanges = nullptr;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::FitNonAnchorScaleParameters()
+{
+  std::vector< SigmaType > anchorSigmas;
+  ScaleParametersType      anchorParameters;
+  for (SigmaStepsType scaleLevel : m_AnchorScaleLevels)
+  {
+    anchorSigmas.push_back(m_SigmaArray.GetElement(scaleLevel));
+    anchorParameters.push_back(m_ScaleParameters[scaleLevel]);
+  }
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    if (!this->IsEstimatedScale(scaleLevel))
+    {
+      m_ScaleParameters[scaleLevel] = FitScaleParameters(anchorSigmas, anchorParameters, m_SigmaArray.GetElement(scaleLevel));
+    }
+  }
+  itkDebugMacro(<< "fitted the parameters of " << m_SigmaArray.GetSize() - m_AnchorScaleLevels.size()
+                << " scales from " << m_AnchorScaleLevels.size() << " anchor scales");
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::MeasureParameterArrayType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::FitScaleParameters(const std::vector< SigmaType > & anchorSigmas, const ScaleParametersType & anchorParameters, SigmaType sigma)
+{
+  if ( anchorSigmas.empty() || anchorSigmas.size() != anchorParameters.size() )
+  {
+    throw ExceptionObject(__FILE__, __LINE__, "Need the parameters of at least one anchor sigma value", ITK_LOCATION);
+  }
+
+  /* Anchors in increasing sigma */
+  std::vector< std::pair< double, const MeasureParameterArrayType * > > anchors;
+  for (unsigned int k = 0; k < anchorSigmas.size(); ++k)
+  {
+    anchors.emplace_back(std::log(static_cast< double >( anchorSigmas[k] )), &anchorParameters[k]);
+  }
+  std::sort(anchors.begin(), anchors.end(),
+    [](const std::pair< double, const MeasureParameterArrayType * > & a, const std::pair< double, const MeasureParameterArrayType * > & b)
+    {
+      return a.first < b.first;
+    });
+
+  const double x = std::log(static_cast< double >( sigma ));
+  const unsigned int numberOfParameters = anchors.front().second->GetSize();
+  MeasureParameterArrayType parameters(numberOfParameters);
+  for (unsigned int j = 0; j < numberOfParameters; ++j)
+  {
+    bool positive = true;
+    for (const auto & anchor : anchors)
+    {
+      positive = positive && ( (*anchor.second)[j] > 0 );
+    }
+
+    double value;
+    if (positive)
+    {
+      /* Least squares line of log(p) against log(sigma), a power law in sigma */
+      double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+      for (const auto & anchor : anchors)
+      {
+        const double y = std::log(static_cast< double >( (*anchor.second)[j] ));
+        sumX += anchor.first;
+        sumY += y;
+        sumXX += anchor.first * anchor.first;
+        sumXY += anchor.first * y;
+      }
+      const double n = static_cast< double >( anchors.size() );
+      const double denominator = n * sumXX - sumX * sumX;
+      const double slope = ( denominator > 0.0 ) ? ( n * sumXY - sumX * sumY ) / denominator : 0.0;
+      value = std::exp(( sumY - slope * sumX ) / n + slope * x);
+    }
+    else
+    {
+      /* Piecewise linear in log(sigma), constant beyond the anchors */
+      value = (*anchors.front().second)[j];
+      for (unsigned int k = 0; k < anchors.size(); ++k)
+      {
+        if (x >= anchors[k].first)
+        {
+          value = (*anchors[k].second)[j];
+        }
+        if (k + 1 < anchors.size() && x > anchors[k].first && x < anchors[k + 1].first)
+        {
+          const double t = ( x - anchors[k].first ) / ( anchors[k + 1].first - anchors[k].first );
+          value = ( 1.0 - t ) * (*anchors[k].second)[j] + t * (*anchors[k + 1].second)[j];
+          break;
+        }
+      }
+    }
+    parameters[j] = static_cast< typename MeasureParameterArrayType::ValueType >( value );
+  }
+  return parameters;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+double
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ComputeParameterFitError(SigmaStepsType scaleLevel)
+{
+  if ( !m_EigenToMeasureParameterEstimationFilter || !m_EigenToMeasureImageFilter )
+  {
+    itkExceptionMacro(<< "The measure and parameter estimation filters must be present");
+  }
+  if ( scaleLevel >= m_SigmaArray.GetSize() || !this->ScaleParametersAreCurrent() )
+  {
+    itkExceptionMacro(<< "No parameters were used for scale level " << scaleLevel << " by the last update");
+  }
+
+  /* Estimate the parameters of the scale without keeping the eigenvalues */
+  using EstimationInputPointer = typename EigenToMeasureParameterEstimationFilterType::InputImageType::ConstPointer;
+  const EstimationInputPointer estimationInput = m_EigenToMeasureParameterEstimationFilter->GetInput();
+  const bool copyInputToOutput = m_EigenToMeasureParameterEstimationFilter->GetCopyInputToOutput();
+  const typename HessianFilterType::RealType sigma = m_HessianFilter->GetSigma();
+  this->ConnectEigenAnalysis();
+  m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+  m_EigenToMeasureParameterEstimationFilter->CopyInputToOutputOff();
+  m_HessianFilter->SetSigma(m_SigmaArray.GetElement(scaleLevel));
+  m_EigenToMeasureParameterEstimationFilter->UpdateLargestPossibleRegion();
+  const MeasureParameterArrayType exact = this->GetEstimatedParameters();
+
+  /* Leave the internal pipeline wired as the last update left it */
+  m_EigenToMeasureParameterEstimationFilter->SetInput(estimationInput);
+  m_EigenToMeasureParameterEstimationFilter->SetCopyInputToOutput(copyInputToOutput);
+  m_HessianFilter->SetSigma(sigma);
+  m_HessianFilter->GetOutput()->ReleaseData();
+  m_HessianFilter->ReleaseScaleSpace();
+  m_EigenAnalysisFilter->GetOutput()->ReleaseData();
+  if (m_PreprocessingFilter)
+  {
+    m_PreprocessingFilter->GetOutput()->ReleaseData();
+  }
+
+  const MeasureParameterArrayType & used = m_ScaleParameters[scaleLevel];
+  double error = 0.0;
+  for (unsigned int j = 0; j < exact.GetSize() && j < used.GetSize(); ++j)
+  {
+    const double difference = std::abs(static_cast< double >( used[j] ) - exact[j]);
+    error = std::max(error, ( exact[j] != 0 ) ? difference / std::abs(static_cast< double >( exact[j] )) : difference);
+  }
+  return error;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::SetFixedParameters(const ScaleParametersType & parameters)
+{
+  m_FixedParameters = parameters;
+  this->Modified();
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::SetFixedParameters(const MeasureParameterArrayType & parameters)
+{
+  this->SetFixedParameters(ScaleParametersType(1, parameters));
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ClearFixedParameters()
+{
+  if (!m_FixedParameters.empty())
+  {
+    m_FixedParameters.clear();
+    this->Modified();
+  }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+const typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::MeasureParameterArrayType &
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetFixedParametersOfScale(SigmaStepsType scaleLevel) const
+{
+  return m_FixedParameters.size() == 1 ? m_FixedParameters.front() : m_FixedParameters[scaleLevel];
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+void
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::ConnectEigenAnalysis()
+{
+  m_HessianFilter->SetNormalizeAcrossScale(true);
+  if (m_SlabThickness > 0)
+  {
+    m_HessianFilter->SetHessianMethod(HessianFilterType::SlidingSlab);
+  }
+  else
+  {
+    m_HessianFilter->SetHessianMethod(m_IncrementalScaleSpace ? HessianFilterType::IncrementalScaleSpace
+                                                              : HessianFilterType::ExactGaussian);
+  }
+  m_EigenAnalysisFilter->SetDimension(ImageDimension);
+  m_EigenAnalysisFilter->OrderEigenValuesBy(this->ConvertType(m_EigenToMeasureImageFilter->GetEigenValueOrder()));
+
+  if (m_PreprocessingFilter)
+  {
+    /* The Hessian pulls the preprocessed pieces it needs */
+    m_PreprocessingFilter->SetInput(this->GetInput());
+    m_HessianFilter->SetInput(m_PreprocessingFilter->GetOutput());
+  }
+  else
+  {
+    m_HessianFilter->SetInput(this->GetInput());
+  }
+  m_EigenAnalysisFilter->SetInput(m_HessianFilter->GetOutput());
+}
+
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::MeasureParameterArrayType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
+::GetEstimatedParameters() const
+{
+  const typename EigenToMeasureParameterEstimationFilterType::ParameterArrayType estimatedParameters =
+    m_EigenToMeasureParameterEstimationFilter->GetParameters();
+  MeasureParameterArrayType parameters(estimatedParameters.GetSize());
+  for (unsigned int i = 0; i < estimatedParameters.GetSize(); ++i)
+  {
+    parameters[i] = static_cast< typename MeasureParameterArrayType::ValueType >( estimatedParameters[i] );
+  }
+  return parameters;
 }
 
-template< typename TInputImage, typename TOutputImage >
-typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >::OutputImageRegionType
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::OutputImageRegionType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::GetOutputRegion()
 {
   /* Create region */
@@ -252,9 +1646,9 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   return region;
 }
 
-template< typename TInputImage, typename TOutputImage >
-typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >::SigmaArrayType
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::SigmaArrayType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::GenerateSigmaArray(SigmaType SigmaMinimum, SigmaType SigmaMaximum, SigmaStepsType NumberOfSigmaSteps, SigmaStepMethodEnum SigmaStepMethod)
 {
   /* Quick check to make sure value is correct */
@@ -310,25 +1704,25 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   return sigmaArray;
 }
 
-template< typename TInputImage, typename TOutputImage >
-typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >::SigmaArrayType
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::SigmaArrayType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::GenerateEquispacedSigmaArray(SigmaType SigmaMinimum, SigmaType SigmaMaximum, SigmaStepsType NumberOfSigmaSteps)
 {
   return GenerateSigmaArray(SigmaMinimum, SigmaMaximum, NumberOfSigmaSteps, Self::EquispacedSigmaSteps);
 }
 
-template< typename TInputImage, typename TOutputImage >
-typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >::SigmaArrayType
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::SigmaArrayType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::GenerateLogarithmicSigmaArray(SigmaType SigmaMinimum, SigmaType SigmaMaximum, SigmaStepsType NumberOfSigmaSteps)
 {
   return GenerateSigmaArray(SigmaMinimum, SigmaMaximum, NumberOfSigmaSteps, Self::LogarithmicSigmaSteps);
 }
 
-template< typename TInputImage, typename TOutputImage >
-typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >::InternalEigenValueOrderType
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
+typename MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >::InternalEigenValueOrderType
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::ConvertType(ExternalEigenValueOrderType order)
 {
   switch(order)
@@ -344,9 +1738,9 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   }
 }
 
-template< typename TInputImage, typename TOutputImage >
+template< typename TInputImage, typename TOutputImage, typename TQuantizedImage >
 void
-MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
+MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage, TQuantizedImage >
 ::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
@@ -355,7 +1749,23 @@ MultiScaleHessianEnhancementImageFilter< TInputImage, TOutputImage >
   os << indent << "MaximumAbsoluteValueFilter: " << m_MaximumAbsoluteValueFilter.GetPointer() << std::endl;
   os << indent << "EigenToMeasureImageFilter: " << m_EigenToMeasureImageFilter.GetPointer() << std::endl;
   os << indent << "EigenToMeasureParameterEstimationFilter: " << m_EigenToMeasureParameterEstimationFilter.GetPointer() << std::endl;
+  os << indent << "PreprocessingFilter: " << m_PreprocessingFilter.GetPointer() << std::endl;
   os << indent << "SigmaArray: " << m_SigmaArray << std::endl;
+  os << indent << "PipelineScales: " << m_PipelineScales << std::endl;
+  os << indent << "LazyEigenImage: " << m_LazyEigenImage << std::endl;
+  os << indent << "IncrementalScaleSpace: " << m_IncrementalScaleSpace << std::endl;
+  os << indent << "SlabThickness: " << m_SlabThickness << std::endl;
+  os << indent << "SkipFlatBlocks: " << m_SkipFlatBlocks << std::endl;
+  os << indent << "FlatBlockThreshold: " << m_FlatBlockThreshold << std::endl;
+  os << indent << "FlatBlockSize: " << m_FlatBlockSize << std::endl;
+  os << indent << "FixedParameters: " << m_FixedParameters.size() << " entries" << std::endl;
+  os << indent << "NumberOfAnchorScales: " << m_NumberOfAnchorScales << std::endl;
+  os << indent << "QuantizeOutput: " << m_QuantizeOutput << std::endl;
+  os << indent << "QuantizationMinimum: " << m_QuantizationMinimum << std::endl;
+  os << indent << "QuantizationMaximum: " << m_QuantizationMaximum << std::endl;
+  os << indent << "UseHugePages: " << m_UseHugePages << std::endl;
+  os << indent << "PrefaultBuffers: " << m_PrefaultBuffers << std::endl;
+  os << indent << "ExecutionReport: " << m_ExecutionReport << std::endl;
 }
 
 } // end namespace itk
@@ -0,0 +1,190 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelFirstTouchAllocator_h
+#define itkParallelFirstTouchAllocator_h
+
+#include "itkProcessObject.h"
+#include "itkMultiThreaderBase.h"
+#include "itkImageRegion.h"
+#include "itkPooledImportImageContainer.h"
+#include "itksys/SystemTools.hxx"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace itk
+{
+/** \class ParallelFirstTouchAllocator
+ * \brief Allocate image buffers so that their pages are first touched by the threads which process them.
+ *
+ * On NUMA systems, the operating system places a page on the memory node of the thread which
+ * first writes it. A buffer which is allocated and initialized by one thread therefore lands on
+ * a single node, and threads on the other nodes read it remotely.
+ *
+ * When enabled, Allocate( ) allocates the buffer without initialization and then zeros it in
+ * parallel using the multi-threader and number of work units of the filter. The region is split
+ * with ImageRegionSplitterSlowDimension, the same splitter the filters use for their own work,
+ * so each slab is touched by a thread of the pool which later processes a slab of the same size.
+ * When disabled, Allocate( ) is equivalent to Image::Allocate( ). FirstTouch( ) can be used on a
+ * buffer which was allocated but not yet written, for instance by a superclass.
+ *
+ * The policy is global and disabled by default. It can be enabled with SetGlobalEnabled( ) or
+ * by setting the environment variable ITK_BONEENHANCEMENT_PARALLEL_FIRST_TOUCH to ON. A change
+ * of the global policy is seen by every filter which allocates afterwards, so it should be set
+ * before filters run. EnableForFilter( ) enables it for one filter without affecting the others.
+ *
+ * Allocate( ) is the single place where the filters of this module allocate their buffers, so it
+ * also takes the buffer from ImageBufferPool when the pool is enabled.
+ *
+ * The pixel type must be a plain floating point or integer type, or a fixed size array of them.
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+class ParallelFirstTouchAllocator
+{
+public:
+  /** Set/Get whether buffers allocated in this module are first touched in parallel. */
+  static void SetGlobalEnabled(bool enabled)
+  {
+    Self::GlobalEnabled() = enabled;
+  }
+  static bool GetGlobalEnabled()
+  {
+    return Self::GlobalEnabled();
+  }
+  static void GlobalEnabledOn() { Self::SetGlobalEnabled(true); }
+  static void GlobalEnabledOff() { Self::SetGlobalEnabled(false); }
+
+  /** Enable the policy for the allocations of one filter. Every call must be matched by a call to DisableForFilter( ). */
+  static void EnableForFilter(const Object * filter)
+  {
+    std::lock_guard< std::mutex > lock(Self::FilterMutex());
+    Self::EnabledFilters().insert(filter);
+  }
+  static void DisableForFilter(const Object * filter)
+  {
+    std::lock_guard< std::mutex > lock(Self::FilterMutex());
+    auto found = Self::EnabledFilters().find(filter);
+    if (found != Self::EnabledFilters().end())
+    {
+      Self::EnabledFilters().erase(found);
+    }
+  }
+
+  /** Whether the buffers of a filter are first touched in parallel, globally or for that filter. */
+  static bool GetEnabled(const Object * filter)
+  {
+    if (Self::GetGlobalEnabled())
+    {
+      return true;
+    }
+    std::lock_guard< std::mutex > lock(Self::FilterMutex());
+    return filter && Self::EnabledFilters().count(filter) > 0;
+  }
+
+  /** Allocate the buffered region of an image for a filter. The buffer is taken from ImageBufferPool when it is enabled. */
+  template< typename TImage >
+  static void Allocate(TImage * image, ProcessObject * filter)
+  {
+    PooledImportImageContainer< SizeValueType, typename TImage::PixelType >::UsePool(image, filter);
+    if (!filter || !Self::GetEnabled(filter))
+    {
+      image->Allocate();
+      return;
+    }
+    image->Allocate(false);
+    Self::FirstTouch(image, filter);
+  }
+
+  /** Zero the buffer of an allocated image in parallel. Pages which were already touched stay where they are. */
+  template< typename TImage >
+  static void FirstTouch(TImage * image, ProcessObject * filter)
+  {
+    constexpr unsigned int ImageDimension = TImage::ImageDimension;
+    using RegionType = ImageRegion< ImageDimension >;
+    using PixelType = typename TImage::PixelType;
+    PixelType * buffer = image->GetBufferPointer();
+
+    MultiThreaderBase * threader = filter->GetMultiThreader();
+    threader->SetNumberOfWorkUnits(filter->GetNumberOfWorkUnits());
+    threader->template ParallelizeImageRegion< ImageDimension >(
+      image->GetBufferedRegion(),
+      [image, buffer](const RegionType & region)
+      {
+        /* Zero the region line by line since it need not be contiguous in the buffer */
+        const SizeValueType lineLength = region.GetSize(0);
+        if (lineLength == 0)
+        {
+          return;
+        }
+        const SizeValueType numberOfLines = region.GetNumberOfPixels() / lineLength;
+        typename RegionType::IndexType index = region.GetIndex();
+        for (SizeValueType line = 0; line < numberOfLines; ++line)
+        {
+          std::memset(static_cast< void * >( buffer + image->ComputeOffset(index) ), 0, lineLength * sizeof(PixelType));
+          for (unsigned int d = 1; d < ImageDimension; ++d)
+          {
+            if (++index[d] < region.GetIndex(d) + static_cast< IndexValueType >( region.GetSize(d) ))
+            {
+              break;
+            }
+            index[d] = region.GetIndex(d);
+          }
+        }
+      },
+      nullptr);
+  }
+
+private:
+  using Self = ParallelFirstTouchAllocator;
+
+  static std::atomic< bool > & GlobalEnabled()
+  {
+    static std::atomic< bool > enabled(Self::GetEnabledFromEnvironment());
+    return enabled;
+  }
+
+  static std::mutex & FilterMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::multiset< const Object * > & EnabledFilters()
+  {
+    static std::multiset< const Object * > filters;
+    return filters;
+  }
+
+  static bool GetEnabledFromEnvironment()
+  {
+    std::string value;
+    if (!itksys::SystemTools::GetEnv("ITK_BONEENHANCEMENT_PARALLEL_FIRST_TOUCH", value))
+    {
+      return false;
+    }
+    value = itksys::SystemTools::UpperCase(value);
+    return value == "ON" || value == "1" || value == "TRUE";
+  }
+};
+} // end namespace itk
+
+#endif // itkParallelFirstTouchAllocator_h
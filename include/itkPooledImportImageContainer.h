@@ -0,0 +1,178 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPooledImportImageContainer_h
+#define itkPooledImportImageContainer_h
+
+#include "itkImportImageContainer.h"
+#include "itkImageBufferPool.h"
+#include <new>
+#include <type_traits>
+
+namespace itk
+{
+/** \class PooledImportImageContainer
+ * \brief Image pixel container which takes large buffers from ImageBufferPool.
+ *
+ * Buffers of at least ImageBufferPool::GetMinimumBlockSize( ) bytes are taken from the pool
+ * while it is enabled for the filter which allocates the image, and returned to it when the
+ * container releases them. Other buffers and
+ * element types which are not trivially destructible use the allocation of ImportImageContainer.
+ *
+ * Images replace their pixel container when they are initialized, for instance at the start of
+ * a pipeline update. UsePool( ) installs a pooled container just before an image is allocated.
+ *
+ * \sa ImageBufferPool
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template< typename TElementIdentifier, typename TElement >
+class ITK_TEMPLATE_EXPORT PooledImportImageContainer
+  : public ImportImageContainer< TElementIdentifier, TElement >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(PooledImportImageContainer);
+
+  /** Standard Self type alias */
+  using Self          = PooledImportImageContainer;
+  using Superclass    = ImportImageContainer< TElementIdentifier, TElement >;
+  using Pointer       = SmartPointer< Self >;
+  using ConstPointer  = SmartPointer< const Self >;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PooledImportImageContainer, ImportImageContainer);
+
+  using ElementIdentifier = TElementIdentifier;
+  using Element           = TElement;
+
+  /**
+   * Install a pooled container in an image which a filter is about to allocate. The pool is used
+   * if it is enabled globally or for that filter. Does nothing if the pool is disabled.
+   */
+  template< typename TImage >
+  static void UsePool(TImage * image, const Object * filter = nullptr)
+  {
+    static_assert(std::is_same< typename TImage::PixelContainer, Superclass >::value,
+                  "The image must store its pixels in an ImportImageContainer of the same element type");
+    const bool enabled = ImageBufferPool::GetEnabled(filter);
+    Self * container = dynamic_cast< Self * >( image->GetPixelContainer() );
+    if (!container)
+    {
+      if (!enabled)
+      {
+        return;
+      }
+      typename Self::Pointer pooled = Self::New();
+      container = pooled.GetPointer();
+      image->SetPixelContainer(container);
+    }
+
+    /* A container installed earlier follows the policy of the current allocation */
+    container->m_PoolEnabled = enabled;
+    container->m_HugePages = ImageBufferPool::GetHugePages(filter);
+  }
+
+protected:
+  PooledImportImageContainer()
+    : m_PoolEnabled(true),
+      m_HugePages(false),
+      m_PooledBlock(nullptr),
+      m_PooledBlockSize(0),
+      m_PendingBlock(nullptr),
+      m_PendingBlockSize(0)
+  {}
+
+  ~PooledImportImageContainer() override
+  {
+    /* The destructor of the superclass would delete[] a pooled buffer */
+    this->ReleasePooledBlock();
+  }
+
+  TElement * AllocateElements(ElementIdentifier size, bool UseValueInitialization = false) const override
+  {
+    const SizeValueType bytes = static_cast< SizeValueType >( size ) * sizeof(TElement);
+    if (!std::is_trivially_destructible< TElement >::value || !m_PoolEnabled || !ImageBufferPool::IsPooledSize(bytes))
+    {
+      return Superclass::AllocateElements(size, UseValueInitialization);
+    }
+
+    /* The new block becomes the import pointer once the superclass has released the old one */
+    SizeValueType blockSize = 0;
+    TElement * data = static_cast< TElement * >( ImageBufferPool::Acquire(bytes, blockSize, m_HugePages) );
+    for (ElementIdentifier i = 0; i < size; ++i)
+    {
+      if (UseValueInitialization)
+      {
+        new ( data + i ) TElement();
+      }
+      else
+      {
+        new ( data + i ) TElement;
+      }
+    }
+    m_PendingBlock = data;
+    m_PendingBlockSize = blockSize;
+    return data;
+  }
+
+  void DeallocateManagedMemory() override
+  {
+    this->ReleasePooledBlock();
+    Superclass::DeallocateManagedMemory();
+
+    /* A block allocated before this call replaces the released one */
+    m_PooledBlock = m_PendingBlock;
+    m_PooledBlockSize = m_PendingBlockSize;
+    m_PendingBlock = nullptr;
+    m_PendingBlockSize = 0;
+  }
+
+private:
+  /* Return the current buffer to the pool if it came from there */
+  void ReleasePooledBlock()
+  {
+    /* A first allocation becomes the import pointer without a deallocation */
+    if (m_PendingBlock && this->GetImportPointer() == m_PendingBlock)
+    {
+      m_PooledBlock = m_PendingBlock;
+      m_PooledBlockSize = m_PendingBlockSize;
+      m_PendingBlock = nullptr;
+      m_PendingBlockSize = 0;
+    }
+    if (m_PooledBlock && this->GetImportPointer() == m_PooledBlock && this->GetContainerManageMemory())
+    {
+      ImageBufferPool::Release(m_PooledBlock, m_PooledBlockSize);
+      this->SetContainerManageMemory(false);
+    }
+    m_PooledBlock = nullptr;
+    m_PooledBlockSize = 0;
+  }
+
+  bool                    m_PoolEnabled;
+  bool                    m_HugePages;
+  TElement *              m_PooledBlock;
+  SizeValueType           m_PooledBlockSize;
+  mutable TElement *      m_PendingBlock;
+  mutable SizeValueType   m_PendingBlockSize;
+};
+} // end namespace itk
+
+#endif // itkPooledImportImageContainer_h
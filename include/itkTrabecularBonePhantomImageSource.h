@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkTrabecularBonePhantomImageSource_h
+#define itkTrabecularBonePhantomImageSource_h
+
+#include "itkGenerateImageSource.h"
+#include "itkNumericTraits.h"
+#include <cstdint>
+#include <vector>
+
+namespace itk {
+/** \class TrabecularBonePhantomImageSource
+ * \brief Procedurally generate a synthetic trabecular bone phantom.
+ *
+ * This source produces an ellipsoidal bone filling the image. The bone is
+ * surrounded by a cortical shell of thickness CorticalThickness. Inside the
+ * shell, a trabecular network is built on a jittered lattice with spacing
+ * TrabecularSpacing. Every lattice node is connected to its three forward
+ * neighbours by either a rod (a cylinder of diameter RodThickness) or a plate
+ * (a disc of thickness PlateThickness containing the edge). The probability of
+ * an element being a plate is given by PlateFraction. Finally, Gaussian noise
+ * with standard deviation NoiseStandardDeviation is added.
+ *
+ * All geometry and noise are derived from a hash of Seed and the lattice or
+ * voxel index. The output is therefore deterministic from the seed and does not
+ * depend on the number of threads or how the output region is split. This makes
+ * the source suitable for benchmarks and regression tests.
+ *
+ * All lengths are given in physical units. The size, spacing, origin and direction
+ * of the output are set with the methods of GenerateImageSource.
+ *
+ * \sa GenerateImageSource
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template< typename TOutputImage >
+class ITK_TEMPLATE_EXPORT TrabecularBonePhantomImageSource
+  : public GenerateImageSource< TOutputImage >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(TrabecularBonePhantomImageSource);
+
+  /** Standard Self type alias */
+  using Self          = TrabecularBonePhantomImageSource;
+  using Superclass    = GenerateImageSource< TOutputImage >;
+  using Pointer       = SmartPointer< Self >;
+  using ConstPointer  = SmartPointer< const Self >;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TrabecularBonePhantomImageSource, GenerateImageSource);
+
+  /** Output image typedefs. */
+  using OutputImageType       = TOutputImage;
+  using OutputImagePointer    = typename OutputImageType::Pointer;
+  using OutputImageRegionType = typename OutputImageType::RegionType;
+  using OutputImagePixelType  = typename OutputImageType::PixelType;
+  using IndexType             = typename OutputImageType::IndexType;
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  /** Parameter typedefs. */
+  using RealType  = double;
+  using SeedType  = SizeValueType;
+
+  /** Set/Get the seed. Identical seeds produce identical images. */
+  itkSetMacro(Seed, SeedType);
+  itkGetConstMacro(Seed, SeedType);
+
+  /** Set/Get the distance between lattice nodes of the trabecular network. */
+  itkSetMacro(TrabecularSpacing, RealType);
+  itkGetConstMacro(TrabecularSpacing, RealType);
+
+  /** Set/Get the thickness of plate-like trabeculae. */
+  itkSetMacro(PlateThickness, RealType);
+  itkGetConstMacro(PlateThickness, RealType);
+
+  /** Set/Get the diameter of rod-like trabeculae. */
+  itkSetMacro(RodThickness, RealType);
+  itkGetConstMacro(RodThickness, RealType);
+
+  /** Set/Get the probability of an element being a plate instead of a rod. */
+  itkSetClampMacro(PlateFraction, RealType, 0.0, 1.0);
+  itkGetConstMacro(PlateFraction, RealType);
+
+  /** Set/Get the thickness of the cortical shell. */
+  itkSetMacro(CorticalThickness, RealType);
+  itkGetConstMacro(CorticalThickness, RealType);
+
+  /** Set/Get the intensity outside the bone. */
+  itkSetMacro(BackgroundIntensity, RealType);
+  itkGetConstMacro(BackgroundIntensity, RealType);
+
+  /** Set/Get the intensity of the marrow between trabeculae. */
+  itkSetMacro(MarrowIntensity, RealType);
+  itkGetConstMacro(MarrowIntensity, RealType);
+
+  /** Set/Get the intensity of trabecular bone. */
+  itkSetMacro(TrabecularIntensity, RealType);
+  itkGetConstMacro(TrabecularIntensity, RealType);
+
+  /** Set/Get the intensity of cortical bone. */
+  itkSetMacro(CorticalIntensity, RealType);
+  itkGetConstMacro(CorticalIntensity, RealType);
+
+  /** Set/Get the standard deviation of the additive Gaussian noise. */
+  itkSetMacro(NoiseStandardDeviation, RealType);
+  itkGetConstMacro(NoiseStandardDeviation, RealType);
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  // Begin concept checking
+  itkConceptMacro( OutputHaveDimension3Check,
+                   ( Concept::SameDimension< TOutputImage::ImageDimension, 3u >) );
+  itkConceptMacro( OutputHasNumericTraitsCheck,
+                   ( Concept::HasNumericTraits< OutputImagePixelType >) );
+  // End concept checking
+#endif
+protected:
+  TrabecularBonePhantomImageSource();
+  virtual ~TrabecularBonePhantomImageSource() {}
+
+  /** Build the lattice of trabecular elements. */
+  void BeforeThreadedGenerateData() override;
+
+  /** Multi-thread version GenerateData. */
+  void DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** A trabecular element connects a lattice node to its neighbour along one axis. */
+  struct TrabecularElement
+  {
+    RealType  m_Start[3];
+    RealType  m_End[3];
+    RealType  m_Normal[3];
+    bool      m_IsPlate;
+  };
+
+  /** Hash functions used to make the phantom deterministic */
+  static uint64_t Hash(uint64_t value);
+  static RealType HashToUniform(uint64_t value);
+
+  /** Distance between a point and a trabecular element surface. Negative inside the element. */
+  RealType SignedDistanceToElement(const RealType point[3], const TrabecularElement & element) const;
+
+private:
+  /* Parameters */
+  SeedType  m_Seed;
+  RealType  m_TrabecularSpacing;
+  RealType  m_PlateThickness;
+  RealType  m_RodThickness;
+  RealType  m_PlateFraction;
+  RealType  m_CorticalThickness;
+  RealType  m_BackgroundIntensity;
+  RealType  m_MarrowIntensity;
+  RealType  m_TrabecularIntensity;
+  RealType  m_CorticalIntensity;
+  RealType  m_NoiseStandardDeviation;
+
+  /* Lattice of elements. Three elements are stored per node. */
+  std::vector< TrabecularElement >  m_Elements;
+  OffsetValueType                   m_NumberOfNodes[3];
+}; // end class
+} // end namespace
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTrabecularBonePhantomImageSource.hxx"
+#endif
+
+#endif // itkTrabecularBonePhantomImageSource_h
@@ -0,0 +1,362 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkTrabecularBonePhantomImageSource_hxx
+#define itkTrabecularBonePhantomImageSource_hxx
+
+#include "itkTrabecularBonePhantomImageSource.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMath.h"
+
+namespace itk
+{
+template< typename TOutputImage >
+TrabecularBonePhantomImageSource< TOutputImage >
+::TrabecularBonePhantomImageSource() :
+  m_Seed(0),
+  m_TrabecularSpacing(8.0),
+  m_PlateThickness(1.5),
+  m_RodThickness(2.0),
+  m_PlateFraction(0.5),
+  m_CorticalThickness(4.0),
+  m_BackgroundIntensity(0.0),
+  m_MarrowIntensity(50.0),
+  m_TrabecularIntensity(800.0),
+  m_CorticalIntensity(1500.0),
+  m_NoiseStandardDeviation(50.0)
+{
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    m_NumberOfNodes[i] = 0;
+  }
+}
+
+template< typename TOutputImage >
+uint64_t
+TrabecularBonePhantomImageSource< TOutputImage >
+::Hash(uint64_t value)
+{
+  /* splitmix64 finalizer */
+  value += 0x9E3779B97F4A7C15ULL;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+template< typename TOutputImage >
+typename TrabecularBonePhantomImageSource< TOutputImage >::RealType
+TrabecularBonePhantomImageSource< TOutputImage >
+::HashToUniform(uint64_t value)
+{
+  /* Use the upper 53 bits to get a uniform value in (0, 1] */
+  return (static_cast< RealType >(value >> 11) + 1.0) / 9007199254740992.0;
+}
+
+template< typename TOutputImage >
+void
+TrabecularBonePhantomImageSource< TOutputImage >
+::BeforeThreadedGenerateData()
+{
+  if (m_TrabecularSpacing <= 0.0)
+  {
+    itkExceptionMacro(<< "TrabecularSpacing must be positive. Given " << m_TrabecularSpacing);
+  }
+
+  const typename OutputImageType::SizeType    size = this->GetSize();
+  const typename OutputImageType::SpacingType spacing = this->GetSpacing();
+
+  /* The lattice is padded by one node on either side so elements reach the image boundary */
+  SizeValueType numberOfElements = 3;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    const RealType extent = size[i] * spacing[i];
+    m_NumberOfNodes[i] = static_cast< OffsetValueType >( std::ceil(extent / m_TrabecularSpacing) ) + 3;
+    numberOfElements *= m_NumberOfNodes[i];
+  }
+  m_Elements.resize(numberOfElements);
+
+  const uint64_t seed = Hash(static_cast< uint64_t >(m_Seed));
+  auto nodePosition = [&](OffsetValueType k0, OffsetValueType k1, OffsetValueType k2, RealType position[3])
+  {
+    const OffsetValueType k[3] = {k0, k1, k2};
+    const uint64_t nodeId = static_cast< uint64_t >( (k2 * m_NumberOfNodes[1] + k1) * m_NumberOfNodes[0] + k0 );
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      const RealType jitter = 0.4 * (HashToUniform(Hash(seed ^ Hash(16 * nodeId + d))) - 0.5);
+      position[d] = (k[d] - 1 + 0.5 + jitter) * m_TrabecularSpacing;
+    }
+  };
+
+  /* Build every element in parallel. The result does not depend on the split. */
+  const OffsetValueType nodesPerSlice = m_NumberOfNodes[0] * m_NumberOfNodes[1];
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    m_NumberOfNodes[2],
+    [&](SizeValueType k2)
+    {
+      for (OffsetValueType k1 = 0; k1 < m_NumberOfNodes[1]; ++k1)
+      {
+        for (OffsetValueType k0 = 0; k0 < m_NumberOfNodes[0]; ++k0)
+        {
+          const OffsetValueType k[3] = {k0, k1, static_cast< OffsetValueType >(k2)};
+          const uint64_t nodeId = static_cast< uint64_t >( k2 * nodesPerSlice + k1 * m_NumberOfNodes[0] + k0 );
+
+          RealType start[3];
+          nodePosition(k0, k1, k[2], start);
+
+          for (unsigned int axis = 0; axis < 3; ++axis)
+          {
+            TrabecularElement & element = m_Elements[3 * nodeId + axis];
+
+            OffsetValueType n[3] = {k0, k1, k[2]};
+            n[axis] = std::min(n[axis] + 1, m_NumberOfNodes[axis] - 1);
+            RealType end[3];
+            nodePosition(n[0], n[1], n[2], end);
+
+            /* Random normal perpendicular to the edge */
+            RealType edge[3], length = 0.0;
+            for (unsigned int d = 0; d < 3; ++d)
+            {
+              edge[d] = end[d] - start[d];
+              length += edge[d] * edge[d];
+            }
+            length = std::sqrt(length);
+            for (unsigned int d = 0; d < 3; ++d)
+            {
+              /* The last node along an axis has no neighbour */
+              edge[d] = (length > 0.0) ? edge[d] / length : (d == axis ? 1.0 : 0.0);
+            }
+            RealType helper[3] = {0.0, 0.0, 0.0};
+            helper[(axis + 1) % 3] = 1.0;
+            RealType u[3] = {edge[1]*helper[2] - edge[2]*helper[1],
+                             edge[2]*helper[0] - edge[0]*helper[2],
+                             edge[0]*helper[1] - edge[1]*helper[0]};
+            RealType uLength = std::sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
+            for (unsigned int d = 0; d < 3; ++d)
+            {
+              u[d] /= uLength;
+            }
+            const RealType v[3] = {edge[1]*u[2] - edge[2]*u[1],
+                                   edge[2]*u[0] - edge[0]*u[2],
+                                   edge[0]*u[1] - edge[1]*u[0]};
+            const RealType theta = 2.0 * Math::pi * HashToUniform(Hash(seed ^ Hash(16 * nodeId + 3 + axis)));
+
+            for (unsigned int d = 0; d < 3; ++d)
+            {
+              element.m_Start[d] = start[d];
+              element.m_End[d] = end[d];
+              element.m_Normal[d] = std::cos(theta) * u[d] + std::sin(theta) * v[d];
+            }
+            element.m_IsPlate = HashToUniform(Hash(seed ^ Hash(16 * nodeId + 6 + axis))) <= m_PlateFraction;
+          }
+        }
+      }
+    },
+    nullptr);
+}
+
+template< typename TOutputImage >
+typename TrabecularBonePhantomImageSource< TOutputImage >::RealType
+TrabecularBonePhantomImageSource< TOutputImage >
+::SignedDistanceToElement(const RealType point[3], const TrabecularElement & element) const
+{
+  if (element.m_IsPlate)
+  {
+    /* Disc of radius half the lattice spacing centered on the edge */
+    const RealType radius = 0.5 * m_TrabecularSpacing;
+    RealType d[3], h = 0.0;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      d[i] = point[i] - 0.5 * (element.m_Start[i] + element.m_End[i]);
+      h += d[i] * element.m_Normal[i];
+    }
+    RealType radial = 0.0;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      const RealType q = d[i] - h * element.m_Normal[i];
+      radial += q * q;
+    }
+    radial = std::sqrt(radial);
+    if (radial <= radius)
+    {
+      return Math::abs(h) - 0.5 * m_PlateThickness;
+    }
+    return std::sqrt((radial - radius) * (radial - radius) + h * h) - 0.5 * m_PlateThickness;
+  }
+
+  /* Rod is a cylinder around the edge */
+  RealType ab[3], ap[3], abab = 0.0, apab = 0.0;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    ab[i] = element.m_End[i] - element.m_Start[i];
+    ap[i] = point[i] - element.m_Start[i];
+    abab += ab[i] * ab[i];
+    apab += ap[i] * ab[i];
+  }
+  const RealType t = (abab > 0.0) ? std::min(std::max(apab / abab, 0.0), 1.0) : 0.0;
+  RealType distance = 0.0;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    const RealType e = ap[i] - t * ab[i];
+    distance += e * e;
+  }
+  return std::sqrt(distance) - 0.5 * m_RodThickness;
+}
+
+template< typename TOutputImage >
+void
+TrabecularBonePhantomImageSource< TOutputImage >
+::DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread)
+{
+  const SizeValueType size0 = outputRegionForThread.GetSize(0);
+  if (size0 == 0)
+  {
+    return;
+  }
+
+  OutputImageType * outputPtr = this->GetOutput();
+  const OutputImageRegionType largestRegion = outputPtr->GetLargestPossibleRegion();
+  const IndexType start = largestRegion.GetIndex();
+  const typename OutputImageType::SizeType    size = largestRegion.GetSize();
+  const typename OutputImageType::SpacingType spacing = this->GetSpacing();
+
+  /* Ellipsoid filling 90% of the field of view */
+  RealType center[3], semiAxis[3];
+  RealType minimumSemiAxis = NumericTraits< RealType >::max();
+  RealType voxelSize = NumericTraits< RealType >::max();
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    center[i] = 0.5 * (size[i] - 1) * spacing[i];
+    semiAxis[i] = 0.45 * size[i] * spacing[i];
+    minimumSemiAxis = std::min(minimumSemiAxis, semiAxis[i]);
+    voxelSize = std::min(voxelSize, static_cast< RealType >(spacing[i]));
+  }
+
+  /* Range of lattice nodes which can reach a point, in units of the lattice spacing */
+  const RealType margin = (0.5 * std::max(m_PlateThickness, m_RodThickness) + voxelSize) / m_TrabecularSpacing;
+  const uint64_t seed = Hash(static_cast< uint64_t >(m_Seed) + 0x5851F42D4C957F2DULL);
+  const RealType minimumValue = static_cast< RealType >( NumericTraits< OutputImagePixelType >::NonpositiveMin() );
+  const RealType maximumValue = static_cast< RealType >( NumericTraits< OutputImagePixelType >::max() );
+
+  ImageScanlineIterator< OutputImageType > outputIt(outputPtr, outputRegionForThread);
+  while ( !outputIt.IsAtEnd() )
+  {
+    /* Check for an abort request once per line */
+    if ( this->GetAbortGenerateData() )
+    {
+      throw ProcessAborted(__FILE__, __LINE__);
+    }
+
+    IndexType index = outputIt.GetIndex();
+    while ( !outputIt.IsAtEndOfLine() )
+    {
+      /* Physical position relative to the first voxel */
+      RealType point[3], radius = 0.0;
+      for (unsigned int i = 0; i < 3; ++i)
+      {
+        point[i] = (index[i] - start[i]) * spacing[i];
+        const RealType r = (point[i] - center[i]) / semiAxis[i];
+        radius += r * r;
+      }
+      radius = std::sqrt(radius);
+
+      RealType value;
+      if (radius > 1.0)
+      {
+        value = m_BackgroundIntensity;
+      }
+      else if ((1.0 - radius) * minimumSemiAxis < m_CorticalThickness)
+      {
+        value = m_CorticalIntensity;
+      }
+      else
+      {
+        /* Find the closest trabecular element */
+        RealType distance = NumericTraits< RealType >::max();
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+          OffsetValueType lower[3], upper[3];
+          for (unsigned int i = 0; i < 3; ++i)
+          {
+            /* Lattice node k sits at (k - 0.5 + jitter) in units of the lattice spacing */
+            const RealType u = point[i] / m_TrabecularSpacing + 1.0;
+            const RealType low = (i == axis) ? u - 1.7 - margin : u - 1.2 - margin;
+            const RealType high = (i == axis) ? u - 0.3 + margin : u + 0.2 + margin;
+            lower[i] = std::max(static_cast< OffsetValueType >( std::ceil(low) ), OffsetValueType(0));
+            upper[i] = std::min(static_cast< OffsetValueType >( std::floor(high) ), m_NumberOfNodes[i] - 1);
+          }
+          for (OffsetValueType k2 = lower[2]; k2 <= upper[2]; ++k2)
+          {
+            for (OffsetValueType k1 = lower[1]; k1 <= upper[1]; ++k1)
+            {
+              for (OffsetValueType k0 = lower[0]; k0 <= upper[0]; ++k0)
+              {
+                const SizeValueType nodeId = (k2 * m_NumberOfNodes[1] + k1) * m_NumberOfNodes[0] + k0;
+                distance = std::min(distance, this->SignedDistanceToElement(point, m_Elements[3 * nodeId + axis]));
+              }
+            }
+          }
+        }
+
+        /* Linear partial volume over one voxel */
+        const RealType fraction = std::min(std::max(0.5 - distance / voxelSize, 0.0), 1.0);
+        value = m_MarrowIntensity + fraction * (m_TrabecularIntensity - m_MarrowIntensity);
+      }
+
+      /* Noise depends only on the seed and voxel location */
+      if (m_NoiseStandardDeviation > 0.0)
+      {
+        const uint64_t voxelId = static_cast< uint64_t >(
+          ((index[2] - start[2]) * size[1] + (index[1] - start[1])) * size[0] + (index[0] - start[0]) );
+        const uint64_t hash = Hash(seed ^ Hash(voxelId));
+        const RealType u1 = HashToUniform(hash);
+        const RealType u2 = HashToUniform(Hash(hash));
+        value += m_NoiseStandardDeviation * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * Math::pi * u2);
+      }
+
+      value = std::min(std::max(value, minimumValue), maximumValue);
+      outputIt.Set( static_cast< OutputImagePixelType >(value) );
+      ++outputIt;
+      ++index[0];
+    }
+    outputIt.NextLine();
+  }
+}
+
+template< typename TOutputImage >
+void
+TrabecularBonePhantomImageSource< TOutputImage >
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Seed: " << m_Seed << std::endl;
+  os << indent << "TrabecularSpacing: " << m_TrabecularSpacing << std::endl;
+  os << indent << "PlateThickness: " << m_PlateThickness << std::endl;
+  os << indent << "RodThickness: " << m_RodThickness << std::endl;
+  os << indent << "PlateFraction: " << m_PlateFraction << std::endl;
+  os << indent << "CorticalThickness: " << m_CorticalThickness << std::endl;
+  os << indent << "BackgroundIntensity: " << m_BackgroundIntensity << std::endl;
+  os << indent << "MarrowIntensity: " << m_MarrowIntensity << std::endl;
+  os << indent << "TrabecularIntensity: " << m_TrabecularIntensity << std::endl;
+  os << indent << "CorticalIntensity: " << m_CorticalIntensity << std::endl;
+  os << indent << "NoiseStandardDeviation: " << m_NoiseStandardDeviation << std::endl;
+}
+
+} // end namespace itk
+
+#endif // itkTrabecularBonePhantomImageSource_hxx
@@ -18,6 +18,7 @@ itk_module(BoneEnhancement
     ITKImageFilterBase
     ITKImageFeature
     ITKSpatialObjects
+    ITKZLIB
   COMPILE_DEPENDS
     ITKImageSources
   TEST_DEPENDS
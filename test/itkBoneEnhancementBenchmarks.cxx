@@ -0,0 +1,521 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "benchmark/benchmark.h"
+#include "itkMultiScaleHessianEnhancementImageFilter.h"
+#include "itkHessianGaussianImageFilter.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
+#include "itkDescoteauxEigenToMeasureImageFilter.h"
+#include "itkDescoteauxEigenToMeasureParameterEstimationFilter.h"
+#include "itkMaximumAbsoluteValueImageFilter.h"
+#include "itkKrcahPreprocessingImageToImageFilter.h"
+#include "itkTrabecularBonePhantomImageSource.h"
+#include "itkParallelFirstTouchAllocator.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkMath.h"
+
+#include <map>
+#include <random>
+
+/*
+ * Performance harness for the filters in this module. Every benchmark is
+ * parameterized over a subset of
+ *    size     - edge length of a cubic volume in voxels
+ *    sigma    - Hessian scale in tenths of a millimeter
+ *    threads  - number of work units given to the filter
+ *    density  - percentage of the volume inside the mask (0 for no mask)
+ * and reports the throughput as voxels/s. All inputs are synthetic so the
+ * benchmarks can run without downloading data.
+ */
+namespace
+{
+constexpr unsigned int Dimension = 3;
+using InputPixelType          = short;
+using InputImageType          = itk::Image< InputPixelType, Dimension >;
+using OutputPixelType         = float;
+using OutputImageType         = itk::Image< OutputPixelType, Dimension >;
+using MaskImageType           = itk::Image< unsigned char, Dimension >;
+using MaskSpatialObjectType   = itk::ImageMaskSpatialObject< Dimension >;
+
+using MultiScaleFilterType    = itk::MultiScaleHessianEnhancementImageFilter< InputImageType, OutputImageType >;
+using HessianFilterType       = MultiScaleFilterType::HessianFilterType;
+using HessianImageType        = MultiScaleFilterType::HessianImageType;
+using EigenValueImageType     = MultiScaleFilterType::EigenValueImageType;
+using EigenAnalysisFilterType = MultiScaleFilterType::EigenAnalysisFilterType;
+using MaximumAbsoluteValueFilterType  = itk::MaximumAbsoluteValueImageFilter< OutputImageType >;
+using PreprocessingFilterType         = itk::KrcahPreprocessingImageToImageFilter< InputImageType >;
+using PhantomSourceType               = itk::TrabecularBonePhantomImageSource< InputImageType >;
+
+using KrcahMeasureFilterType          = itk::KrcahEigenToMeasureImageFilter< EigenValueImageType, OutputImageType >;
+using KrcahEstimationFilterType       = itk::KrcahEigenToMeasureParameterEstimationFilter< EigenValueImageType >;
+using DescoteauxMeasureFilterType     = itk::DescoteauxEigenToMeasureImageFilter< EigenValueImageType, OutputImageType >;
+using DescoteauxEstimationFilterType  = itk::DescoteauxEigenToMeasureParameterEstimationFilter< EigenValueImageType >;
+
+/* Parameter grids */
+const std::vector< int64_t > Sizes{32, 64, 128};
+const std::vector< int64_t > Sigmas{10, 20, 40};
+const std::vector< int64_t > Densities{0, 25, 100};
+
+std::vector< int64_t >
+ThreadCounts()
+{
+  std::vector< int64_t > threads{1};
+  const int64_t maximum = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  for (int64_t n = 2; n < maximum; n *= 2)
+  {
+    threads.push_back(n);
+  }
+  if (maximum > 1)
+  {
+    threads.push_back(maximum);
+  }
+  return threads;
+}
+
+void
+SizeSigmaThreadsArguments(benchmark::internal::Benchmark * b)
+{
+  b->ArgNames({"size", "sigma", "threads"});
+  for (auto size : Sizes)
+    for (auto sigma : Sigmas)
+      for (auto threads : ThreadCounts())
+        b->Args({size, sigma, threads});
+}
+
+void
+SizeSigmaThreadsDensityArguments(benchmark::internal::Benchmark * b)
+{
+  b->ArgNames({"size", "sigma", "threads", "density"});
+  for (auto size : Sizes)
+    for (auto sigma : Sigmas)
+      for (auto threads : ThreadCounts())
+        for (auto density : Densities)
+          b->Args({size, sigma, threads, density});
+}
+
+void
+SizeThreadsArguments(benchmark::internal::Benchmark * b)
+{
+  b->ArgNames({"size", "threads"});
+  for (auto size : Sizes)
+    for (auto threads : ThreadCounts())
+      b->Args({size, threads});
+}
+
+/* Helper functions for decoding the parameter grid */
+unsigned int GetSize(const benchmark::State & state) { return static_cast< unsigned int >(state.range(0)); }
+double GetSigma(const benchmark::State & state) { return static_cast< double >(state.range(1)) / 10.0; }
+
+void
+SetVoxelsPerSecond(benchmark::State & state, itk::SizeValueType numberOfVoxels)
+{
+  state.counters["voxels/s"] = benchmark::Counter(static_cast< double >(numberOfVoxels),
+                                                  benchmark::Counter::kIsIterationInvariantRate);
+}
+
+/*
+ * Sets the global default number of threads for the duration of one benchmark, so the
+ * internal filters of a mini-pipeline see the same count as the benchmarked filter,
+ * and restores the previous default when the benchmark returns.
+ */
+class ScopedGlobalNumberOfThreads
+{
+public:
+  explicit ScopedGlobalNumberOfThreads(int64_t threads)
+    : m_PreviousNumberOfThreads(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads())
+  {
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(static_cast< itk::ThreadIdType >(threads));
+  }
+  ~ScopedGlobalNumberOfThreads()
+  {
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(m_PreviousNumberOfThreads);
+  }
+  ScopedGlobalNumberOfThreads(const ScopedGlobalNumberOfThreads &) = delete;
+  ScopedGlobalNumberOfThreads & operator=(const ScopedGlobalNumberOfThreads &) = delete;
+
+private:
+  const itk::ThreadIdType m_PreviousNumberOfThreads;
+};
+
+void
+SetNumberOfThreads(itk::ProcessObject * filter, int64_t threads)
+{
+  filter->SetNumberOfWorkUnits(static_cast< itk::ThreadIdType >(threads));
+}
+
+/*
+ * Synthetic trabecular bone with a fixed seed so every run sees exactly the same input.
+ */
+InputImageType::Pointer
+GetPhantom(unsigned int size)
+{
+  static std::map< unsigned int, InputImageType::Pointer > cache;
+  auto found = cache.find(size);
+  if (found != cache.end())
+  {
+    return found->second;
+  }
+
+  PhantomSourceType::Pointer phantom = PhantomSourceType::New();
+  phantom->SetSize(InputImageType::SizeType{{size, size, size}});
+  phantom->SetSeed(42);
+  phantom->Update();
+
+  InputImageType::Pointer image = phantom->GetOutput();
+  image->DisconnectPipeline();
+  cache[size] = image;
+  return image;
+}
+
+/* Random mask with the requested percentage of voxels in the foreground. */
+MaskSpatialObjectType::Pointer
+GetMask(unsigned int size, int64_t density)
+{
+  static std::map< std::pair< unsigned int, int64_t >, MaskSpatialObjectType::Pointer > cache;
+  const auto key = std::make_pair(size, density);
+  auto found = cache.find(key);
+  if (found != cache.end())
+  {
+    return found->second;
+  }
+
+  MaskSpatialObjectType::Pointer spatialObject;
+  if (density > 0)
+  {
+    MaskImageType::RegionType region;
+    region.SetSize(MaskImageType::SizeType{{size, size, size}});
+
+    MaskImageType::Pointer mask = MaskImageType::New();
+    mask->SetRegions(region);
+    mask->Allocate();
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution< int64_t > uniform(0, 99);
+    itk::ImageRegionIterator< MaskImageType > it(mask, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      it.Set(uniform(generator) < density ? 1 : 0);
+    }
+
+    spatialObject = MaskSpatialObjectType::New();
+    spatialObject->SetImage(mask);
+    spatialObject->Update();
+  }
+
+  cache[key] = spatialObject;
+  return spatialObject;
+}
+
+HessianImageType::Pointer
+GetHessianImage(unsigned int size, double sigma)
+{
+  static std::map< std::pair< unsigned int, double >, HessianImageType::Pointer > cache;
+  const auto key = std::make_pair(size, sigma);
+  auto found = cache.find(key);
+  if (found != cache.end())
+  {
+    return found->second;
+  }
+
+  HessianFilterType::Pointer hessian = HessianFilterType::New();
+  hessian->SetInput(GetPhantom(size));
+  hessian->SetSigma(sigma);
+  hessian->SetNormalizeAcrossScale(true);
+  hessian->Update();
+
+  HessianImageType::Pointer image = hessian->GetOutput();
+  image->DisconnectPipeline();
+  cache[key] = image;
+  return image;
+}
+
+EigenValueImageType::Pointer
+GetEigenImage(unsigned int size, double sigma)
+{
+  static std::map< std::pair< unsigned int, double >, EigenValueImageType::Pointer > cache;
+  const auto key = std::make_pair(size, sigma);
+  auto found = cache.find(key);
+  if (found != cache.end())
+  {
+    return found->second;
+  }
+
+  EigenAnalysisFilterType::Pointer eigen = EigenAnalysisFilterType::New();
+  eigen->SetInput(GetHessianImage(size, sigma));
+  eigen->SetDimension(Dimension);
+  eigen->OrderEigenValuesBy(EigenAnalysisFilterType::FunctorType::EigenValueOrderType::OrderByMagnitude);
+  eigen->Update();
+
+  EigenValueImageType::Pointer image = eigen->GetOutput();
+  image->DisconnectPipeline();
+  cache[key] = image;
+  return image;
+}
+
+OutputImageType::Pointer
+GetMeasureImage(unsigned int size, double sigma)
+{
+  static std::map< std::pair< unsigned int, double >, OutputImageType::Pointer > cache;
+  const auto key = std::make_pair(size, sigma);
+  auto found = cache.find(key);
+  if (found != cache.end())
+  {
+    return found->second;
+  }
+
+  KrcahEstimationFilterType::Pointer estimation = KrcahEstimationFilterType::New();
+  estimation->SetInput(GetEigenImage(size, sigma));
+  KrcahMeasureFilterType::Pointer measure = KrcahMeasureFilterType::New();
+  measure->SetInput(estimation->GetOutput());
+  measure->SetParametersInput(estimation->GetParametersOutput());
+  measure->Update();
+
+  OutputImageType::Pointer image = measure->GetOutput();
+  image->DisconnectPipeline();
+  cache[key] = image;
+  return image;
+}
+} // end namespace
+
+/*
+ * With parallel first touch on, the Hessian output is spread over the NUMA nodes. Compare
+ * the two variants on a multi-socket machine to see the cross-socket bandwidth gain. The box
+ * approximation costs the same at every sigma, compare it across the sigma arguments. Smoothing
+ * then taking finite differences runs D Gaussian passes instead of D(D+1)/2 times D.
+ */
+template< bool VParallelFirstTouch, HessianFilterType::HessianMethodType VHessianMethod >
+static void
+BM_HessianGaussianImageFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  InputImageType::Pointer input = GetPhantom(size);
+  const bool wasEnabled = itk::ParallelFirstTouchAllocator::GetGlobalEnabled();
+  itk::ParallelFirstTouchAllocator::SetGlobalEnabled(VParallelFirstTouch);
+
+  HessianFilterType::Pointer filter = HessianFilterType::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(2));
+  SetNumberOfThreads(filter, state.range(2));
+  filter->SetInput(input);
+  filter->SetSigma(GetSigma(state));
+  filter->SetNormalizeAcrossScale(true);
+  filter->SetHessianMethod(VHessianMethod);
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input->GetLargestPossibleRegion().GetNumberOfPixels());
+  itk::ParallelFirstTouchAllocator::SetGlobalEnabled(wasEnabled);
+}
+BENCHMARK_TEMPLATE(BM_HessianGaussianImageFilter, false, HessianFilterType::ExactGaussian)->Apply(SizeSigmaThreadsArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_HessianGaussianImageFilter, true, HessianFilterType::ExactGaussian)->Apply(SizeSigmaThreadsArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_HessianGaussianImageFilter, true, HessianFilterType::BoxApproximation)->Apply(SizeSigmaThreadsArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_HessianGaussianImageFilter, true, HessianFilterType::SmoothThenFiniteDifference)->Apply(SizeSigmaThreadsArguments)->Unit(benchmark::kMillisecond);
+
+static void
+BM_SymmetricEigenAnalysisImageFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  HessianImageType::Pointer input = GetHessianImage(size, GetSigma(state));
+
+  EigenAnalysisFilterType::Pointer filter = EigenAnalysisFilterType::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(2));
+  SetNumberOfThreads(filter, state.range(2));
+  filter->SetInput(input);
+  filter->SetDimension(Dimension);
+  filter->OrderEigenValuesBy(EigenAnalysisFilterType::FunctorType::EigenValueOrderType::OrderByMagnitude);
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK(BM_SymmetricEigenAnalysisImageFilter)->Apply(SizeSigmaThreadsArguments)->Unit(benchmark::kMillisecond);
+
+template< typename TEstimationFilter >
+static void
+BM_ParameterEstimationFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  EigenValueImageType::Pointer input = GetEigenImage(size, GetSigma(state));
+
+  typename TEstimationFilter::Pointer filter = TEstimationFilter::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(2));
+  SetNumberOfThreads(filter, state.range(2));
+  filter->SetInput(input);
+  filter->SetMask(GetMask(size, state.range(3)));
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK_TEMPLATE(BM_ParameterEstimationFilter, KrcahEstimationFilterType)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ParameterEstimationFilter, DescoteauxEstimationFilterType)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+
+template< typename TMeasureFilter, typename TEstimationFilter, bool VLookupTable = false >
+static void
+BM_MeasureFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  EigenValueImageType::Pointer input = GetEigenImage(size, GetSigma(state));
+  MaskSpatialObjectType::Pointer mask = GetMask(size, state.range(3));
+
+  /* Estimate the parameters once, outside the timed loop */
+  typename TEstimationFilter::Pointer estimation = TEstimationFilter::New();
+  estimation->SetInput(input);
+  estimation->SetMask(mask);
+  estimation->Update();
+
+  typename TMeasureFilter::Pointer filter = TMeasureFilter::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(2));
+  SetNumberOfThreads(filter, state.range(2));
+  filter->SetInput(input);
+  filter->SetParameters(estimation->GetParameters());
+  filter->SetMask(mask);
+  filter->SetUseLookupTable(VLookupTable);
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK_TEMPLATE(BM_MeasureFilter, KrcahMeasureFilterType, KrcahEstimationFilterType)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MeasureFilter, DescoteauxMeasureFilterType, DescoteauxEstimationFilterType)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MeasureFilter, KrcahMeasureFilterType, KrcahEstimationFilterType, true)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MeasureFilter, DescoteauxMeasureFilterType, DescoteauxEstimationFilterType, true)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+
+static void
+BM_MaximumAbsoluteValueImageFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  OutputImageType::Pointer input1 = GetMeasureImage(size, 1.0);
+  OutputImageType::Pointer input2 = GetMeasureImage(size, 2.0);
+
+  MaximumAbsoluteValueFilterType::Pointer filter = MaximumAbsoluteValueFilterType::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(1));
+  SetNumberOfThreads(filter, state.range(1));
+  filter->SetInput1(input1);
+  filter->SetInput2(input2);
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input1->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK(BM_MaximumAbsoluteValueImageFilter)->Apply(SizeThreadsArguments)->Unit(benchmark::kMillisecond);
+
+static void
+BM_TrabecularBonePhantomImageSource(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+
+  PhantomSourceType::Pointer source = PhantomSourceType::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(1));
+  SetNumberOfThreads(source, state.range(1));
+  source->SetSize(InputImageType::SizeType{{size, size, size}});
+  source->SetSeed(42);
+
+  for (auto _ : state)
+  {
+    source->Modified();
+    source->Update();
+  }
+  SetVoxelsPerSecond(state, source->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK(BM_TrabecularBonePhantomImageSource)->Apply(SizeThreadsArguments)->Unit(benchmark::kMillisecond);
+
+static void
+BM_KrcahPreprocessingImageToImageFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  InputImageType::Pointer input = GetPhantom(size);
+
+  PreprocessingFilterType::Pointer filter = PreprocessingFilterType::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(1));
+  SetNumberOfThreads(filter, state.range(1));
+  filter->SetInput(input);
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK(BM_KrcahPreprocessingImageToImageFilter)->Apply(SizeThreadsArguments)->Unit(benchmark::kMillisecond);
+
+/* The full pipeline uses three sigma values starting at the requested sigma */
+template< typename TMeasureFilter, typename TEstimationFilter, bool VPipelineScales = false, bool VHugePagesAndPrefault = false >
+static void
+BM_MultiScaleHessianEnhancementImageFilter(benchmark::State & state)
+{
+  const unsigned int size = GetSize(state);
+  const double sigma = GetSigma(state);
+  InputImageType::Pointer input = GetPhantom(size);
+
+  typename TMeasureFilter::Pointer measure = TMeasureFilter::New();
+  typename TEstimationFilter::Pointer estimation = TEstimationFilter::New();
+
+  MultiScaleFilterType::Pointer filter = MultiScaleFilterType::New();
+  const ScopedGlobalNumberOfThreads globalThreads(state.range(2));
+  SetNumberOfThreads(filter, state.range(2));
+  filter->SetInput(input);
+  filter->SetEigenToMeasureImageFilter(measure);
+  filter->SetEigenToMeasureParameterEstimationFilter(estimation);
+  filter->SetSigmaArray(MultiScaleFilterType::GenerateEquispacedSigmaArray(sigma, 2.0 * sigma, 3));
+  filter->SetImageMask(GetMask(size, state.range(3)));
+  filter->SetPipelineScales(VPipelineScales);
+  filter->SetUseHugePages(VHugePagesAndPrefault);
+  filter->SetPrefaultBuffers(VHugePagesAndPrefault);
+
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  SetVoxelsPerSecond(state, input->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+BENCHMARK_TEMPLATE(BM_MultiScaleHessianEnhancementImageFilter, KrcahMeasureFilterType, KrcahEstimationFilterType)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MultiScaleHessianEnhancementImageFilter, DescoteauxMeasureFilterType, DescoteauxEstimationFilterType)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MultiScaleHessianEnhancementImageFilter, KrcahMeasureFilterType, KrcahEstimationFilterType, true)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MultiScaleHessianEnhancementImageFilter, KrcahMeasureFilterType, KrcahEstimationFilterType, false, true)
+  ->Apply(SizeSigmaThreadsDensityArguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,278 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "gtest/gtest.h"
+#include "itkChunkedCompressedImageFileWriter.h"
+#include "itkChunkedCompressedImageFileReader.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+class itkChunkedCompressedImageFileUnitTest
+  : public ::testing::Test
+{
+public:
+  static constexpr unsigned int Dimension = 3;
+  using ImageType       = itk::Image< float, Dimension >;
+  using LabelImageType  = itk::Image< unsigned char, Dimension >;
+  using WriterType      = itk::ChunkedCompressedImageFileWriter< ImageType >;
+  using ReaderType      = itk::ChunkedCompressedImageFileReader< ImageType >;
+
+  itkChunkedCompressedImageFileUnitTest() {}
+  ~itkChunkedCompressedImageFileUnitTest() override {}
+
+protected:
+  void SetUp() override
+  {
+    m_FileName = "itkChunkedCompressedImageFileUnitTest.bcz";
+
+    /* A measure-like image, zero outside of a ball, with a non-zero index and physical space */
+    ImageType::RegionType region;
+    region.SetIndex(0, -3);
+    region.SetIndex(1, 5);
+    region.SetIndex(2, 0);
+    region.SetSize(0, 37);
+    region.SetSize(1, 29);
+    region.SetSize(2, 41);
+    m_Image = ImageType::New();
+    m_Image->SetRegions(region);
+    m_Image->Allocate();
+    ImageType::SpacingType spacing;
+    spacing[0] = 0.5;
+    spacing[1] = 0.75;
+    spacing[2] = 1.25;
+    m_Image->SetSpacing(spacing);
+    ImageType::PointType origin;
+    origin[0] = -10.0;
+    origin[1] = 2.5;
+    origin[2] = 7.0;
+    m_Image->SetOrigin(origin);
+    ImageType::DirectionType direction;
+    direction.Fill(0.0);
+    direction[0][1] = 1.0;
+    direction[1][0] = -1.0;
+    direction[2][2] = 1.0;
+    m_Image->SetDirection(direction);
+
+    itk::ImageRegionIteratorWithIndex< ImageType > it(m_Image, region);
+    for (; !it.IsAtEnd(); ++it)
+    {
+      const ImageType::IndexType index = it.GetIndex();
+      const double dx = index[0] - 10.0, dy = index[1] - 15.0, dz = index[2] - 12.0;
+      const double r2 = dx * dx + dy * dy + dz * dz;
+      it.Set(r2 < 64.0 ? static_cast< float >( std::sin(0.3 * index[0]) * std::cos(0.2 * index[2]) - 0.1 * index[1] ) : 0.0f);
+    }
+  }
+
+  void TearDown() override
+  {
+    std::remove(m_FileName.c_str());
+  }
+
+  template< typename TImage >
+  static void ExpectEqual(const TImage * expected, const TImage * actual, const typename TImage::RegionType & region)
+  {
+    itk::ImageRegionConstIterator< TImage > eIt(expected, region);
+    itk::ImageRegionConstIterator< TImage > aIt(actual, region);
+    for (; !eIt.IsAtEnd(); ++eIt, ++aIt)
+    {
+      ASSERT_EQ(eIt.Get(), aIt.Get());
+    }
+  }
+
+  std::string         m_FileName;
+  ImageType::Pointer  m_Image;
+};
+
+TEST_F(itkChunkedCompressedImageFileUnitTest, RoundTrip) {
+  WriterType::Pointer writer = WriterType::New();
+  EXPECT_TRUE(writer->GetShuffle());
+  EXPECT_EQ(writer->GetCompressionLevel(), 1);
+  writer->SetInput(m_Image);
+  writer->SetFileName(m_FileName);
+  WriterType::SizeType chunkSize;
+  chunkSize.Fill(16);
+  writer->SetChunkSize(chunkSize);
+  writer->SetNumberOfWorkUnits(4);
+  ASSERT_NO_THROW(writer->Write());
+
+  /* 3 x 2 x 3 chunks, most of which are outside the ball */
+  EXPECT_EQ(writer->GetNumberOfChunks(), 18u);
+  EXPECT_GT(writer->GetNumberOfZeroChunks(), 0u);
+  EXPECT_LT(writer->GetFileSize(), m_Image->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(float) / 4);
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(m_FileName);
+  ASSERT_NO_THROW(reader->Update());
+  ImageType * output = reader->GetOutput();
+  EXPECT_EQ(output->GetLargestPossibleRegion(), m_Image->GetLargestPossibleRegion());
+  EXPECT_EQ(output->GetBufferedRegion(), m_Image->GetLargestPossibleRegion());
+  EXPECT_EQ(output->GetSpacing(), m_Image->GetSpacing());
+  EXPECT_EQ(output->GetOrigin(), m_Image->GetOrigin());
+  EXPECT_EQ(output->GetDirection(), m_Image->GetDirection());
+  EXPECT_EQ(reader->GetChunkSize(), chunkSize);
+  EXPECT_EQ(reader->GetNumberOfChunksRead(), writer->GetNumberOfChunks() - writer->GetNumberOfZeroChunks());
+  ExpectEqual< ImageType >(m_Image, output, m_Image->GetLargestPossibleRegion());
+}
+
+TEST_F(itkChunkedCompressedImageFileUnitTest, ReadsOnlyChunksOfTheRequestedRegion) {
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(m_Image);
+  writer->SetFileName(m_FileName);
+  WriterType::SizeType chunkSize;
+  chunkSize.Fill(8);
+  writer->SetChunkSize(chunkSize);
+  writer->ShuffleOff();
+  ASSERT_NO_THROW(writer->Write());
+
+  /* A region inside the ball, straddling chunk boundaries */
+  ImageType::RegionType region;
+  region.SetIndex(0, 6);
+  region.SetIndex(1, 12);
+  region.SetIndex(2, 9);
+  region.SetSize(0, 5);
+  region.SetSize(1, 4);
+  region.SetSize(2, 6);
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(m_FileName);
+  reader->UpdateOutputInformation();
+  reader->GetOutput()->SetRequestedRegion(region);
+  ASSERT_NO_THROW(reader->Update());
+  EXPECT_EQ(reader->GetOutput()->GetBufferedRegion(), region);
+  EXPECT_LE(reader->GetNumberOfChunksRead(), 2u * 2u * 2u);
+  EXPECT_GT(reader->GetNumberOfChunksRead(), 0u);
+  ExpectEqual< ImageType >(m_Image, reader->GetOutput(), region);
+}
+
+TEST_F(itkChunkedCompressedImageFileUnitTest, LabelImages) {
+  /* For instance the scale level of the maximum response */
+  LabelImageType::Pointer labels = LabelImageType::New();
+  labels->SetRegions(m_Image->GetLargestPossibleRegion());
+  labels->Allocate();
+  itk::ImageRegionIteratorWithIndex< LabelImageType > it(labels, labels->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    it.Set(static_cast< unsigned char >( ( it.GetIndex()[0] + it.GetIndex()[2] ) / 10 ));
+  }
+
+  using LabelWriterType = itk::ChunkedCompressedImageFileWriter< LabelImageType >;
+  using LabelReaderType = itk::ChunkedCompressedImageFileReader< LabelImageType >;
+  LabelWriterType::Pointer writer = LabelWriterType::New();
+  writer->SetInput(labels);
+  writer->SetFileName(m_FileName);
+  writer->SetCompressionLevel(9);
+  ASSERT_NO_THROW(writer->Update());
+
+  LabelReaderType::Pointer reader = LabelReaderType::New();
+  reader->SetFileName(m_FileName);
+  ASSERT_NO_THROW(reader->Update());
+  ExpectEqual< LabelImageType >(labels, reader->GetOutput(), labels->GetLargestPossibleRegion());
+
+  /* The pixel type has to match */
+  ReaderType::Pointer floatReader = ReaderType::New();
+  floatReader->SetFileName(m_FileName);
+  EXPECT_ANY_THROW(floatReader->Update());
+}
+
+TEST_F(itkChunkedCompressedImageFileUnitTest, InvalidFiles) {
+  ReaderType::Pointer reader = ReaderType::New();
+  EXPECT_ANY_THROW(reader->Update());
+  reader->SetFileName("itkChunkedCompressedImageFileUnitTestMissing.bcz");
+  EXPECT_ANY_THROW(reader->Update());
+
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(m_Image);
+  EXPECT_ANY_THROW(writer->Write());
+}
+
+TEST_F(itkChunkedCompressedImageFileUnitTest, ChunksOutsideOfTheFile) {
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(m_Image);
+  writer->SetFileName(m_FileName);
+  ASSERT_NO_THROW(writer->Write());
+  const itk::SizeValueType numberOfChunks = writer->GetNumberOfChunks();
+  const std::streamoff tableStart = itk::ChunkedCompressedImageFileFormat::GetHeaderSize(Dimension, numberOfChunks)
+    - 2 * 8 * numberOfChunks;
+
+  /* Find a chunk with data and declare it longer than the file */
+  std::fstream file(m_FileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  ASSERT_TRUE(file.good());
+  itk::SizeValueType chunk = 0;
+  for (; chunk < numberOfChunks; ++chunk)
+  {
+    unsigned char length[8];
+    file.seekg(tableStart + 16 * chunk + 8);
+    file.read(reinterpret_cast< char * >( length ), 8);
+    if (std::any_of(length, length + 8, [](unsigned char byte) { return byte != 0; }))
+    {
+      break;
+    }
+  }
+  ASSERT_LT(chunk, numberOfChunks);
+  const unsigned char hugeLength[8] = {0, 0, 0, 0, 0, 0, 0, 0x40};
+  file.seekp(tableStart + 16 * chunk + 8);
+  file.write(reinterpret_cast< const char * >( hugeLength ), 8);
+
+  /* Or starting within the header */
+  const unsigned char offsetInHeader[8] = {4, 0, 0, 0, 0, 0, 0, 0};
+  file.seekp(tableStart + 16 * chunk);
+  file.write(reinterpret_cast< const char * >( offsetInHeader ), 8);
+  file.close();
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(m_FileName);
+  EXPECT_ANY_THROW(reader->Update());
+}
+
+TEST_F(itkChunkedCompressedImageFileUnitTest, TruncatedFile) {
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(m_Image);
+  writer->SetFileName(m_FileName);
+  ASSERT_NO_THROW(writer->Write());
+
+  /* Keep the header and only part of the chunks */
+  std::vector< char > contents;
+  {
+    std::ifstream in(m_FileName.c_str(), std::ios::in | std::ios::binary);
+    contents.assign(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >());
+  }
+  const itk::SizeValueType headerSize = itk::ChunkedCompressedImageFileFormat::GetHeaderSize(Dimension, writer->GetNumberOfChunks());
+  ASSERT_GT(contents.size(), headerSize);
+  {
+    std::ofstream out(m_FileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), headerSize + ( contents.size() - headerSize ) / 2);
+  }
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(m_FileName);
+  EXPECT_ANY_THROW(reader->Update());
+
+  /* A chunk table longer than the file is rejected before it is read */
+  {
+    std::ofstream out(m_FileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), headerSize / 2);
+  }
+  reader->Modified();
+  EXPECT_ANY_THROW(reader->Update());
+}
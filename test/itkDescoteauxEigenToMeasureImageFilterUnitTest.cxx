@@ -21,6 +21,8 @@
 #include "itkImageMaskSpatialObject.h"
 #include "itkImage.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include <algorithm>
+#include <cmath>
 
 namespace
 {
@@ -303,3 +305,48 @@ TYPED_TEST(itkDescoteauxEigenToMeasureImageFilterUnitTest, TestWithSpatialObject
     ++input;
   }
 }
+
+TYPED_TEST(itkDescoteauxEigenToMeasureImageFilterUnitTest, LookupTableMatchesExactWithinMaximumError) {
+  using EigenImageType = typename TestFixture::EigenImageType;
+  using ImageType = typename itk::Image< TypeParam, 3 >;
+
+  /* Eigenvalues ordered by magnitude which sweep the ratios of the measure */
+  typename EigenImageType::Pointer eigenImage = EigenImageType::New();
+  eigenImage->SetRegions(this->m_Region);
+  eigenImage->Allocate();
+  itk::ImageRegionIteratorWithIndex< EigenImageType > eigenIt(eigenImage, this->m_Region);
+  for (; !eigenIt.IsAtEnd(); ++eigenIt)
+  {
+    const typename EigenImageType::IndexType index = eigenIt.GetIndex();
+    typename TestFixture::EigenValueArrayType pixel;
+    pixel[2] = (index[2] % 2 == 0 ? -1.0f : 1.0f) * (0.05f + 0.2f * index[2]);
+    pixel[1] = pixel[2] * 0.1f * index[1];
+    pixel[0] = pixel[1] * 0.1f * index[0];
+    eigenIt.Set(pixel);
+  }
+
+  this->m_Parameters[0] = 0.5;
+  this->m_Parameters[1] = 0.5;
+  this->m_Parameters[2] = 0.75;
+  this->m_Filter->SetParameters(this->m_Parameters);
+  this->m_Filter->SetInput(eigenImage);
+  EXPECT_FALSE(this->m_Filter->GetUseLookupTable());
+  ASSERT_NO_THROW(this->m_Filter->Update());
+  typename ImageType::Pointer exact = this->m_Filter->GetOutput();
+  exact->DisconnectPipeline();
+
+  const double maximumError = 1e-3;
+  this->m_Filter->UseLookupTableOn();
+  this->m_Filter->SetLookupTableMaximumError(maximumError);
+  ASSERT_NO_THROW(this->m_Filter->Update());
+
+  itk::ImageRegionIteratorWithIndex< ImageType > exactIt(exact, this->m_Region);
+  itk::ImageRegionIteratorWithIndex< ImageType > approximateIt(this->m_Filter->GetOutput(), this->m_Region);
+  double largestError = 0.0;
+  for (; !exactIt.IsAtEnd(); ++exactIt, ++approximateIt)
+  {
+    largestError = std::max(largestError, std::abs(static_cast< double >( exactIt.Get() - approximateIt.Get() )));
+  }
+  EXPECT_LE(largestError, maximumError + 1e-6);
+  EXPECT_GT(largestError, 0.0);
+}
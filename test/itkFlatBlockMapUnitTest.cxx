@@ -0,0 +1,185 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkFlatBlockMap.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImage.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+class itkFlatBlockMapUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using ImageType       = itk::Image< short, DIMENSION >;
+  using CountImageType  = itk::Image< int, DIMENSION >;
+  using MapType         = itk::FlatBlockMap< DIMENSION >;
+
+protected:
+  void SetUp() override {
+    /* A constant image, not starting at the origin, with a bright cube in block (2, 0, 0) */
+    m_Region.SetIndex(ImageType::IndexType{{-2, 3, 0}});
+    m_Region.SetSize(ImageType::SizeType{{40, 20, 16}});
+    m_Image = ImageType::New();
+    m_Image->SetRegions(m_Region);
+    m_Image->Allocate();
+    m_Image->FillBuffer(100);
+
+    ImageType::RegionType cube;
+    cube.SetIndex(ImageType::IndexType{{-2 + 18, 3 + 2, 2}});
+    cube.SetSize(ImageType::SizeType{{4, 4, 4}});
+    itk::ImageRegionIterator< ImageType > it(m_Image, cube);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      it.Set(1000);
+    }
+
+    m_Ranges = MapType::New();
+    m_Ranges->SetBlockSize(MapType::SizeType{{8, 8, 8}});
+  }
+  void TearDown() override {}
+
+  ImageType::RegionType m_Region;
+  ImageType::Pointer    m_Image;
+  MapType::Pointer      m_Ranges;
+};
+}
+
+TEST_F(itkFlatBlockMapUnitTest, ComputesTheGridOfBlocks) {
+  ASSERT_NO_THROW(m_Ranges->ComputeBlockRanges(m_Image.GetPointer(), nullptr));
+  EXPECT_EQ(m_Ranges->GetRegion(), m_Region);
+  EXPECT_EQ(m_Ranges->GetGridSize(), (MapType::SizeType{{5, 3, 2}}));
+  EXPECT_EQ(m_Ranges->GetNumberOfBlocks(), 30u);
+  EXPECT_EQ(m_Ranges->GetNumberOfFlatBlocks(), 0u);
+}
+
+TEST_F(itkFlatBlockMapUnitTest, OnlyTheBlockOfTheCubeIsNotFlat) {
+  m_Ranges->ComputeBlockRanges(m_Image.GetPointer(), nullptr);
+  MapType::Pointer flatBlocks = m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 0.0);
+  EXPECT_EQ(flatBlocks->GetNumberOfBlocks(), 30u);
+  EXPECT_EQ(flatBlocks->GetNumberOfFlatBlocks(), 29u);
+  EXPECT_EQ(flatBlocks->GetNumberOfFlatPixels(), 40u * 20u * 16u - 8u * 8u * 8u);
+  for (itk::SizeValueType block = 0; block < flatBlocks->GetNumberOfBlocks(); ++block)
+  {
+    EXPECT_EQ(flatBlocks->IsFlat(block), block != 2);
+  }
+
+  MapType::RegionType nonFlatRegion;
+  ASSERT_TRUE(flatBlocks->GetNonFlatRegion(m_Region, nonFlatRegion));
+  EXPECT_EQ(nonFlatRegion.GetIndex(), (MapType::IndexType{{14, 3, 0}}));
+  EXPECT_EQ(nonFlatRegion.GetSize(), (MapType::SizeType{{8, 8, 8}}));
+}
+
+TEST_F(itkFlatBlockMapUnitTest, RowsOfBlocksNeedOnlyTheirPlanes) {
+  m_Ranges->InitializeBlockRanges(m_Region);
+  EXPECT_EQ(m_Ranges->GetGridSize(), (MapType::SizeType{{5, 3, 2}}));
+  EXPECT_THROW(m_Ranges->GetBlockRowRegion(2), itk::ExceptionObject);
+
+  /* Each row is computed from an image which only buffers the planes of that row */
+  for (itk::SizeValueType row = 0; row < 2; ++row)
+  {
+    const MapType::RegionType rowRegion = m_Ranges->GetBlockRowRegion(row);
+    EXPECT_EQ(rowRegion.GetIndex(2), static_cast< itk::IndexValueType >( 8 * row ));
+    EXPECT_EQ(rowRegion.GetSize(2), 8u);
+
+    ImageType::Pointer rowImage = ImageType::New();
+    rowImage->SetLargestPossibleRegion(m_Region);
+    rowImage->SetBufferedRegion(rowRegion);
+    rowImage->Allocate();
+    itk::ImageRegionConstIterator< ImageType > inIt(m_Image, rowRegion);
+    itk::ImageRegionIterator< ImageType > outIt(rowImage, rowRegion);
+    for (; !inIt.IsAtEnd(); ++inIt, ++outIt)
+    {
+      outIt.Set(inIt.Get());
+    }
+    EXPECT_THROW(m_Ranges->ComputeBlockRowRanges(rowImage.GetPointer(), 1 - row, nullptr), itk::ExceptionObject);
+    ASSERT_NO_THROW(m_Ranges->ComputeBlockRowRanges(rowImage.GetPointer(), row, nullptr));
+  }
+
+  /* The same blocks are flat as from the whole image */
+  MapType::Pointer flatBlocks = m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 0.0);
+  EXPECT_EQ(flatBlocks->GetNumberOfFlatBlocks(), 29u);
+  EXPECT_FALSE(flatBlocks->IsFlat(2));
+}
+
+TEST_F(itkFlatBlockMapUnitTest, RadiusExtendsToTheNeighbouringBlocks) {
+  m_Ranges->ComputeBlockRanges(m_Image.GetPointer(), nullptr);
+
+  /* A radius of one pixel reaches one block in every direction, the last block along y is 4 pixels */
+  MapType::Pointer flatBlocks = m_Ranges->ComputeFlatBlocks(MapType::SizeType{{1, 1, 1}}, 0.0);
+  EXPECT_EQ(flatBlocks->GetNumberOfFlatBlocks(), 30u - 3u * 2u * 2u);
+  EXPECT_EQ(flatBlocks->GetNumberOfFlatPixels(), 40u * 20u * 16u - 24u * 16u * 16u);
+
+  /* The ranges of the map are not modified */
+  MapType::Pointer again = m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 0.0);
+  EXPECT_EQ(again->GetNumberOfFlatBlocks(), 29u);
+}
+
+TEST_F(itkFlatBlockMapUnitTest, ThresholdCoversTheRange) {
+  m_Ranges->ComputeBlockRanges(m_Image.GetPointer(), nullptr);
+  EXPECT_EQ(m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 899.0)->GetNumberOfFlatBlocks(), 29u);
+  EXPECT_EQ(m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 900.0)->GetNumberOfFlatBlocks(), 30u);
+
+  MapType::RegionType nonFlatRegion;
+  EXPECT_FALSE(m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 900.0)->GetNonFlatRegion(m_Region, nonFlatRegion));
+}
+
+TEST_F(itkFlatBlockMapUnitTest, VisitBlocksCoversEveryPixelOnce) {
+  m_Ranges->ComputeBlockRanges(m_Image.GetPointer(), nullptr);
+  MapType::Pointer flatBlocks = m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 0.0);
+
+  CountImageType::Pointer counts = CountImageType::New();
+  counts->SetRegions(m_Region);
+  counts->Allocate();
+  counts->FillBuffer(0);
+
+  /* A region which is not aligned with the blocks */
+  MapType::RegionType region;
+  region.SetIndex(MapType::IndexType{{1, 4, 3}});
+  region.SetSize(MapType::SizeType{{30, 15, 11}});
+  itk::SizeValueType numberOfParts = 0;
+  itk::SizeValueType numberOfNonFlatParts = 0;
+  flatBlocks->VisitBlocks(region, [&](const MapType::RegionType & part, bool flat)
+  {
+    EXPECT_TRUE(region.IsInside(part));
+    ++numberOfParts;
+    numberOfNonFlatParts += flat ? 0 : 1;
+    itk::ImageRegionIterator< CountImageType > it(counts, part);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      it.Set(it.Get() + 1);
+    }
+  });
+  EXPECT_EQ(numberOfParts, 5u * 2u * 2u);
+  EXPECT_EQ(numberOfNonFlatParts, 1u);
+
+  itk::ImageRegionConstIterator< CountImageType > it(counts, m_Region);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    ASSERT_EQ(it.Get(), region.IsInside(it.GetIndex()) ? 1 : 0);
+  }
+}
+
+TEST_F(itkFlatBlockMapUnitTest, FlatBlocksNeedTheRanges) {
+  EXPECT_THROW(m_Ranges->ComputeFlatBlocks(MapType::SizeType{{0, 0, 0}}, 0.0), itk::ExceptionObject);
+  EXPECT_THROW(m_Ranges->ComputeBlockRanges(static_cast< const ImageType * >( nullptr ), nullptr), itk::ExceptionObject);
+}
@@ -18,6 +18,56 @@
 
 #include "itkHessianGaussianImageFilter.h"
 #include "gtest/gtest.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkStreamingImageFilter.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+/** A Gaussian blob of variance 16 off center, so all components of the Hessian are non-zero */
+template< typename TImage >
+typename TImage::Pointer CreateGaussianBlob(const typename TImage::SizeType & size,
+                                            const std::array< double, TImage::ImageDimension > & center)
+{
+  typename TImage::Pointer image = TImage::New();
+  typename TImage::RegionType region;
+  region.SetSize(size);
+  image->SetRegions(region);
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< TImage > it(image, region);
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double distance2 = 0.0;
+    for (unsigned int d = 0; d < TImage::ImageDimension; ++d)
+    {
+      const double offset = it.GetIndex()[d] - center[d];
+      distance2 += offset * offset;
+    }
+    it.Set(static_cast< typename TImage::PixelType >( 100.0 * std::exp(-distance2 / (2.0 * 16.0)) ));
+  }
+  return image;
+}
+
+/** Largest absolute component of a Hessian image, to compare relative to */
+template< typename THessianImage >
+double LargestComponent(const THessianImage * hessian)
+{
+  double largest = 0.0;
+  itk::ImageRegionConstIterator< THessianImage > it(hessian, hessian->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    for (unsigned int i = 0; i < THessianImage::PixelType::Length; ++i)
+    {
+      largest = std::max(largest, std::abs(static_cast< double >( it.Get()[i] )));
+    }
+  }
+  return largest;
+}
+}
 
 TEST(itkHessianGaussianImageFilterTest, ExerciseBasicMethods) {
   const unsigned int                                  Dimension = 2;
@@ -39,3 +89,320 @@ TEST(itkHessianGaussianImageFilterTest, ExerciseBasicMethods) {
   hess_filter->NormalizeAcrossScaleOn();
   EXPECT_EQ(true, hess_filter->GetNormalizeAcrossScale());
 }
+
+TEST(itkHessianGaussianImageFilterTest, KernelRadiusGrowsWithSigma) {
+  const unsigned int                                  Dimension = 2;
+  using PixelType                       = int;
+  using ImageType                       = itk::Image< PixelType, Dimension >;
+  using HessianGaussianImageFilterType  = itk::HessianGaussianImageFilter<ImageType>;
+  HessianGaussianImageFilterType::Pointer hess_filter = HessianGaussianImageFilterType::New();
+
+  /* The radius depends on the input spacing */
+  EXPECT_ANY_THROW(hess_filter->GetKernelRadius());
+
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  region.SetSize(ImageType::SizeType{{10, 10}});
+  image->SetRegions(region);
+  ImageType::SpacingType spacing;
+  spacing[0] = 1.0;
+  spacing[1] = 0.5;
+  image->SetSpacing(spacing);
+  hess_filter->SetInput(image);
+
+  hess_filter->SetSigma(1.0);
+  HessianGaussianImageFilterType::RadiusType small = hess_filter->GetKernelRadius();
+  hess_filter->SetSigma(2.0);
+  HessianGaussianImageFilterType::RadiusType large = hess_filter->GetKernelRadius();
+
+  for (unsigned int i = 0; i < Dimension; ++i)
+  {
+    EXPECT_GT(small[i], 0u);
+    EXPECT_GT(large[i], small[i]);
+  }
+
+  /* Finer spacing needs more voxels for the same physical sigma */
+  EXPECT_GT(large[1], large[0]);
+}
+
+TEST(itkHessianGaussianImageFilterTest, BoxWidthsMatchVariance) {
+  const unsigned int                                  Dimension = 2;
+  using PixelType                       = float;
+  using ImageType                       = itk::Image< PixelType, Dimension >;
+  using HessianGaussianImageFilterType  = itk::HessianGaussianImageFilter<ImageType>;
+  HessianGaussianImageFilterType::Pointer hess_filter = HessianGaussianImageFilterType::New();
+
+  EXPECT_EQ(HessianGaussianImageFilterType::ExactGaussian, hess_filter->GetHessianMethod());
+  EXPECT_EQ(3u, hess_filter->GetNumberOfBoxPasses());
+  hess_filter->SetHessianMethodToBoxApproximation();
+  EXPECT_EQ(HessianGaussianImageFilterType::BoxApproximation, hess_filter->GetHessianMethod());
+
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  region.SetSize(ImageType::SizeType{{10, 10}});
+  image->SetRegions(region);
+  ImageType::SpacingType spacing;
+  spacing[0] = 1.0;
+  spacing[1] = 0.5;
+  image->SetSpacing(spacing);
+  hess_filter->SetInput(image);
+
+  /* The variance of the boxes is within (w + 1) / 6 squared pixels of sigma squared */
+  for (double sigma : {0.8, 1.0, 2.5, 4.0})
+  {
+    hess_filter->SetSigma(sigma);
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      const double sigmaInPixels = sigma / spacing[i];
+      HessianGaussianImageFilterType::BoxWidthsType widths = hess_filter->GetBoxWidths(i);
+      ASSERT_EQ(hess_filter->GetNumberOfBoxPasses(), widths.size());
+
+      double variance = 0.0;
+      unsigned int radius = 1;
+      for (unsigned int width : widths)
+      {
+        EXPECT_EQ(1u, width % 2);
+        variance += (width * width - 1.0) / 12.0;
+        radius += (width - 1) / 2;
+      }
+      EXPECT_LE(std::abs(variance - sigmaInPixels * sigmaInPixels), (widths.back() + 1.0) / 6.0);
+      EXPECT_EQ(radius, hess_filter->GetKernelRadius()[i]);
+    }
+  }
+}
+
+TEST(itkHessianGaussianImageFilterTest, BoxApproximationCloseToExact) {
+  const unsigned int                                  Dimension = 3;
+  using PixelType                       = float;
+  using ImageType                       = itk::Image< PixelType, Dimension >;
+  using HessianGaussianImageFilterType  = itk::HessianGaussianImageFilter<ImageType>;
+  using OutputImageType                 = HessianGaussianImageFilterType::OutputImageType;
+
+  ImageType::Pointer image = CreateGaussianBlob< ImageType >(ImageType::SizeType{{32, 28, 30}}, {{15.0, 13.0, 16.0}});
+  const ImageType::RegionType region = image->GetLargestPossibleRegion();
+
+  HessianGaussianImageFilterType::Pointer exact = HessianGaussianImageFilterType::New();
+  exact->SetInput(image);
+  exact->SetSigma(2.0);
+  exact->NormalizeAcrossScaleOn();
+  ASSERT_NO_THROW(exact->Update());
+
+  HessianGaussianImageFilterType::Pointer box = HessianGaussianImageFilterType::New();
+  box->SetInput(image);
+  box->SetSigma(2.0);
+  box->NormalizeAcrossScaleOn();
+  box->SetHessianMethodToBoxApproximation();
+  box->SetNumberOfWorkUnits(3);
+  ASSERT_NO_THROW(box->Update());
+  EXPECT_EQ(region, box->GetOutput()->GetBufferedRegion());
+
+  /* Compare relative to the largest component */
+  const double largest = LargestComponent(exact->GetOutput());
+  ASSERT_GT(largest, 0.0);
+
+  itk::ImageRegionConstIterator< OutputImageType > eIt(exact->GetOutput(), region);
+  itk::ImageRegionConstIterator< OutputImageType > bIt(box->GetOutput(), region);
+  for (; !eIt.IsAtEnd(); ++eIt, ++bIt)
+  {
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+      ASSERT_NEAR(eIt.Get()[i], bIt.Get()[i], 0.05 * largest);
+    }
+  }
+}
+
+TEST(itkHessianGaussianImageFilterTest, IncrementalScaleSpaceMatchesSmoothingFromScratch) {
+  const unsigned int                                  Dimension = 3;
+  using PixelType                       = float;
+  using ImageType                       = itk::Image< PixelType, Dimension >;
+  using HessianGaussianImageFilterType  = itk::HessianGaussianImageFilter<ImageType>;
+  using OutputImageType                 = HessianGaussianImageFilterType::OutputImageType;
+
+  ImageType::Pointer image = CreateGaussianBlob< ImageType >(ImageType::SizeType{{32, 28, 30}}, {{15.0, 13.0, 16.0}});
+  const ImageType::RegionType region = image->GetLargestPossibleRegion();
+
+  /* Smooth incrementally from sigma 1 to 2 */
+  HessianGaussianImageFilterType::Pointer incremental = HessianGaussianImageFilterType::New();
+  incremental->SetInput(image);
+  incremental->NormalizeAcrossScaleOn();
+  incremental->SetHessianMethodToIncrementalScaleSpace();
+  incremental->SetNumberOfWorkUnits(3);
+  EXPECT_EQ(incremental->GetScaleSpaceSigma(), 0.0);
+  incremental->SetSigma(1.0);
+  ASSERT_NO_THROW(incremental->Update());
+  EXPECT_EQ(incremental->GetScaleSpaceSigma(), 1.0);
+  incremental->SetSigma(2.0);
+  ASSERT_NO_THROW(incremental->Update());
+  EXPECT_EQ(incremental->GetScaleSpaceSigma(), 2.0);
+  EXPECT_EQ(region, incremental->GetOutput()->GetBufferedRegion());
+
+  /* Smooth to sigma 2 at once */
+  HessianGaussianImageFilterType::Pointer direct = HessianGaussianImageFilterType::New();
+  direct->SetInput(image);
+  direct->NormalizeAcrossScaleOn();
+  direct->SetHessianMethodToIncrementalScaleSpace();
+  direct->SetSigma(2.0);
+  ASSERT_NO_THROW(direct->Update());
+
+  HessianGaussianImageFilterType::Pointer exact = HessianGaussianImageFilterType::New();
+  exact->SetInput(image);
+  exact->NormalizeAcrossScaleOn();
+  exact->SetSigma(2.0);
+  ASSERT_NO_THROW(exact->Update());
+
+  /* Compare relative to the largest component */
+  const double largest = LargestComponent(exact->GetOutput());
+  ASSERT_GT(largest, 0.0);
+
+  itk::ImageRegionConstIterator< OutputImageType > eIt(exact->GetOutput(), region);
+  itk::ImageRegionConstIterator< OutputImageType > iIt(incremental->GetOutput(), region);
+  itk::ImageRegionConstIterator< OutputImageType > dIt(direct->GetOutput(), region);
+  for (; !eIt.IsAtEnd(); ++eIt, ++iIt, ++dIt)
+  {
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+      ASSERT_NEAR(dIt.Get()[i], iIt.Get()[i], 0.01 * largest);
+      ASSERT_NEAR(eIt.Get()[i], iIt.Get()[i], 0.05 * largest);
+    }
+  }
+
+  /* Another piece at the same sigma only takes differences of the kept image */
+  OutputImageType::Pointer full = incremental->GetOutput();
+  full->DisconnectPipeline();
+  ImageType::RegionType piece;
+  piece.SetIndex(ImageType::IndexType{{4, 6, 8}});
+  piece.SetSize(ImageType::SizeType{{10, 9, 7}});
+  incremental->GetOutput()->SetRequestedRegion(piece);
+  ASSERT_NO_THROW(incremental->Update());
+  EXPECT_EQ(incremental->GetScaleSpaceSigma(), 2.0);
+  itk::ImageRegionConstIterator< OutputImageType > fIt(full, piece);
+  itk::ImageRegionConstIterator< OutputImageType > pIt(incremental->GetOutput(), piece);
+  for (; !fIt.IsAtEnd(); ++fIt, ++pIt)
+  {
+    ASSERT_EQ(fIt.Get(), pIt.Get());
+  }
+
+  incremental->ReleaseScaleSpace();
+  EXPECT_EQ(incremental->GetScaleSpaceSigma(), 0.0);
+}
+
+TEST(itkHessianGaussianImageFilterTest, SmoothThenFiniteDifferenceCloseToExact) {
+  const unsigned int                                  Dimension = 3;
+  using PixelType                       = float;
+  using ImageType                       = itk::Image< PixelType, Dimension >;
+  using HessianGaussianImageFilterType  = itk::HessianGaussianImageFilter<ImageType>;
+  using OutputImageType                 = HessianGaussianImageFilterType::OutputImageType;
+
+  ImageType::Pointer image = CreateGaussianBlob< ImageType >(ImageType::SizeType{{32, 28, 30}}, {{15.0, 13.0, 16.0}});
+  const ImageType::RegionType region = image->GetLargestPossibleRegion();
+
+  /* The error bound of the documentation, with a margin for the truncation of the kernels */
+  for (double zSpacing : {1.0, 0.5})
+  {
+    ImageType::SpacingType spacing;
+    spacing[0] = 1.0;
+    spacing[1] = 1.0;
+    spacing[2] = zSpacing;
+    image->SetSpacing(spacing);
+    for (double sigma : {1.5, 2.0, 3.0})
+    {
+      HessianGaussianImageFilterType::Pointer exact = HessianGaussianImageFilterType::New();
+      exact->SetInput(image);
+      exact->SetSigma(sigma);
+      exact->NormalizeAcrossScaleOn();
+      ASSERT_NO_THROW(exact->Update());
+
+      HessianGaussianImageFilterType::Pointer difference = HessianGaussianImageFilterType::New();
+      difference->SetInput(image);
+      difference->SetSigma(sigma);
+      difference->NormalizeAcrossScaleOn();
+      difference->SetHessianMethodToSmoothThenFiniteDifference();
+      difference->SetNumberOfWorkUnits(3);
+      ASSERT_NO_THROW(difference->Update());
+      EXPECT_EQ(region, difference->GetOutput()->GetBufferedRegion());
+
+      const double largest = LargestComponent(exact->GetOutput());
+      ASSERT_GT(largest, 0.0);
+
+      const double tolerance = ( 0.25 / ( sigma * sigma ) + 0.02 ) * largest;
+      itk::ImageRegionConstIterator< OutputImageType > eIt(exact->GetOutput(), region);
+      itk::ImageRegionConstIterator< OutputImageType > dIt(difference->GetOutput(), region);
+      for (; !eIt.IsAtEnd(); ++eIt, ++dIt)
+      {
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+          ASSERT_NEAR(eIt.Get()[i], dIt.Get()[i], tolerance) << "sigma " << sigma << " z spacing " << zSpacing;
+        }
+      }
+
+      /* Streamed pieces match the whole output */
+      OutputImageType::Pointer full = difference->GetOutput();
+      full->DisconnectPipeline();
+      ImageType::RegionType piece;
+      piece.SetIndex(ImageType::IndexType{{0, 6, 20}});
+      piece.SetSize(ImageType::SizeType{{12, 9, 10}});
+      difference->GetOutput()->SetRequestedRegion(piece);
+      ASSERT_NO_THROW(difference->Update());
+      itk::ImageRegionConstIterator< OutputImageType > fIt(full, piece);
+      itk::ImageRegionConstIterator< OutputImageType > pIt(difference->GetOutput(), piece);
+      for (; !fIt.IsAtEnd(); ++fIt, ++pIt)
+      {
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+          ASSERT_NEAR(fIt.Get()[i], pIt.Get()[i], 1e-5 * largest);
+        }
+      }
+    }
+  }
+}
+
+TEST(itkHessianGaussianImageFilterTest, SlidingSlabMatchesSmoothThenFiniteDifference) {
+  const unsigned int                                  Dimension = 3;
+  using PixelType                       = float;
+  using ImageType                       = itk::Image< PixelType, Dimension >;
+  using HessianGaussianImageFilterType  = itk::HessianGaussianImageFilter<ImageType>;
+  using OutputImageType                 = HessianGaussianImageFilterType::OutputImageType;
+  using StreamingFilterType             = itk::StreamingImageFilter< OutputImageType, OutputImageType >;
+
+  ImageType::Pointer image = CreateGaussianBlob< ImageType >(ImageType::SizeType{{24, 20, 40}}, {{11.0, 9.0, 18.0}});
+  const ImageType::RegionType region = image->GetLargestPossibleRegion();
+
+  HessianGaussianImageFilterType::Pointer whole = HessianGaussianImageFilterType::New();
+  whole->SetInput(image);
+  whole->SetSigma(2.0);
+  whole->NormalizeAcrossScaleOn();
+  whole->SetHessianMethodToSmoothThenFiniteDifference();
+  ASSERT_NO_THROW(whole->Update());
+
+  /* Stream slabs of 4 planes along the slowest dimension */
+  HessianGaussianImageFilterType::Pointer slab = HessianGaussianImageFilterType::New();
+  slab->SetInput(image);
+  slab->SetSigma(2.0);
+  slab->NormalizeAcrossScaleOn();
+  slab->SetHessianMethodToSlidingSlab();
+  slab->SetNumberOfWorkUnits(3);
+  StreamingFilterType::Pointer streamer = StreamingFilterType::New();
+  streamer->SetInput(slab->GetOutput());
+  streamer->SetNumberOfStreamDivisions(10);
+  streamer->SetRegionSplitter(itk::ImageRegionSplitterSlowDimension::New());
+  ASSERT_NO_THROW(streamer->Update());
+
+  /* The ring holds the planes of a slab, one more on each side and the kernel radius */
+  const itk::SizeValueType radius = slab->GetKernelRadius()[2] - 1;
+  EXPECT_GT(slab->GetMaximumNumberOfSlabPlanes(), 0u);
+  EXPECT_LE(slab->GetMaximumNumberOfSlabPlanes(), 4u + 2u * radius + 2u);
+  EXPECT_LT(slab->GetMaximumNumberOfSlabPlanes(), region.GetSize(2));
+
+  itk::ImageRegionConstIterator< OutputImageType > wIt(whole->GetOutput(), region);
+  itk::ImageRegionConstIterator< OutputImageType > sIt(streamer->GetOutput(), region);
+  for (; !wIt.IsAtEnd(); ++wIt, ++sIt)
+  {
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+      ASSERT_NEAR(wIt.Get()[i], sIt.Get()[i], 1e-4);
+    }
+  }
+
+  slab->ReleaseScaleSpace();
+  EXPECT_EQ(slab->GetMaximumNumberOfSlabPlanes(), 0u);
+}
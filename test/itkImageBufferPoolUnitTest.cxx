@@ -0,0 +1,190 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkImageBufferPool.h"
+#include "itkPooledImportImageContainer.h"
+#include "itkParallelFirstTouchAllocator.h"
+#include "itkMultiScaleHessianEnhancementImageFilter.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
+#include "itkTrabecularBonePhantomImageSource.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImage.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+class itkImageBufferPoolUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using InputImageType    = itk::Image< short, DIMENSION >;
+  using OutputImageType   = itk::Image< float, DIMENSION >;
+  using FilterType        = itk::MultiScaleHessianEnhancementImageFilter< InputImageType, OutputImageType >;
+  using EigenImageType    = FilterType::EigenValueImageType;
+  using MeasureType       = itk::KrcahEigenToMeasureImageFilter< EigenImageType, OutputImageType >;
+  using EstimationType    = itk::KrcahEigenToMeasureParameterEstimationFilter< EigenImageType >;
+  using PhantomSourceType = itk::TrabecularBonePhantomImageSource< InputImageType >;
+  using PoolType          = itk::ImageBufferPool;
+
+protected:
+  void SetUp() override {
+    m_WasEnabled = PoolType::GetGlobalEnabled();
+    m_MinimumBlockSize = PoolType::GetMinimumBlockSize();
+    m_MaximumCachedBytes = PoolType::GetMaximumCachedBytes();
+    PoolType::ReleaseCachedBlocks();
+    PoolType::ResetStatistics();
+
+    /* Pool even the small images of these tests */
+    PoolType::SetMinimumBlockSize(1024);
+    PoolType::GlobalEnabledOn();
+  }
+  void TearDown() override {
+    PoolType::SetGlobalEnabled(m_WasEnabled);
+    PoolType::SetMinimumBlockSize(m_MinimumBlockSize);
+    PoolType::SetMaximumCachedBytes(m_MaximumCachedBytes);
+    PoolType::ReleaseCachedBlocks();
+  }
+
+  OutputImageType::Pointer AllocateImage(unsigned int size) {
+    OutputImageType::RegionType region;
+    region.SetSize(OutputImageType::SizeType{{size, size, size}});
+    OutputImageType::Pointer image = OutputImageType::New();
+    image->SetRegions(region);
+    itk::PooledImportImageContainer< itk::SizeValueType, float >::UsePool(image.GetPointer());
+    image->Allocate(true);
+    return image;
+  }
+
+  bool                m_WasEnabled;
+  itk::SizeValueType  m_MinimumBlockSize;
+  itk::SizeValueType  m_MaximumCachedBytes;
+};
+}
+
+TEST_F(itkImageBufferPoolUnitTest, BlocksAreReused) {
+  OutputImageType::Pointer image = this->AllocateImage(32);
+  const float * first = image->GetBufferPointer();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(image->GetPixel(OutputImageType::IndexType{{31, 31, 31}}), 0.0f);
+
+  PoolType::Statistics statistics = PoolType::GetStatistics();
+  EXPECT_EQ(statistics.m_NumberOfRequests, 1u);
+  EXPECT_EQ(statistics.m_NumberOfSystemAllocations, 1u);
+  EXPECT_GE(statistics.m_BytesInUse, 32u * 32u * 32u * sizeof(float));
+  EXPECT_EQ(statistics.m_BytesInUse % PoolType::BlockAlignment, 0u);
+
+  /* Releasing the image returns its block to the pool */
+  image->ReleaseData();
+  statistics = PoolType::GetStatistics();
+  EXPECT_EQ(statistics.m_BytesInUse, 0u);
+  EXPECT_GT(statistics.m_BytesCached, 0u);
+
+  /* A request of a similar size gets the same block back */
+  image = this->AllocateImage(30);
+  EXPECT_EQ(image->GetBufferPointer(), first);
+  statistics = PoolType::GetStatistics();
+  EXPECT_EQ(statistics.m_NumberOfRequests, 2u);
+  EXPECT_EQ(statistics.m_NumberOfReuses, 1u);
+  EXPECT_EQ(statistics.m_NumberOfSystemAllocations, 1u);
+  EXPECT_EQ(statistics.m_BytesCached, 0u);
+}
+
+TEST_F(itkImageBufferPoolUnitTest, CacheIsBounded) {
+  this->AllocateImage(32);
+  EXPECT_GT(PoolType::GetStatistics().m_BytesCached, 0u);
+
+  PoolType::SetMaximumCachedBytes(0);
+  EXPECT_EQ(PoolType::GetStatistics().m_BytesCached, 0u);
+  this->AllocateImage(32);
+  EXPECT_EQ(PoolType::GetStatistics().m_BytesCached, 0u);
+  EXPECT_EQ(PoolType::GetStatistics().m_NumberOfSystemReleases, 2u);
+}
+
+TEST_F(itkImageBufferPoolUnitTest, DisabledPoolIsNotUsed) {
+  PoolType::GlobalEnabledOff();
+  OutputImageType::Pointer image = this->AllocateImage(32);
+  EXPECT_EQ(PoolType::GetStatistics().m_NumberOfRequests, 0u);
+  EXPECT_EQ(dynamic_cast< itk::PooledImportImageContainer< itk::SizeValueType, float > * >( image->GetPixelContainer() ), nullptr);
+}
+
+TEST_F(itkImageBufferPoolUnitTest, PoolCanBeEnabledForOneFilter) {
+  PoolType::GlobalEnabledOff();
+  FilterType::Pointer filter = FilterType::New();
+  FilterType::Pointer other = FilterType::New();
+  PoolType::EnableForFilter(filter.GetPointer(), false);
+  EXPECT_TRUE(PoolType::GetEnabled(filter.GetPointer()));
+  EXPECT_FALSE(PoolType::GetEnabled(other.GetPointer()));
+  EXPECT_FALSE(PoolType::GetEnabled(nullptr));
+
+  /* Blocks are cached while the pool is enabled for some filter */
+  OutputImageType::RegionType region;
+  region.SetSize(OutputImageType::SizeType{{32, 32, 32}});
+  OutputImageType::Pointer image = OutputImageType::New();
+  image->SetRegions(region);
+  itk::PooledImportImageContainer< itk::SizeValueType, float >::UsePool(image.GetPointer(), filter.GetPointer());
+  image->Allocate();
+  EXPECT_EQ(PoolType::GetStatistics().m_NumberOfRequests, 1u);
+  image->ReleaseData();
+  EXPECT_GT(PoolType::GetStatistics().m_BytesCached, 0u);
+
+  /* A pooled container follows the policy of the filter which allocates it */
+  itk::PooledImportImageContainer< itk::SizeValueType, float >::UsePool(image.GetPointer(), filter.GetPointer());
+  itk::PooledImportImageContainer< itk::SizeValueType, float >::UsePool(image.GetPointer(), other.GetPointer());
+  image->Allocate();
+  EXPECT_EQ(PoolType::GetStatistics().m_NumberOfRequests, 1u);
+
+  /* The cache is returned to the system once the pool is not enabled anywhere */
+  PoolType::DisableForFilter(filter.GetPointer());
+  EXPECT_FALSE(PoolType::GetEnabled(filter.GetPointer()));
+  EXPECT_EQ(PoolType::GetStatistics().m_BytesCached, 0u);
+}
+
+TEST_F(itkImageBufferPoolUnitTest, MultiScaleFilterReusesBuffersAcrossScales) {
+  PhantomSourceType::Pointer phantom = PhantomSourceType::New();
+  phantom->SetSize(InputImageType::SizeType{{24, 24, 24}});
+  phantom->SetTrabecularSpacing(6.0);
+  phantom->Update();
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(phantom->GetOutput());
+  filter->SetEigenToMeasureImageFilter(MeasureType::New());
+  filter->SetEigenToMeasureParameterEstimationFilter(EstimationType::New());
+  filter->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 2.0, 3));
+
+  PoolType::GlobalEnabledOff();
+  filter->Update();
+  OutputImageType::Pointer reference = filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  PoolType::GlobalEnabledOn();
+  filter->Modified();
+  filter->Update();
+  const PoolType::Statistics statistics = PoolType::GetStatistics();
+  EXPECT_GT(statistics.m_NumberOfReuses, 0u);
+  EXPECT_LT(statistics.m_NumberOfSystemAllocations, statistics.m_NumberOfRequests);
+
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > pIt(filter->GetOutput(), filter->GetOutput()->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++pIt)
+  {
+    ASSERT_EQ(rIt.Get(), pIt.Get());
+  }
+}
@@ -0,0 +1,120 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "gtest/gtest.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+class itkKrcahEigenToMeasureImageFilterUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using OutputImageType     = itk::Image< float, DIMENSION >;
+  using EigenValueArrayType = itk::FixedArray< float, DIMENSION >;
+  using EigenImageType      = itk::Image< EigenValueArrayType, DIMENSION >;
+  using FilterType          = itk::KrcahEigenToMeasureImageFilter< EigenImageType, OutputImageType >;
+  using ParameterArrayType  = FilterType::ParameterArrayType;
+
+protected:
+  void SetUp() override {
+    m_Region.SetSize(EigenImageType::SizeType{{10, 10, 10}});
+
+    /* Eigenvalues ordered by magnitude which sweep the ratios of the measure, including l1 = 0 */
+    m_EigenImage = EigenImageType::New();
+    m_EigenImage->SetRegions(m_Region);
+    m_EigenImage->Allocate();
+    itk::ImageRegionIteratorWithIndex< EigenImageType > eigenIt(m_EigenImage, m_Region);
+    for (; !eigenIt.IsAtEnd(); ++eigenIt)
+    {
+      const EigenImageType::IndexType index = eigenIt.GetIndex();
+      EigenValueArrayType pixel;
+      pixel[2] = (index[2] % 2 == 0 ? -1.0f : 1.0f) * (0.05f + 0.2f * index[2]);
+      pixel[1] = pixel[2] * 0.1f * (index[1] + 1);
+      pixel[0] = pixel[1] * 0.1f * index[0];
+      eigenIt.Set(pixel);
+    }
+
+    m_Filter = FilterType::New();
+    m_Filter->SetInput(m_EigenImage);
+    m_Filter->SetEnhanceBrightObjects();
+    m_Parameters.SetSize(3);
+    m_Parameters[0] = 0.5;
+    m_Parameters[1] = 0.5;
+    m_Parameters[2] = 0.75;
+  }
+
+  /* Largest absolute difference between the exact and tabulated measure */
+  double ComputeLookupTableError(double maximumError)
+  {
+    m_Filter->SetParameters(m_Parameters);
+    m_Filter->UseLookupTableOff();
+    m_Filter->Update();
+    OutputImageType::Pointer exact = m_Filter->GetOutput();
+    exact->DisconnectPipeline();
+
+    m_Filter->UseLookupTableOn();
+    m_Filter->SetLookupTableMaximumError(maximumError);
+    m_Filter->Update();
+
+    itk::ImageRegionIteratorWithIndex< OutputImageType > exactIt(exact, m_Region);
+    itk::ImageRegionIteratorWithIndex< OutputImageType > approximateIt(m_Filter->GetOutput(), m_Region);
+    double largestError = 0.0;
+    for (; !exactIt.IsAtEnd(); ++exactIt, ++approximateIt)
+    {
+      largestError = std::max(largestError, std::abs(static_cast< double >( exactIt.Get() - approximateIt.Get() )));
+    }
+    return largestError;
+  }
+
+  OutputImageType::RegionType m_Region;
+  EigenImageType::Pointer     m_EigenImage;
+  FilterType::Pointer         m_Filter;
+  ParameterArrayType          m_Parameters;
+};
+}
+
+TEST_F(itkKrcahEigenToMeasureImageFilterUnitTest, LookupTableMatchesExactWithinMaximumError) {
+  EXPECT_FALSE(m_Filter->GetUseLookupTable());
+  const double maximumError = 1e-3;
+  double largestError = 0.0;
+  ASSERT_NO_THROW(largestError = this->ComputeLookupTableError(maximumError));
+  EXPECT_LE(largestError, maximumError + 1e-6);
+  EXPECT_GT(largestError, 0.0);
+}
+
+TEST_F(itkKrcahEigenToMeasureImageFilterUnitTest, LookupTableHandlesZeroParameters) {
+  /* With beta = 0 and l1 = 0, the argument of the tube factor is 0 * inf */
+  m_Parameters[1] = 0.0;
+  m_Filter->SetParameters(m_Parameters);
+  m_Filter->UseLookupTableOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+
+  itk::ImageRegionIteratorWithIndex< OutputImageType > it(m_Filter->GetOutput(), m_Region);
+  for (; !it.IsAtEnd(); ++it)
+  {
+    ASSERT_TRUE(std::isfinite(it.Get())) << "at " << it.GetIndex();
+    ASSERT_EQ(it.Get(), 0.0f) << "at " << it.GetIndex();
+  }
+}
@@ -265,3 +265,21 @@ TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestWithSpat
   EXPECT_DOUBLE_EQ(0.5, this->m_Parameters[1]);
   EXPECT_NEAR(75.0, this->m_Parameters[2], 1e-6); // 0.25 *  300
 }
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, CopyInputToOutputOffEstimatesOnly) {
+  EXPECT_TRUE(this->m_Filter->GetCopyInputToOutput());
+  this->m_Filter->SetInput(this->m_MaskingEigenImage);
+  this->m_Filter->SetMask(this->m_SpatialObject);
+  this->m_Filter->Update();
+  const typename TestFixture::ParameterArrayType copied = this->m_Filter->GetParameters();
+
+  this->m_Filter->CopyInputToOutputOff();
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  EXPECT_EQ(0u, this->m_Filter->GetOutput()->GetBufferedRegion().GetNumberOfPixels());
+
+  this->m_Parameters = this->m_Filter->GetParameters();
+  for (unsigned int i = 0; i < copied.GetSize(); ++i)
+  {
+    EXPECT_DOUBLE_EQ(copied[i], this->m_Parameters[i]);
+  }
+}
@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "gtest/gtest.h"
+#include "itkKrcahEigenToScalarParameterEstimationImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkCommand.h"
+#include "itkMath.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+class itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static constexpr unsigned int Dimension = 3;
+  using MaskPixelType       = unsigned char;
+  using MaskType            = itk::Image< MaskPixelType, Dimension >;
+  using EigenValueArrayType = itk::FixedArray< float, Dimension >;
+  using EigenImageType      = itk::Image< EigenValueArrayType, Dimension >;
+  using FilterType          = itk::KrcahEigenToScalarParameterEstimationImageFilter< EigenImageType, MaskType >;
+  using RegionType          = FilterType::InputRegionType;
+
+protected:
+  void SetUp() override
+  {
+    RegionType region;
+    region.SetSize(EigenImageType::SizeType{{23, 17, 31}});
+
+    /* Eigenvalues which vary from voxel to voxel and a spherical mask off center */
+    m_EigenImage = EigenImageType::New();
+    m_EigenImage->SetRegions(region);
+    m_EigenImage->Allocate();
+    m_Mask = MaskType::New();
+    m_Mask->SetRegions(region);
+    m_Mask->Allocate();
+
+    itk::ImageRegionIteratorWithIndex< EigenImageType > eigenIt(m_EigenImage, region);
+    itk::ImageRegionIteratorWithIndex< MaskType > maskIt(m_Mask, region);
+    for (; !eigenIt.IsAtEnd(); ++eigenIt, ++maskIt)
+    {
+      const EigenImageType::IndexType index = eigenIt.GetIndex();
+      EigenValueArrayType pixel;
+      pixel[0] = static_cast< float >( 0.1 * std::sin(0.7 * index[0] + 0.3 * index[2]) );
+      pixel[1] = static_cast< float >( std::cos(0.5 * index[1] - 0.2 * index[0]) );
+      pixel[2] = static_cast< float >( -2.0 + std::sin(0.11 * index[2] * index[1]) );
+      eigenIt.Set(pixel);
+
+      const double dx = index[0] - 14.0, dy = index[1] - 8.0, dz = index[2] - 20.0;
+      maskIt.Set( (dx * dx + dy * dy + dz * dz) < 49.0 ? 1 : 0 );
+    }
+  }
+
+  /* Average of the trace over the foreground, computed serially */
+  double ComputeAverageTrace(bool useMask, bool absolute) const
+  {
+    itk::ImageRegionConstIterator< EigenImageType > eigenIt(m_EigenImage, m_EigenImage->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator< MaskType > maskIt(m_Mask, m_Mask->GetLargestPossibleRegion());
+    double sum = 0.0;
+    itk::SizeValueType count = 0;
+    for (; !eigenIt.IsAtEnd(); ++eigenIt, ++maskIt)
+    {
+      if (useMask && maskIt.Get() == 0)
+      {
+        continue;
+      }
+      for (unsigned int i = 0; i < Dimension; ++i)
+      {
+        sum += absolute ? std::abs(eigenIt.Get()[i]) : eigenIt.Get()[i];
+      }
+      ++count;
+    }
+    return sum / count;
+  }
+
+  EigenImageType::Pointer m_EigenImage;
+  MaskType::Pointer       m_Mask;
+};
+}
+
+TEST_F(itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest, ParametersWithoutMask) {
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_EigenImage);
+  filter->SetNumberOfWorkUnits(4);
+  ASSERT_NO_THROW(filter->Update());
+
+  EXPECT_DOUBLE_EQ(filter->GetAlpha(), itk::Math::sqrt2 * 0.5);
+  EXPECT_DOUBLE_EQ(filter->GetBeta(), itk::Math::sqrt2 * 0.5);
+  EXPECT_NEAR(filter->GetGamma(), itk::Math::sqrt2 * 0.5 * this->ComputeAverageTrace(false, true), 1e-6);
+  EXPECT_EQ(filter->GetForegroundRegion(), m_EigenImage->GetLargestPossibleRegion());
+}
+
+TEST_F(itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest, ParametersWithMask) {
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_EigenImage);
+  filter->SetMaskImage(m_Mask);
+  filter->SetNumberOfWorkUnits(3);
+  ASSERT_NO_THROW(filter->Update());
+
+  EXPECT_NEAR(filter->GetGamma(), itk::Math::sqrt2 * 0.5 * this->ComputeAverageTrace(true, true), 1e-6);
+
+  /* The journal parameters use the signed trace */
+  filter->SetParameterSetToJournalArticle();
+  ASSERT_NO_THROW(filter->Update());
+  EXPECT_DOUBLE_EQ(filter->GetAlpha(), 0.5);
+  EXPECT_DOUBLE_EQ(filter->GetBeta(), 0.5);
+  EXPECT_NEAR(filter->GetGamma(), 0.25 * this->ComputeAverageTrace(true, false), 1e-6);
+}
+
+TEST_F(itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest, ResultDoesNotDependOnWorkUnits) {
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_EigenImage);
+  filter->SetMaskImage(m_Mask);
+  filter->SetNumberOfWorkUnits(1);
+  ASSERT_NO_THROW(filter->Update());
+  const double gamma = filter->GetGamma();
+
+  filter->SetNumberOfWorkUnits(7);
+  filter->Modified();
+  ASSERT_NO_THROW(filter->Update());
+  EXPECT_NEAR(filter->GetGamma(), gamma, 1e-9 * std::abs(gamma));
+}
+
+TEST_F(itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest, ForegroundRegionIsTheMaskBoundingBox) {
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_EigenImage);
+  filter->SetMaskImage(m_Mask);
+  ASSERT_NO_THROW(filter->Update());
+
+  /* The sphere of radius 7 about (14, 8, 20) reaches 6 voxels along every axis */
+  RegionType expected;
+  expected.SetIndex(RegionType::IndexType{{8, 2, 14}});
+  expected.SetSize(RegionType::SizeType{{13, 13, 13}});
+  EXPECT_EQ(filter->GetForegroundRegion(), expected);
+
+  /* Without a mask the foreground is the whole image */
+  FilterType::Pointer unmasked = FilterType::New();
+  unmasked->SetInput(m_EigenImage);
+  ASSERT_NO_THROW(unmasked->Update());
+  EXPECT_EQ(unmasked->GetForegroundRegion(), m_EigenImage->GetLargestPossibleRegion());
+}
+
+TEST_F(itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest, EmptyMaskKeepsDefaultGamma) {
+  m_Mask->FillBuffer(0);
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_EigenImage);
+  filter->SetMaskImage(m_Mask);
+  ASSERT_NO_THROW(filter->Update());
+
+  EXPECT_EQ(filter->GetForegroundRegion().GetNumberOfPixels(), 0u);
+  EXPECT_DOUBLE_EQ(filter->GetGamma(), itk::Math::sqrt2 * 0.5);
+}
+
+TEST_F(itkKrcahEigenToScalarParameterEstimationImageFilterUnitTest, ProgressIsReported) {
+  std::vector< float > progress;
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetClientData(&progress);
+  command->SetCallback([](itk::Object * caller, const itk::EventObject &, void * clientData) {
+    static_cast< std::vector< float > * >(clientData)->push_back(static_cast< itk::ProcessObject * >(caller)->GetProgress());
+  });
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_EigenImage);
+  filter->SetNumberOfWorkUnits(4);
+  filter->AddObserver(itk::ProgressEvent(), command);
+  ASSERT_NO_THROW(filter->Update());
+
+  ASSERT_GT(progress.size(), 2u);
+  unsigned int intermediateUpdates = 0;
+  for (unsigned int i = 1; i < progress.size(); ++i)
+  {
+    EXPECT_GE(progress[i], progress[i-1]);
+    intermediateUpdates += (progress[i] > 0.0f && progress[i] < 1.0f) ? 1 : 0;
+  }
+  EXPECT_GT(intermediateUpdates, 0u);
+  EXPECT_FLOAT_EQ(progress.back(), 1.0f);
+}
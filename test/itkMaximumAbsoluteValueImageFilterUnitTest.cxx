@@ -96,3 +96,43 @@ TEST(itkMaximumAbsoluteValueImageFilterUnitTest, TakesAbsMaxOfSimpleImages) {
     ++ot;
   }
 }
+
+TEST(itkMaximumAbsoluteValueImageFilterUnitTest, AbortsWithinAScanline) {
+  const unsigned int                                      Dimension = 2;
+  using PixelType                           = float;
+  using ImageType                           = itk::Image< PixelType, Dimension >;
+  using MaximumAbsoluteValueImageFilterType = itk::MaximumAbsoluteValueImageFilter<ImageType>;
+
+  ImageType::RegionType region;
+  region.SetSize(ImageType::SizeType{{64, 64}});
+
+  ImageType::Pointer image1 = ImageType::New();
+  image1->SetRegions(region);
+  image1->Allocate();
+  image1->FillBuffer(1.0);
+
+  ImageType::Pointer image2 = ImageType::New();
+  image2->SetRegions(region);
+  image2->Allocate();
+  image2->FillBuffer(-2.0);
+
+  MaximumAbsoluteValueImageFilterType::Pointer maxAbsFilter = MaximumAbsoluteValueImageFilterType::New();
+  maxAbsFilter->SetInput1(image1);
+  maxAbsFilter->SetInput2(image2);
+
+  /* Request an abort as soon as the filter starts */
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetCallback([](itk::Object * caller, const itk::EventObject &, void *) {
+    static_cast< itk::ProcessObject * >(caller)->AbortGenerateDataOn();
+  });
+  unsigned long tag = maxAbsFilter->AddObserver(itk::ProgressEvent(), command);
+  EXPECT_THROW(maxAbsFilter->Update(), itk::ProcessAborted);
+
+  /* The filter can run again afterwards */
+  maxAbsFilter->RemoveObserver(tag);
+  maxAbsFilter->Modified();
+  EXPECT_NO_THROW(maxAbsFilter->Update());
+  ImageType::IndexType index;
+  index.Fill(10);
+  EXPECT_EQ(maxAbsFilter->GetOutput()->GetPixel(index), -2.0);
+}
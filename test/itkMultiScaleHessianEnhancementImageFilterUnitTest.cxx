@@ -0,0 +1,961 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkMultiScaleHessianEnhancementImageFilter.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
+#include "itkKrcahPreprocessingImageToImageFilter.h"
+#include "itkTrabecularBonePhantomImageSource.h"
+#include "itkImage.h"
+#include "itkCommand.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMetaDataObject.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+class itkMultiScaleHessianEnhancementImageFilterUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using InputImageType      = itk::Image< short, DIMENSION >;
+  using OutputImageType     = itk::Image< float, DIMENSION >;
+  using FilterType          = itk::MultiScaleHessianEnhancementImageFilter< InputImageType, OutputImageType >;
+  using FilterPointerType   = FilterType::Pointer;
+  using EigenImageType      = FilterType::EigenValueImageType;
+  using MeasureType         = itk::KrcahEigenToMeasureImageFilter< EigenImageType, OutputImageType >;
+  using EstimationType      = itk::KrcahEigenToMeasureParameterEstimationFilter< EigenImageType >;
+  using PhantomSourceType   = itk::TrabecularBonePhantomImageSource< InputImageType >;
+  using ReportType          = FilterType::ExecutionReportType;
+
+  itkMultiScaleHessianEnhancementImageFilterUnitTest() {
+    /* Create a small phantom */
+    PhantomSourceType::Pointer phantom = PhantomSourceType::New();
+    InputImageType::SizeType size;
+    size.Fill(24);
+    phantom->SetSize(size);
+    phantom->SetTrabecularSpacing(6.0);
+    phantom->SetCorticalThickness(2.0);
+    phantom->SetSeed(11);
+    phantom->Update();
+    m_Input = phantom->GetOutput();
+
+    /* Instantiate filter */
+    m_Filter = FilterType::New();
+    m_Filter->SetInput(m_Input);
+    m_Filter->SetEigenToMeasureImageFilter(MeasureType::New());
+    m_Filter->SetEigenToMeasureParameterEstimationFilter(EstimationType::New());
+    m_Filter->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 2.0, 3));
+  }
+  ~itkMultiScaleHessianEnhancementImageFilterUnitTest() override {}
+
+protected:
+  void SetUp() override {}
+  void TearDown() override {}
+
+  /** Expect two images to be buffered over the same region with equal pixels */
+  static void ExpectEqual(const OutputImageType * expected, const OutputImageType * actual)
+  {
+    ASSERT_EQ(expected->GetBufferedRegion(), actual->GetBufferedRegion());
+    itk::ImageRegionConstIterator< OutputImageType > eIt(expected, expected->GetBufferedRegion());
+    itk::ImageRegionConstIterator< OutputImageType > aIt(actual, expected->GetBufferedRegion());
+    for (; !eIt.IsAtEnd(); ++eIt, ++aIt)
+    {
+      ASSERT_EQ(eIt.Get(), aIt.Get());
+    }
+  }
+
+  /** Sum of the absolute differences over the sum of the absolute reference, infinite for a zero reference */
+  static double RelativeDifference(const OutputImageType * reference, const OutputImageType * image)
+  {
+    double referenceSum = 0.0;
+    double differenceSum = 0.0;
+    itk::ImageRegionConstIterator< OutputImageType > rIt(reference, reference->GetBufferedRegion());
+    itk::ImageRegionConstIterator< OutputImageType > iIt(image, reference->GetBufferedRegion());
+    for (; !rIt.IsAtEnd(); ++rIt, ++iIt)
+    {
+      referenceSum += std::abs(rIt.Get());
+      differenceSum += std::abs(rIt.Get() - iIt.Get());
+    }
+    return ( referenceSum > 0.0 ) ? differenceSum / referenceSum : std::numeric_limits< double >::infinity();
+  }
+
+  InputImageType::Pointer m_Input;
+  FilterPointerType       m_Filter;
+};
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ExecutionReportIsEmptyBeforeUpdate) {
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetStageRecords().size(), 0u);
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetTotalWallTime(), 0.0);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ExecutionReportHasEveryStage) {
+  ASSERT_NO_THROW(m_Filter->Update());
+  const ReportType & report = m_Filter->GetExecutionReport();
+
+  /* Every stage runs for every sigma, except the maximum which runs between sigmas */
+  EXPECT_EQ(report.GetStageRecords().size(), 4u * 3u + 2u);
+  for (unsigned int stage = 0; stage < ReportType::NumberOfStages; ++stage)
+  {
+    const ReportType::StageRecord total = report.GetStageTotal(static_cast< ReportType::StageEnum >(stage));
+    EXPECT_GT(total.m_NumberOfExecutions, 0u) << ReportType::GetStageName(total.m_Stage);
+    EXPECT_GE(total.m_WallTime, 0.0) << ReportType::GetStageName(total.m_Stage);
+    EXPECT_GT(total.m_BytesAllocated, 0u) << ReportType::GetStageName(total.m_Stage);
+    EXPECT_GT(total.m_PeakBufferSize, 0u) << ReportType::GetStageName(total.m_Stage);
+  }
+
+  /* Records carry their sigma value */
+  for (const ReportType::StageRecord & record : report.GetStageRecords())
+  {
+    EXPECT_DOUBLE_EQ(record.m_Sigma, m_Filter->GetSigmaArray()[record.m_ScaleLevel]);
+  }
+
+  /* The measure output is one float per voxel */
+  const ReportType::StageRecord measure = report.GetStageTotal(ReportType::MeasureStage);
+  EXPECT_EQ(measure.m_PeakBufferSize, m_Input->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(float));
+  EXPECT_EQ(measure.m_NumberOfExecutions, 3u);
+
+  /* Exclusive stage times cannot exceed the total */
+  double sumOfWallTimes = 0.0;
+  for (const ReportType::StageRecord & record : report.GetStageRecords())
+  {
+    sumOfWallTimes += record.m_WallTime;
+  }
+  EXPECT_GT(report.GetTotalWallTime(), 0.0);
+  EXPECT_LE(sumOfWallTimes, report.GetTotalWallTime() * 1.0001);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ExecutionReportToJSON) {
+  ASSERT_NO_THROW(m_Filter->Update());
+  const std::string json = m_Filter->GetExecutionReport().ToJSON();
+  EXPECT_EQ(json.front(), '{');
+  EXPECT_EQ(json.back(), '}');
+  EXPECT_NE(json.find("\"TotalWallTime\""), std::string::npos);
+  EXPECT_NE(json.find("\"Stage\": \"Hessian\""), std::string::npos);
+  EXPECT_NE(json.find("\"Stage\": \"MaximumAbsoluteValue\""), std::string::npos);
+  EXPECT_NE(json.find("\"PeakBufferSize\""), std::string::npos);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ProgressIsMonotonicAndCoversAllStages) {
+  std::vector< float > progress;
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetClientData(&progress);
+  command->SetCallback([](itk::Object * caller, const itk::EventObject &, void * clientData) {
+    static_cast< std::vector< float > * >(clientData)->push_back(static_cast< itk::ProcessObject * >(caller)->GetProgress());
+  });
+  m_Filter->AddObserver(itk::ProgressEvent(), command);
+  ASSERT_NO_THROW(m_Filter->Update());
+
+  ASSERT_GT(progress.size(), 2u);
+  for (unsigned int i = 1; i < progress.size(); ++i)
+  {
+    EXPECT_GE(progress[i], progress[i-1]);
+  }
+  EXPECT_FLOAT_EQ(progress.back(), 1.0f);
+
+  /* The streamed Hessian and eigenvalue analysis are reported as they run */
+  unsigned int intermediateUpdates = 0;
+  for (float value : progress)
+  {
+    intermediateUpdates += (value > 0.0f && value < 1.0f) ? 1 : 0;
+  }
+  EXPECT_GE(intermediateUpdates, 10u * 3u);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, StageCostsAreCalibrated) {
+  EXPECT_TRUE(m_Filter->GetCalibrateStageCosts());
+  const FilterType::StageCostCoefficientsType initial = m_Filter->GetStageCostCoefficients();
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_NE(initial, m_Filter->GetCalibratedStageCostCoefficients());
+  EXPECT_EQ(initial, m_Filter->GetStageCostCoefficients());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, CalibrationKeepsUserStageCosts) {
+  /* Calibration is on, but never overwrites coefficients set by the user */
+  FilterType::StageCostCoefficientsType coefficients;
+  coefficients.Fill(2.0);
+  m_Filter->SetStageCostCoefficients(coefficients);
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(coefficients, m_Filter->GetStageCostCoefficients());
+
+  m_Filter->Modified();
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(coefficients, m_Filter->GetStageCostCoefficients());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, AbortStopsAndCanBeRestarted) {
+  /* Abort part way through the first sigma */
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetCallback([](itk::Object * caller, const itk::EventObject &, void *) {
+    itk::ProcessObject * filter = static_cast< itk::ProcessObject * >(caller);
+    if (filter->GetProgress() > 0.1f)
+    {
+      filter->AbortGenerateDataOn();
+    }
+  });
+  unsigned long tag = m_Filter->AddObserver(itk::ProgressEvent(), command);
+  EXPECT_THROW(m_Filter->Update(), itk::ProcessAborted);
+
+  /* No stage of a later sigma was started */
+  for (const ReportType::StageRecord & record : m_Filter->GetExecutionReport().GetStageRecords())
+  {
+    EXPECT_EQ(record.m_ScaleLevel, 0u);
+  }
+
+  /* The pipeline is left in a state where it can run again */
+  m_Filter->RemoveObserver(tag);
+  m_Filter->Modified();
+  EXPECT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(m_Filter->GetOutput()->GetBufferedRegion(), m_Input->GetLargestPossibleRegion());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, PipelinedScalesMatchSequentialScales) {
+  EXPECT_FALSE(m_Filter->GetPipelineScales());
+  m_Filter->Update();
+  OutputImageType::Pointer sequential = m_Filter->GetOutput();
+  sequential->DisconnectPipeline();
+
+  m_Filter->PipelineScalesOn();
+  m_Filter->Update();
+  OutputImageType::Pointer pipelined = m_Filter->GetOutput();
+  ASSERT_EQ(pipelined->GetBufferedRegion(), sequential->GetBufferedRegion());
+
+  itk::ImageRegionConstIterator< OutputImageType > sIt(sequential, sequential->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > pIt(pipelined, pipelined->GetBufferedRegion());
+  for (; !sIt.IsAtEnd(); ++sIt, ++pIt)
+  {
+    ASSERT_EQ(sIt.Get(), pIt.Get());
+  }
+
+  /* Every stage of every sigma is attributed to its own scale */
+  const ReportType & report = m_Filter->GetExecutionReport();
+  EXPECT_EQ(report.GetStageRecords().size(), 4u * 3u + 2u);
+  for (unsigned int stage = 0; stage < ReportType::NumberOfStages; ++stage)
+  {
+    EXPECT_GT(report.GetStageTotal(static_cast< ReportType::StageEnum >(stage)).m_NumberOfExecutions, 0u);
+  }
+  EXPECT_FLOAT_EQ(m_Filter->GetProgress(), 1.0f);
+
+  /* Switching back reconnects the sequential pipeline */
+  m_Filter->PipelineScalesOff();
+  m_Filter->Update();
+  itk::ImageRegionConstIterator< OutputImageType > rIt(m_Filter->GetOutput(), m_Filter->GetOutput()->GetBufferedRegion());
+  for (sIt.GoToBegin(); !sIt.IsAtEnd(); ++sIt, ++rIt)
+  {
+    ASSERT_EQ(sIt.Get(), rIt.Get());
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, HugePagesAndPrefaultMatchDefaultAllocation) {
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  /* Pool the small buffers of this test */
+  const itk::SizeValueType minimumBlockSize = itk::ImageBufferPool::GetMinimumBlockSize();
+  itk::ImageBufferPool::SetMinimumBlockSize(1024);
+  itk::ImageBufferPool::ResetStatistics();
+
+  m_Filter->UseHugePagesOn();
+  m_Filter->PrefaultBuffersOn();
+  m_Filter->Update();
+  EXPECT_GT(itk::ImageBufferPool::GetStatistics().m_NumberOfRequests, 0u);
+
+  /* The global policies are untouched and the pool does not keep blocks once no filter uses it */
+  EXPECT_FALSE(itk::ImageBufferPool::GetGlobalEnabled());
+  EXPECT_FALSE(itk::ImageBufferPool::GetGlobalHugePages());
+  EXPECT_FALSE(itk::ParallelFirstTouchAllocator::GetGlobalEnabled());
+  EXPECT_FALSE(itk::ImageBufferPool::GetEnabled(m_Filter.GetPointer()));
+  EXPECT_FALSE(itk::ParallelFirstTouchAllocator::GetEnabled(m_Filter.GetPointer()));
+  EXPECT_EQ(itk::ImageBufferPool::GetStatistics().m_BytesCached, 0u);
+  itk::ImageBufferPool::SetMinimumBlockSize(minimumBlockSize);
+  itk::ImageBufferPool::ReleaseCachedBlocks();
+
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > oIt(m_Filter->GetOutput(), m_Filter->GetOutput()->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++oIt)
+  {
+    ASSERT_EQ(rIt.Get(), oIt.Get());
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, LazyEigenImageMatchesMaterializedEigenImage) {
+  EXPECT_FALSE(m_Filter->GetLazyEigenImage());
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  m_Filter->LazyEigenImageOn();
+  m_Filter->Update();
+  OutputImageType::Pointer lazy = m_Filter->GetOutput();
+  ASSERT_EQ(lazy->GetBufferedRegion(), reference->GetBufferedRegion());
+
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > lIt(lazy, lazy->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++lIt)
+  {
+    ASSERT_EQ(rIt.Get(), lIt.Get());
+  }
+
+  /* The estimation no longer holds an eigenvalue image, and the Hessian runs once more per piece */
+  const ReportType & report = m_Filter->GetExecutionReport();
+  EXPECT_EQ(report.GetStageTotal(ReportType::ParameterEstimationStage).m_BytesAllocated, 0u);
+  EXPECT_GT(report.GetStageTotal(ReportType::HessianStage).m_NumberOfExecutions,
+            report.GetStageTotal(ReportType::ParameterEstimationStage).m_NumberOfExecutions);
+  EXPECT_FLOAT_EQ(m_Filter->GetProgress(), 1.0f);
+}
+
+TEST(itkMultiScaleHessianEnhancementExecutionReportUnitTest, NestedStagesAreExclusive) {
+  using ReportType = itk::MultiScaleHessianEnhancementExecutionReport;
+  ReportType report;
+  report.SetCurrentScale(0, 1.5);
+  report.BeginStage(ReportType::ParameterEstimationStage);
+  report.BeginStage(ReportType::HessianStage);
+  report.EndStage(ReportType::HessianStage, 100);
+  report.BeginStage(ReportType::HessianStage);
+  report.EndStage(ReportType::HessianStage, 300);
+  report.EndStage(ReportType::ParameterEstimationStage, 50);
+
+  ASSERT_EQ(report.GetStageRecords().size(), 2u);
+  const ReportType::StageRecord hessian = report.GetStageTotal(ReportType::HessianStage);
+  EXPECT_EQ(hessian.m_NumberOfExecutions, 2u);
+  EXPECT_EQ(hessian.m_BytesAllocated, 400u);
+  EXPECT_EQ(hessian.m_PeakBufferSize, 300u);
+  EXPECT_EQ(report.GetPeakBufferSize(), 300u);
+  EXPECT_DOUBLE_EQ(report.GetStageRecords()[0].m_Sigma, 1.5);
+  EXPECT_GE(report.GetStageTotal(ReportType::ParameterEstimationStage).m_WallTime, 0.0);
+
+  /* Unbalanced events are ignored */
+  report.EndStage(ReportType::MeasureStage, 10);
+  EXPECT_EQ(report.GetStageTotal(ReportType::MeasureStage).m_NumberOfExecutions, 0u);
+
+  report.Clear();
+  EXPECT_EQ(report.GetStageRecords().size(), 0u);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ComputeROIMatchesFullUpdate) {
+  /* The parameters come from the last update */
+  EXPECT_ANY_THROW(m_Filter->ComputeROI(m_Input->GetLargestPossibleRegion()));
+  ASSERT_NO_THROW(m_Filter->Update());
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+  for (unsigned int scaleLevel = 0; scaleLevel < 3; ++scaleLevel)
+  {
+    EXPECT_GT(m_Filter->GetScaleParameters(scaleLevel).GetSize(), 0u);
+  }
+  EXPECT_ANY_THROW(m_Filter->GetScaleParameters(3));
+
+  /* A region touching the border, partly outside the image */
+  OutputImageType::RegionType region;
+  region.SetIndex(0, 3);
+  region.SetIndex(1, 15);
+  region.SetIndex(2, 10);
+  region.SetSize(0, 5);
+  region.SetSize(1, 20);
+  region.SetSize(2, 4);
+  OutputImageType::RegionType cropped = region;
+  ASSERT_TRUE(cropped.Crop(m_Input->GetLargestPossibleRegion()));
+
+  const unsigned long modifiedTime = m_Filter->GetMTime();
+  OutputImageType::Pointer roi;
+  ASSERT_NO_THROW(roi = m_Filter->ComputeROI(region));
+  EXPECT_EQ(roi->GetBufferedRegion(), cropped);
+  EXPECT_EQ(m_Filter->GetMTime(), modifiedTime);
+
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, cropped);
+  itk::ImageRegionConstIterator< OutputImageType > oIt(roi, cropped);
+  for (; !rIt.IsAtEnd(); ++rIt, ++oIt)
+  {
+    ASSERT_NEAR(rIt.Get(), oIt.Get(), 1e-5f * (1.0f + std::abs(rIt.Get())));
+  }
+
+  /* Changing the sigma values invalidates the parameters */
+  m_Filter->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 2.5, 3));
+  EXPECT_ANY_THROW(m_Filter->ComputeROI(region));
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ComputeROIRejectsStaleParameters) {
+  OutputImageType::RegionType region;
+  region.SetIndex(0, 8);
+  region.SetIndex(1, 8);
+  region.SetIndex(2, 8);
+  region.SetSize(0, 4);
+  region.SetSize(1, 4);
+  region.SetSize(2, 4);
+  ASSERT_NO_THROW(m_Filter->Update());
+
+  /* Setting the parameters of the measure internally does not invalidate them */
+  EXPECT_NO_THROW(m_Filter->ComputeROI(region));
+  EXPECT_NO_THROW(m_Filter->ComputeROI(region));
+
+  /* Modifying the measure or the input does */
+  m_Filter->GetModifiableEigenToMeasureImageFilter()->Modified();
+  EXPECT_ANY_THROW(m_Filter->ComputeROI(region));
+  EXPECT_ANY_THROW(m_Filter->ComputeParameterFitError(0));
+  m_Filter->Modified();
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_NO_THROW(m_Filter->ComputeROI(region));
+  m_Input->Modified();
+  EXPECT_ANY_THROW(m_Filter->ComputeROI(region));
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, ComputeROIUsesExactHessian) {
+  /* Fix the parameters so only the Hessian method can change the response */
+  ASSERT_NO_THROW(m_Filter->Update());
+  FilterType::ScaleParametersType parameters;
+  for (unsigned int scaleLevel = 0; scaleLevel < 3; ++scaleLevel)
+  {
+    parameters.push_back(m_Filter->GetScaleParameters(scaleLevel));
+  }
+  m_Filter->SetFixedParameters(parameters);
+  ASSERT_NO_THROW(m_Filter->Update());
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  /* The incremental scale space would smooth the whole input */
+  m_Filter->SetIncrementalScaleSpace(true);
+  OutputImageType::RegionType region;
+  region.SetIndex(0, 2);
+  region.SetIndex(1, 10);
+  region.SetIndex(2, 5);
+  region.SetSize(0, 6);
+  region.SetSize(1, 3);
+  region.SetSize(2, 7);
+  OutputImageType::Pointer roi;
+  ASSERT_NO_THROW(roi = m_Filter->ComputeROI(region));
+  EXPECT_EQ(roi->GetBufferedRegion(), region);
+
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, region);
+  itk::ImageRegionConstIterator< OutputImageType > oIt(roi, region);
+  for (; !rIt.IsAtEnd(); ++rIt, ++oIt)
+  {
+    ASSERT_NEAR(rIt.Get(), oIt.Get(), 1e-5f * (1.0f + std::abs(rIt.Get())));
+  }
+
+  /* The sliding slab would fall back to central differences for a region smaller than a plane */
+  m_Filter->SetIncrementalScaleSpace(false);
+  m_Filter->SetSlabThickness(4);
+  ASSERT_NO_THROW(roi = m_Filter->ComputeROI(region));
+  EXPECT_EQ(roi->GetBufferedRegion(), region);
+  itk::ImageRegionConstIterator< OutputImageType > sIt(roi, region);
+  for (rIt.GoToBegin(); !rIt.IsAtEnd(); ++rIt, ++sIt)
+  {
+    ASSERT_NEAR(rIt.Get(), sIt.Get(), 1e-5f * (1.0f + std::abs(rIt.Get())));
+  }
+
+  /* The slabbed update still covers the whole output after the region was computed */
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(m_Filter->GetOutput()->GetBufferedRegion(), m_Input->GetLargestPossibleRegion());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, FixedParametersBypassEstimation) {
+  ASSERT_NO_THROW(m_Filter->Update());
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+  FilterType::ScaleParametersType parameters;
+  for (unsigned int scaleLevel = 0; scaleLevel < 3; ++scaleLevel)
+  {
+    parameters.push_back(m_Filter->GetScaleParameters(scaleLevel));
+  }
+
+  /* No estimation filter is needed */
+  FilterPointerType filter = FilterType::New();
+  filter->SetInput(m_Input);
+  filter->SetEigenToMeasureImageFilter(MeasureType::New());
+  filter->SetSigmaArray(m_Filter->GetSigmaArray());
+  EXPECT_FALSE(filter->GetUseFixedParameters());
+  EXPECT_ANY_THROW(filter->Update());
+
+  /* The number of entries must match */
+  filter->SetFixedParameters(FilterType::ScaleParametersType(2, parameters[0]));
+  EXPECT_TRUE(filter->GetUseFixedParameters());
+  EXPECT_ANY_THROW(filter->Update());
+
+  filter->SetFixedParameters(parameters);
+  ASSERT_NO_THROW(filter->Update());
+  OutputImageType::Pointer output = filter->GetOutput();
+  ASSERT_EQ(output->GetBufferedRegion(), reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > oIt(output, output->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++oIt)
+  {
+    ASSERT_EQ(rIt.Get(), oIt.Get());
+  }
+
+  const ReportType & report = filter->GetExecutionReport();
+  EXPECT_EQ(report.GetStageTotal(ReportType::ParameterEstimationStage).m_NumberOfExecutions, 0u);
+  EXPECT_EQ(report.GetStageTotal(ReportType::HessianStage).m_NumberOfExecutions, 3u);
+  EXPECT_FLOAT_EQ(filter->GetProgress(), 1.0f);
+
+  /* One entry is used at every sigma value, also by ComputeROI without an update */
+  FilterPointerType preview = FilterType::New();
+  preview->SetInput(m_Input);
+  preview->SetEigenToMeasureImageFilter(MeasureType::New());
+  preview->SetSigmaArray(m_Filter->GetSigmaArray());
+  preview->SetFixedParameters(parameters[1]);
+  EXPECT_EQ(preview->GetFixedParameters().size(), 1u);
+  EXPECT_NO_THROW(preview->ComputeROI(m_Input->GetLargestPossibleRegion()));
+  preview->ClearFixedParameters();
+  EXPECT_FALSE(preview->GetUseFixedParameters());
+  EXPECT_ANY_THROW(preview->ComputeROI(m_Input->GetLargestPossibleRegion()));
+}
+
+TEST(itkMultiScaleHessianEnhancementImageFilterFitUnitTest, FitScaleParameters) {
+  using FilterType = itk::MultiScaleHessianEnhancementImageFilter< itk::Image< short, 3 >, itk::Image< float, 3 > >;
+  const std::vector< FilterType::SigmaType > anchorSigmas{4.0, 1.0};
+  FilterType::ScaleParametersType anchorParameters;
+  for (FilterType::SigmaType sigma : anchorSigmas)
+  {
+    FilterType::MeasureParameterArrayType parameters(3);
+    parameters[0] = 0.5;
+    parameters[1] = 3.0 / std::sqrt(sigma);
+    parameters[2] = -std::log(sigma);
+    anchorParameters.push_back(parameters);
+  }
+
+  /* Constants and power laws are reproduced, other parameters are interpolated in log(sigma) */
+  const FilterType::MeasureParameterArrayType fitted = FilterType::FitScaleParameters(anchorSigmas, anchorParameters, 2.0);
+  ASSERT_EQ(fitted.GetSize(), 3u);
+  EXPECT_NEAR(fitted[0], 0.5, 1e-6);
+  EXPECT_NEAR(fitted[1], 3.0 / std::sqrt(2.0), 1e-6);
+  EXPECT_NEAR(fitted[2], -std::log(2.0), 1e-6);
+
+  /* Held constant beyond the anchors */
+  EXPECT_NEAR(FilterType::FitScaleParameters(anchorSigmas, anchorParameters, 8.0)[2], -std::log(4.0), 1e-6);
+  EXPECT_NEAR(FilterType::FitScaleParameters(anchorSigmas, anchorParameters, 0.5)[2], 0.0, 1e-6);
+
+  EXPECT_ANY_THROW(FilterType::FitScaleParameters(std::vector< FilterType::SigmaType >(), FilterType::ScaleParametersType(), 2.0));
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, AnchorScalesEstimateFewerScales) {
+  m_Filter->SetSigmaArray(FilterType::GenerateLogarithmicSigmaArray(1.0, 2.0, 4));
+  EXPECT_EQ(m_Filter->GetNumberOfAnchorScales(), 0u);
+  m_Filter->SetNumberOfAnchorScales(2);
+  ASSERT_NO_THROW(m_Filter->Update());
+
+  const std::vector< FilterType::SigmaStepsType > anchors{0, 3};
+  EXPECT_EQ(m_Filter->GetAnchorScaleLevels(), anchors);
+  const ReportType & report = m_Filter->GetExecutionReport();
+  EXPECT_EQ(report.GetStageTotal(ReportType::ParameterEstimationStage).m_NumberOfExecutions, 2u);
+  EXPECT_EQ(report.GetStageTotal(ReportType::MeasureStage).m_NumberOfExecutions, 4u);
+  EXPECT_FLOAT_EQ(m_Filter->GetProgress(), 1.0f);
+
+  /* Anchors are estimated exactly */
+  EXPECT_NEAR(m_Filter->ComputeParameterFitError(0), 0.0, 1e-6);
+  EXPECT_NEAR(m_Filter->ComputeParameterFitError(3), 0.0, 1e-6);
+
+  /* The fit is within a few percent, and closer than the nearest anchor */
+  const FilterType::MeasureParameterArrayType & first = m_Filter->GetScaleParameters(0);
+  const FilterType::MeasureParameterArrayType & last = m_Filter->GetScaleParameters(3);
+  double anchorSpread = 0.0;
+  for (unsigned int j = 0; j < first.GetSize(); ++j)
+  {
+    if (first[j] != 0)
+    {
+      anchorSpread = std::max(anchorSpread, std::abs(static_cast< double >( last[j] - first[j] ) / first[j]));
+    }
+  }
+  ASSERT_GT(anchorSpread, 0.0);
+  for (FilterType::SigmaStepsType scaleLevel : {1u, 2u})
+  {
+    const double error = m_Filter->ComputeParameterFitError(scaleLevel);
+    EXPECT_GE(error, 0.0);
+    EXPECT_LT(error, 0.05);
+    EXPECT_LT(error, anchorSpread);
+  }
+  EXPECT_ANY_THROW(m_Filter->ComputeParameterFitError(4));
+
+  /* Computing the errors leaves the internal pipeline as the update left it */
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+  m_Filter->Modified();
+  ASSERT_NO_THROW(m_Filter->Update());
+  ExpectEqual(reference, m_Filter->GetOutput());
+
+  /* As many anchors as scales estimates every scale */
+  m_Filter->SetNumberOfAnchorScales(4);
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_TRUE(m_Filter->GetAnchorScaleLevels().empty());
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetStageTotal(ReportType::ParameterEstimationStage).m_NumberOfExecutions, 4u);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, QuantizedOutputMatchesResponse) {
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  EXPECT_FALSE(m_Filter->GetQuantizeOutput());
+  m_Filter->QuantizeOutputOn();
+  m_Filter->SetQuantizationMinimum(-1.0);
+  m_Filter->SetQuantizationMaximum(1.0);
+  ASSERT_NO_THROW(m_Filter->Update());
+
+  /* The float output is unchanged and the maximum over scales is still reported */
+  const ReportType & report = m_Filter->GetExecutionReport();
+  EXPECT_EQ(report.GetStageTotal(ReportType::MaximumAbsoluteValueStage).m_NumberOfExecutions, 2u);
+  itk::ImageRegionConstIterator< OutputImageType > rIt(reference, reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< OutputImageType > oIt(m_Filter->GetOutput(), reference->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++oIt)
+  {
+    ASSERT_EQ(rIt.Get(), oIt.Get());
+  }
+
+  /* The quantized values convert back within half a step */
+  using QuantizedImageType = FilterType::QuantizedImageType;
+  QuantizedImageType * quantized = m_Filter->GetQuantizedOutput();
+  ASSERT_EQ(quantized->GetBufferedRegion(), reference->GetBufferedRegion());
+  double scale = 0.0;
+  double offset = 0.0;
+  ASSERT_TRUE(itk::ExposeMetaData< double >(quantized->GetMetaDataDictionary(), FilterType::GetQuantizationScaleKey(), scale));
+  ASSERT_TRUE(itk::ExposeMetaData< double >(quantized->GetMetaDataDictionary(), FilterType::GetQuantizationOffsetKey(), offset));
+  EXPECT_DOUBLE_EQ(scale, m_Filter->GetQuantizationScale());
+  EXPECT_DOUBLE_EQ(offset, m_Filter->GetQuantizationOffset());
+  EXPECT_NEAR(scale * itk::NumericTraits< short >::max() + offset, 1.0, 1e-9);
+  EXPECT_NEAR(scale * itk::NumericTraits< short >::NonpositiveMin() + offset, -1.0, 1e-9);
+  itk::ImageRegionConstIterator< QuantizedImageType > qIt(quantized, quantized->GetBufferedRegion());
+  for (rIt.GoToBegin(); !rIt.IsAtEnd(); ++rIt, ++qIt)
+  {
+    ASSERT_NEAR(scale * qIt.Get() + offset, rIt.Get(), 0.5 * scale + 1e-6);
+  }
+
+  /* Pipelined scales quantize the last merge as well */
+  m_Filter->PipelineScalesOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+  itk::ImageRegionConstIterator< QuantizedImageType > pIt(m_Filter->GetQuantizedOutput(), quantized->GetBufferedRegion());
+  for (rIt.GoToBegin(); !rIt.IsAtEnd(); ++rIt, ++pIt)
+  {
+    ASSERT_NEAR(scale * pIt.Get() + offset, rIt.Get(), 0.5 * scale + 1e-6);
+  }
+
+  m_Filter->SetQuantizationMaximum(-1.0);
+  EXPECT_ANY_THROW(m_Filter->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, QuantizedOutputIsOptional) {
+  EXPECT_EQ(m_Filter->GetNumberOfRequiredOutputs(), 1u);
+  std::vector< float > progress;
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetClientData(&progress);
+  command->SetCallback([](itk::Object * caller, const itk::EventObject &, void * clientData) {
+    static_cast< std::vector< float > * >(clientData)->push_back(static_cast< itk::ProcessObject * >(caller)->GetProgress());
+  });
+  m_Filter->AddObserver(itk::ProgressEvent(), command);
+
+  /* The merge of the last scale reports its progress, so the stages add up to the whole update */
+  m_Filter->QuantizeOutputOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+  ASSERT_GT(progress.size(), 2u);
+  EXPECT_GT(progress[progress.size() - 2], 0.999f);
+  EXPECT_EQ(m_Filter->GetQuantizedOutput()->GetBufferedRegion(), m_Input->GetLargestPossibleRegion());
+
+  /* Without quantization the output is released instead of keeping the last quantized response */
+  m_Filter->QuantizeOutputOff();
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(m_Filter->GetQuantizedOutput()->GetBufferedRegion().GetNumberOfPixels(), 0u);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, QuantizedOutputClampsTo8Bits) {
+  using Filter8Type = itk::MultiScaleHessianEnhancementImageFilter< InputImageType, OutputImageType, itk::Image< signed char, DIMENSION > >;
+  Filter8Type::Pointer filter = Filter8Type::New();
+  filter->SetInput(m_Input);
+  filter->SetEigenToMeasureImageFilter(MeasureType::New());
+  filter->SetEigenToMeasureParameterEstimationFilter(EstimationType::New());
+  filter->SetSigmaArray(Filter8Type::GenerateEquispacedSigmaArray(1.0, 1.0, 1));
+  filter->QuantizeOutputOn();
+  filter->SetQuantizationMinimum(-0.1);
+  filter->SetQuantizationMaximum(0.1);
+  ASSERT_NO_THROW(filter->Update());
+
+  const double scale = filter->GetQuantizationScale();
+  const double offset = filter->GetQuantizationOffset();
+  itk::ImageRegionConstIterator< OutputImageType > rIt(filter->GetOutput(), filter->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator< Filter8Type::QuantizedImageType > qIt(filter->GetQuantizedOutput(), filter->GetOutput()->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++qIt)
+  {
+    const double clamped = std::min(std::max(static_cast< double >( rIt.Get() ), -0.1), 0.1);
+    ASSERT_NEAR(scale * qIt.Get() + offset, clamped, 0.5 * scale + 1e-6);
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, IncrementalScaleSpaceCloseToExact) {
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  EXPECT_FALSE(m_Filter->GetIncrementalScaleSpace());
+  m_Filter->IncrementalScaleSpaceOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetStageTotal(ReportType::MeasureStage).m_NumberOfExecutions, 3u);
+  EXPECT_FLOAT_EQ(m_Filter->GetProgress(), 1.0f);
+  OutputImageType::Pointer incremental = m_Filter->GetOutput();
+  incremental->DisconnectPipeline();
+
+  /* Central differences of the smoothed input differ slightly from the derivative kernels */
+  EXPECT_LT(RelativeDifference(reference, incremental), 0.1);
+
+  /* The pipelined scales smooth incrementally as well */
+  m_Filter->PipelineScalesOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+  ExpectEqual(incremental, m_Filter->GetOutput());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, SlabStreamingCloseToExact) {
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  EstimationType * estimation = dynamic_cast< EstimationType * >( m_Filter->GetEigenToMeasureParameterEstimationFilter() );
+  ASSERT_NE(estimation, nullptr);
+  const unsigned int streamDivisions = estimation->GetNumberOfStreamDivisions();
+
+  EXPECT_EQ(m_Filter->GetSlabThickness(), 0u);
+  m_Filter->SetSlabThickness(4);
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(estimation->GetNumberOfStreamDivisions(), streamDivisions);
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetStageTotal(ReportType::ParameterEstimationStage).m_NumberOfExecutions, 3u);
+  EXPECT_FLOAT_EQ(m_Filter->GetProgress(), 1.0f);
+
+  /* Central differences of the smoothed input differ slightly from the derivative kernels */
+  EXPECT_LT(RelativeDifference(reference, m_Filter->GetOutput()), 0.1);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, SlabStreamingPullsSlabsOfTheInput) {
+  m_Filter->SetSlabThickness(4);
+  m_Filter->SkipFlatBlocksOn();
+  m_Filter->QuantizeOutputOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+  using QuantizedImageType = FilterType::QuantizedImageType;
+  std::vector< QuantizedImageType::PixelType > quantizedReference;
+  itk::ImageRegionConstIterator< QuantizedImageType > qIt(m_Filter->GetQuantizedOutput(), reference->GetBufferedRegion());
+  for (; !qIt.IsAtEnd(); ++qIt)
+  {
+    quantizedReference.push_back(qIt.Get());
+  }
+
+  /* The slabs give the same response whatever their thickness */
+  m_Filter->SetSlabThickness(7);
+  ASSERT_NO_THROW(m_Filter->Update());
+  ExpectEqual(reference, m_Filter->GetOutput());
+
+  /* The phantom only produces the region requested from it */
+  PhantomSourceType::Pointer phantom = PhantomSourceType::New();
+  InputImageType::SizeType size;
+  size.Fill(24);
+  phantom->SetSize(size);
+  phantom->SetTrabecularSpacing(6.0);
+  phantom->SetCorticalThickness(2.0);
+  phantom->SetSeed(11);
+  m_Filter->SetInput(phantom->GetOutput());
+  m_Filter->SetSlabThickness(4);
+
+  /* Record the largest piece of the input and of the measure */
+  itk::SizeValueType largestPieces[2] = {0, 0};
+  auto recordPiece = [](itk::Object * caller, const itk::EventObject &, void * clientData) {
+    itk::SizeValueType & largest = *static_cast< itk::SizeValueType * >(clientData);
+    const itk::ImageBase< DIMENSION > * output =
+      dynamic_cast< const itk::ImageBase< DIMENSION > * >( static_cast< itk::ProcessObject * >(caller)->GetOutput(0) );
+    largest = std::max(largest, output->GetBufferedRegion().GetNumberOfPixels());
+  };
+  itk::CStyleCommand::Pointer inputCommand = itk::CStyleCommand::New();
+  inputCommand->SetClientData(&largestPieces[0]);
+  inputCommand->SetCallback(recordPiece);
+  phantom->AddObserver(itk::EndEvent(), inputCommand);
+  itk::CStyleCommand::Pointer measureCommand = itk::CStyleCommand::New();
+  measureCommand->SetClientData(&largestPieces[1]);
+  measureCommand->SetCallback(recordPiece);
+  m_Filter->GetEigenToMeasureImageFilter()->AddObserver(itk::EndEvent(), measureCommand);
+
+  ASSERT_NO_THROW(m_Filter->Update());
+  ExpectEqual(reference, m_Filter->GetOutput());
+  ASSERT_EQ(m_Filter->GetQuantizedOutput()->GetBufferedRegion(), reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< QuantizedImageType > aIt(m_Filter->GetQuantizedOutput(), reference->GetBufferedRegion());
+  for (const QuantizedImageType::PixelType expected : quantizedReference)
+  {
+    ASSERT_EQ(aIt.Get(), expected);
+    ++aIt;
+  }
+
+  /* Neither the input nor the response of a scale was produced over the whole volume */
+  const itk::SizeValueType planePixels = 24u * 24u;
+  EXPECT_GT(largestPieces[0], 0u);
+  EXPECT_LT(largestPieces[0], 24u * planePixels);
+  EXPECT_LE(largestPieces[1], 4u * planePixels);
+  EXPECT_LT(phantom->GetOutput()->GetBufferedRegion().GetNumberOfPixels(), 24u * planePixels);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, PreprocessingFilterMatchesPreprocessedInput) {
+  using PreprocessingType = itk::KrcahPreprocessingImageToImageFilter< InputImageType >;
+  PreprocessingType::Pointer preprocessing = PreprocessingType::New();
+  preprocessing->SetInput(m_Input);
+  preprocessing->Update();
+  InputImageType::Pointer preprocessed = preprocessing->GetOutput();
+  preprocessed->DisconnectPipeline();
+
+  m_Filter->SetSlabThickness(4);
+  m_Filter->SetInput(preprocessed);
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  /* Record the largest piece preprocessed on the fly */
+  EXPECT_EQ(m_Filter->GetPreprocessingFilter(), nullptr);
+  m_Filter->SetInput(m_Input);
+  m_Filter->SetPreprocessingFilter(PreprocessingType::New());
+  itk::SizeValueType largestPiece = 0;
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetClientData(&largestPiece);
+  command->SetCallback([](itk::Object * caller, const itk::EventObject &, void * clientData) {
+    itk::SizeValueType & largest = *static_cast< itk::SizeValueType * >(clientData);
+    const itk::SizeValueType pixels = static_cast< PreprocessingType * >(caller)->GetOutput()->GetBufferedRegion().GetNumberOfPixels();
+    largest = std::max(largest, pixels);
+  });
+  m_Filter->GetPreprocessingFilter()->AddObserver(itk::EndEvent(), command);
+  ASSERT_NO_THROW(m_Filter->Update());
+  ExpectEqual(reference, m_Filter->GetOutput());
+
+  /* Only pieces with a halo were preprocessed, and nothing is kept after the update */
+  EXPECT_GT(largestPiece, 0u);
+  EXPECT_LT(largestPiece, m_Input->GetLargestPossibleRegion().GetNumberOfPixels());
+  EXPECT_EQ(m_Filter->GetPreprocessingFilter()->GetOutput()->GetPixelContainer()->Size(), 0u);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, SkipFlatBlocksCloseToExact) {
+  /* The phantom below a constant region, which is flat far enough from the phantom */
+  InputImageType::RegionType region;
+  region.SetSize(InputImageType::SizeType{{24, 24, 64}});
+  InputImageType::Pointer input = InputImageType::New();
+  input->SetRegions(region);
+  input->Allocate();
+  input->FillBuffer(0);
+  itk::ImageRegionConstIterator< InputImageType > phantomIt(m_Input, m_Input->GetLargestPossibleRegion());
+  for (; !phantomIt.IsAtEnd(); ++phantomIt)
+  {
+    input->SetPixel(phantomIt.GetIndex(), phantomIt.Get());
+  }
+
+  m_Filter->SetInput(input);
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetFlatBlockRecords().size(), 0u);
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetFlatPixelFraction(), 0.0);
+
+  EXPECT_FALSE(m_Filter->GetSkipFlatBlocks());
+  m_Filter->SkipFlatBlocksOn();
+  m_Filter->SetFlatBlockSize(FilterType::FlatBlockSizeType{{8, 8, 8}});
+  m_Filter->SetFlatBlockThreshold(1.0);
+  ASSERT_NO_THROW(m_Filter->Update());
+  OutputImageType::Pointer skipped = m_Filter->GetOutput();
+  skipped->DisconnectPipeline();
+
+  /* Blocks were skipped at every scale and reported */
+  const ReportType & report = m_Filter->GetExecutionReport();
+  ASSERT_EQ(report.GetFlatBlockRecords().size(), 3u);
+  for (const ReportType::FlatBlockRecord & record : report.GetFlatBlockRecords())
+  {
+    EXPECT_DOUBLE_EQ(record.m_Sigma, m_Filter->GetSigmaArray()[record.m_ScaleLevel]);
+    EXPECT_EQ(record.m_NumberOfBlocks, 3u * 3u * 8u);
+    EXPECT_GT(record.m_NumberOfFlatBlocks, 0u);
+    EXPECT_LT(record.m_NumberOfFlatBlocks, record.m_NumberOfBlocks);
+    EXPECT_EQ(record.m_NumberOfPixels, region.GetNumberOfPixels());
+  }
+  EXPECT_GT(report.GetFlatPixelFraction(), 0.0);
+  EXPECT_LT(report.GetFlatPixelFraction(), 1.0);
+  EXPECT_NE(report.ToJSON().find("\"FlatBlocks\": [{"), std::string::npos);
+
+  /* The blocks far from the phantom are zero and the rest is close to the exact response */
+  itk::ImageRegionConstIterator< OutputImageType > sIt(skipped, region);
+  for (; !sIt.IsAtEnd(); ++sIt)
+  {
+    if (sIt.GetIndex()[2] >= 48)
+    {
+      ASSERT_EQ(sIt.Get(), 0.0f);
+    }
+  }
+  EXPECT_LT(RelativeDifference(reference, skipped), 0.01);
+
+  /* The pipelined scales skip the same blocks */
+  m_Filter->PipelineScalesOn();
+  ASSERT_NO_THROW(m_Filter->Update());
+  ExpectEqual(skipped, m_Filter->GetOutput());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, FlatBlockThresholdDoesNotGrowWithSigma) {
+  /* A faint plate whose range is above the threshold, but below the threshold scaled by sigma^(3/2) */
+  InputImageType::RegionType region;
+  region.SetSize(InputImageType::SizeType{{24, 24, 48}});
+  InputImageType::Pointer input = InputImageType::New();
+  input->SetRegions(region);
+  input->Allocate();
+  input->FillBuffer(0);
+  itk::ImageRegionIterator< InputImageType > inputIt(input, region);
+  for (; !inputIt.IsAtEnd(); ++inputIt)
+  {
+    if (inputIt.GetIndex()[2] >= 20 && inputIt.GetIndex()[2] < 28)
+    {
+      inputIt.Set(10);
+    }
+  }
+
+  m_Filter->SetInput(input);
+  m_Filter->SetSigmaArray(FilterType::SigmaArrayType(1, 4.0));
+  m_Filter->Update();
+  OutputImageType::Pointer reference = m_Filter->GetOutput();
+  reference->DisconnectPipeline();
+  ASSERT_NE(reference->GetPixel({{12, 12, 24}}), 0.0f);
+
+  m_Filter->SkipFlatBlocksOn();
+  m_Filter->SetFlatBlockSize(FilterType::FlatBlockSizeType{{8, 8, 8}});
+  m_Filter->SetFlatBlockThreshold(4.0);
+  ASSERT_NO_THROW(m_Filter->Update());
+  const ReportType & report = m_Filter->GetExecutionReport();
+  ASSERT_EQ(report.GetFlatBlockRecords().size(), 1u);
+  EXPECT_LT(report.GetFlatBlockRecords()[0].m_NumberOfFlatBlocks, report.GetFlatBlockRecords()[0].m_NumberOfBlocks);
+
+  /* The blocks near the plate are computed, so the plate is not zeroed */
+  EXPECT_NE(m_Filter->GetOutput()->GetPixel({{12, 12, 24}}), 0.0f);
+  EXPECT_LT(RelativeDifference(reference, m_Filter->GetOutput()), 0.01);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, SkipFlatBlocksRejectsPreprocessingFilter) {
+  /* The ranges of the input do not bound the preprocessed image, so flat blocks could be wrong */
+  using PreprocessingType = itk::KrcahPreprocessingImageToImageFilter< InputImageType >;
+  m_Filter->SkipFlatBlocksOn();
+  m_Filter->SetPreprocessingFilter(PreprocessingType::New());
+  EXPECT_ANY_THROW(m_Filter->Update());
+
+  /* Preprocessing the input beforehand skips the flat blocks of the preprocessed image */
+  PreprocessingType::Pointer preprocessing = PreprocessingType::New();
+  preprocessing->SetInput(m_Input);
+  ASSERT_NO_THROW(preprocessing->Update());
+  m_Filter->SetPreprocessingFilter(nullptr);
+  m_Filter->SetInput(preprocessing->GetOutput());
+  ASSERT_NO_THROW(m_Filter->Update());
+  EXPECT_EQ(m_Filter->GetExecutionReport().GetFlatBlockRecords().size(), 3u);
+  EXPECT_EQ(m_Filter->GetOutput()->GetBufferedRegion(), m_Input->GetLargestPossibleRegion());
+}
@@ -0,0 +1,70 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "gtest/gtest.h"
+#include "itkNegativeExponentialLookupTable.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+TEST(itkNegativeExponentialLookupTableUnitTest, DefaultErrorIsSmallTable) {
+  itk::NegativeExponentialLookupTable table;
+  EXPECT_DOUBLE_EQ(table.GetMaximumError(), 1e-3);
+  EXPECT_GT(table.GetSize(), 2u);
+  EXPECT_LT(table.GetSize(), 128u);
+}
+
+TEST(itkNegativeExponentialLookupTableUnitTest, ErrorIsWithinMaximumError) {
+  for (double maximumError : {1e-2, 1e-3, 1e-5})
+  {
+    itk::NegativeExponentialLookupTable table;
+    table.SetMaximumError(maximumError);
+    EXPECT_DOUBLE_EQ(table.GetMaximumError(), maximumError);
+
+    double largestError = 0.0;
+    for (double t = 0.0; t < 30.0; t += 1e-3)
+    {
+      largestError = std::max(largestError, std::abs(table.Evaluate(t) - std::exp(-t)));
+    }
+    EXPECT_LE(largestError, maximumError) << "maximum error " << maximumError;
+  }
+}
+
+TEST(itkNegativeExponentialLookupTableUnitTest, IsExactAtZeroAndZeroPastCutoff) {
+  itk::NegativeExponentialLookupTable table;
+  EXPECT_DOUBLE_EQ(table.Evaluate(0.0), 1.0);
+  EXPECT_DOUBLE_EQ(table.Evaluate(100.0), 0.0);
+  EXPECT_DOUBLE_EQ(table.Evaluate(std::numeric_limits< double >::infinity()), 0.0);
+}
+
+TEST(itkNegativeExponentialLookupTableUnitTest, ArgumentsOutsideTheTable) {
+  itk::NegativeExponentialLookupTable table;
+  EXPECT_DOUBLE_EQ(table.Evaluate(std::numeric_limits< double >::quiet_NaN()), 0.0);
+  EXPECT_DOUBLE_EQ(table.Evaluate(0.0 * std::numeric_limits< double >::infinity()), 0.0);
+  EXPECT_DOUBLE_EQ(table.Evaluate(-1.0), std::exp(1.0));
+  EXPECT_DOUBLE_EQ(table.Evaluate(-0.0), 1.0);
+}
+
+TEST(itkNegativeExponentialLookupTableUnitTest, InvalidErrorIsIgnored) {
+  itk::NegativeExponentialLookupTable table;
+  const itk::SizeValueType size = table.GetSize();
+  table.SetMaximumError(0.0);
+  table.SetMaximumError(-1.0);
+  EXPECT_DOUBLE_EQ(table.GetMaximumError(), 1e-3);
+  EXPECT_EQ(table.GetSize(), size);
+}
@@ -0,0 +1,111 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkParallelFirstTouchAllocator.h"
+#include "itkHessianGaussianImageFilter.h"
+#include "itkTrabecularBonePhantomImageSource.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImage.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+class itkParallelFirstTouchAllocatorUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using InputImageType    = itk::Image< short, DIMENSION >;
+  using HessianFilterType = itk::HessianGaussianImageFilter< InputImageType >;
+  using HessianImageType  = HessianFilterType::OutputImageType;
+  using PhantomSourceType = itk::TrabecularBonePhantomImageSource< InputImageType >;
+
+protected:
+  void SetUp() override {
+    m_WasEnabled = itk::ParallelFirstTouchAllocator::GetGlobalEnabled();
+  }
+  void TearDown() override {
+    itk::ParallelFirstTouchAllocator::SetGlobalEnabled(m_WasEnabled);
+  }
+
+  bool m_WasEnabled;
+};
+}
+
+TEST_F(itkParallelFirstTouchAllocatorUnitTest, SetGetGlobalEnabled) {
+  itk::ParallelFirstTouchAllocator::GlobalEnabledOn();
+  EXPECT_TRUE(itk::ParallelFirstTouchAllocator::GetGlobalEnabled());
+  itk::ParallelFirstTouchAllocator::GlobalEnabledOff();
+  EXPECT_FALSE(itk::ParallelFirstTouchAllocator::GetGlobalEnabled());
+}
+
+TEST_F(itkParallelFirstTouchAllocatorUnitTest, ZerosTheBufferedRegion) {
+  itk::ParallelFirstTouchAllocator::GlobalEnabledOn();
+
+  /* A region which does not start at the origin and is not a multiple of the work units */
+  HessianImageType::RegionType region;
+  region.SetIndex(HessianImageType::IndexType{{-3, 5, 2}});
+  region.SetSize(HessianImageType::SizeType{{7, 11, 13}});
+  HessianImageType::Pointer image = HessianImageType::New();
+  image->SetRegions(region);
+
+  HessianFilterType::Pointer filter = HessianFilterType::New();
+  filter->SetNumberOfWorkUnits(5);
+  itk::ParallelFirstTouchAllocator::Allocate(image.GetPointer(), filter.GetPointer());
+  ASSERT_NE(image->GetBufferPointer(), nullptr);
+  EXPECT_EQ(image->GetBufferedRegion(), region);
+
+  itk::ImageRegionConstIterator< HessianImageType > it(image, region);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    for (unsigned int i = 0; i < HessianImageType::PixelType::InternalDimension; ++i)
+    {
+      ASSERT_EQ(it.Get()[i], 0.0f);
+    }
+  }
+}
+
+TEST_F(itkParallelFirstTouchAllocatorUnitTest, HessianIsUnchanged) {
+  PhantomSourceType::Pointer phantom = PhantomSourceType::New();
+  phantom->SetSize(InputImageType::SizeType{{20, 20, 20}});
+  phantom->SetTrabecularSpacing(5.0);
+  phantom->Update();
+
+  HessianFilterType::Pointer filter = HessianFilterType::New();
+  filter->SetInput(phantom->GetOutput());
+  filter->SetSigma(1.0);
+
+  itk::ParallelFirstTouchAllocator::GlobalEnabledOff();
+  filter->Update();
+  HessianImageType::Pointer reference = filter->GetOutput();
+  reference->DisconnectPipeline();
+
+  itk::ParallelFirstTouchAllocator::GlobalEnabledOn();
+  filter->Modified();
+  filter->Update();
+  HessianImageType::Pointer touched = filter->GetOutput();
+  ASSERT_EQ(touched->GetBufferedRegion(), reference->GetBufferedRegion());
+
+  itk::ImageRegionConstIterator< HessianImageType > rIt(reference, reference->GetBufferedRegion());
+  itk::ImageRegionConstIterator< HessianImageType > tIt(touched, touched->GetBufferedRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++tIt)
+  {
+    ASSERT_EQ(rIt.Get(), tIt.Get());
+  }
+}
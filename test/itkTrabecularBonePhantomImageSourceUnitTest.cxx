@@ -0,0 +1,148 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkTrabecularBonePhantomImageSource.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+
+namespace
+{
+class itkTrabecularBonePhantomImageSourceUnitTest
+  : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using PixelType         = short;
+  using ImageType         = itk::Image< PixelType, DIMENSION >;
+  using SourceType        = itk::TrabecularBonePhantomImageSource< ImageType >;
+  using SourcePointerType = SourceType::Pointer;
+
+  itkTrabecularBonePhantomImageSourceUnitTest() {
+    m_Size.Fill(40);
+    m_Spacing.Fill(0.5);
+  }
+  ~itkTrabecularBonePhantomImageSourceUnitTest() override {}
+
+protected:
+  void SetUp() override {}
+  void TearDown() override {}
+
+  ImageType::Pointer Generate(SourceType::SeedType seed, itk::ThreadIdType workUnits)
+  {
+    SourcePointerType source = SourceType::New();
+    source->SetSize(m_Size);
+    source->SetSpacing(m_Spacing);
+    source->SetSeed(seed);
+    source->SetTrabecularSpacing(4.0);
+    source->SetCorticalThickness(1.5);
+    source->SetNumberOfWorkUnits(workUnits);
+    source->Update();
+    return source->GetOutput();
+  }
+
+  static bool ImagesAreEqual(const ImageType * a, const ImageType * b)
+  {
+    itk::ImageRegionConstIterator< ImageType > itA(a, a->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator< ImageType > itB(b, b->GetLargestPossibleRegion());
+    for (; !itA.IsAtEnd(); ++itA, ++itB)
+    {
+      if (itA.Get() != itB.Get())
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  ImageType::SizeType     m_Size;
+  ImageType::SpacingType  m_Spacing;
+};
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, InitialParameters) {
+  SourcePointerType source = SourceType::New();
+  EXPECT_EQ(source->GetSeed(), 0u);
+  EXPECT_DOUBLE_EQ(source->GetTrabecularSpacing(), 8.0);
+  EXPECT_DOUBLE_EQ(source->GetPlateThickness(), 1.5);
+  EXPECT_DOUBLE_EQ(source->GetRodThickness(), 2.0);
+  EXPECT_DOUBLE_EQ(source->GetPlateFraction(), 0.5);
+  EXPECT_DOUBLE_EQ(source->GetCorticalThickness(), 4.0);
+  EXPECT_DOUBLE_EQ(source->GetNoiseStandardDeviation(), 50.0);
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, PlateFractionIsClamped) {
+  SourcePointerType source = SourceType::New();
+  source->SetPlateFraction(2.0);
+  EXPECT_DOUBLE_EQ(source->GetPlateFraction(), 1.0);
+  source->SetPlateFraction(-1.0);
+  EXPECT_DOUBLE_EQ(source->GetPlateFraction(), 0.0);
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, OutputHasRequestedGeometry) {
+  ImageType::Pointer image = this->Generate(1, 1);
+  EXPECT_EQ(image->GetLargestPossibleRegion().GetSize(), m_Size);
+  EXPECT_EQ(image->GetSpacing(), m_Spacing);
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, SameSeedGivesSameImage) {
+  ImageType::Pointer first = this->Generate(7, 1);
+  ImageType::Pointer second = this->Generate(7, 1);
+  EXPECT_TRUE(ImagesAreEqual(first, second));
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, DifferentSeedGivesDifferentImage) {
+  ImageType::Pointer first = this->Generate(7, 1);
+  ImageType::Pointer second = this->Generate(8, 1);
+  EXPECT_FALSE(ImagesAreEqual(first, second));
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, IndependentOfNumberOfWorkUnits) {
+  ImageType::Pointer single = this->Generate(3, 1);
+  ImageType::Pointer many = this->Generate(3, 7);
+  EXPECT_TRUE(ImagesAreEqual(single, many));
+}
+
+TEST_F(itkTrabecularBonePhantomImageSourceUnitTest, ContainsBoneAndBackground) {
+  SourcePointerType source = SourceType::New();
+  source->SetSize(m_Size);
+  source->SetSpacing(m_Spacing);
+  source->SetTrabecularSpacing(4.0);
+  source->SetCorticalThickness(1.5);
+  source->SetNoiseStandardDeviation(0.0);
+  source->Update();
+
+  ImageType::IndexType corner;
+  corner.Fill(0);
+  EXPECT_EQ(source->GetOutput()->GetPixel(corner), 0);
+
+  bool hasTrabecular = false;
+  bool hasMarrow = false;
+  bool hasCortical = false;
+  itk::ImageRegionConstIterator< ImageType > it(source->GetOutput(), source->GetOutput()->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    hasTrabecular |= (it.Get() == 800);
+    hasMarrow |= (it.Get() == 50);
+    hasCortical |= (it.Get() == 1500);
+  }
+  EXPECT_TRUE(hasTrabecular);
+  EXPECT_TRUE(hasMarrow);
+  EXPECT_TRUE(hasCortical);
+}